@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <iostream>
+#include "AsyncModelLoader.h"
+#include "Profiler.h"
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Buffers of an unfinished upload are left to the context teardown: the loader may outlive the context
+AsyncModelLoader::~AsyncModelLoader() {
+    if (worker.valid()) {
+        worker.wait();
+    }
+}
+
+void AsyncModelLoader::start(const std::string& modelPath, const CookSettings& cookSettings) {
+    if (loadState == ModelLoadState::Loading || loadState == ModelLoadState::Uploading) {
+        std::cerr << "Model load already in progress: " << path << std::endl;
+        return;
+    }
+
+    path = modelPath;
+    settings = cookSettings;
+    cooked = CookedMesh();
+    vbo = ebo = 0; // Buffers of a previous load were handed to the caller
+    vertexBytesUploaded = indexBytesUploaded = 0;
+    uploadFrames = 0;
+    loadState = ModelLoadState::Loading;
+    startTime = std::chrono::steady_clock::now();
+
+    // The worker owns `cooked` until the future is ready; the GL thread only polls it
+    worker = std::async(std::launch::async, [this]() {
+        PROFILE_THREAD("model loader");
+        return loadCookedModel(path, cooked, settings) && cooked.vertexCount > 0;
+    });
+}
+
+bool AsyncModelLoader::update(size_t uploadBudget) {
+    PROFILE_ZONE("model upload");
+    if (loadState == ModelLoadState::Loading) {
+        if (worker.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            return false;
+        }
+        loadMs = millisecondsSince(startTime);
+        if (!worker.get()) {
+            std::cerr << "Failed to load model: " << path << std::endl;
+            loadState = ModelLoadState::Failed;
+            return false;
+        }
+
+        loadState = ModelLoadState::Uploading;
+        uploadStartTime = std::chrono::steady_clock::now();
+    }
+
+    if (loadState != ModelLoadState::Uploading) {
+        return false;
+    }
+    uploadFrames++;
+
+    // Allocating storage for a large model can take as long as many slices, so the vertex and the
+    // index buffer each get a frame of their own and no slice shares it. The copy target keeps the
+    // bound VAO's index buffer untouched.
+    if (vbo == 0 || ebo == 0) {
+        GLuint& buffer = vbo == 0 ? vbo : ebo;
+        size_t bytes = &buffer == &vbo ? cooked.vertexBytes() : cooked.indexBytes();
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, bytes, nullptr, GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        return false;
+    }
+
+    // Vertices first, then indices, never more than the budget per frame
+    size_t budget = std::max<size_t>(uploadBudget, 1);
+    if (vertexBytesUploaded < cooked.vertexBytes()) {
+        size_t bytes = std::min(budget, cooked.vertexBytes() - vertexBytesUploaded);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, vertexBytesUploaded, bytes,
+                        (const unsigned char*)cooked.vertices + vertexBytesUploaded);
+        vertexBytesUploaded += bytes;
+        budget -= bytes;
+    }
+    if (budget > 0 && indexBytesUploaded < cooked.indexBytes()) {
+        size_t bytes = std::min(budget, cooked.indexBytes() - indexBytesUploaded);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, ebo);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, indexBytesUploaded, bytes,
+                        (const unsigned char*)cooked.indices + indexBytesUploaded);
+        indexBytesUploaded += bytes;
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    if (vertexBytesUploaded < cooked.vertexBytes() || indexBytesUploaded < cooked.indexBytes()) {
+        return false;
+    }
+    uploadMs = millisecondsSince(uploadStartTime);
+    loadState = ModelLoadState::Resident;
+    return true;
+}
+
+float AsyncModelLoader::uploadProgress() const {
+    size_t total = cooked.vertexBytes() + cooked.indexBytes();
+    if (loadState == ModelLoadState::Resident) {
+        return 1.0f;
+    }
+    if (loadState != ModelLoadState::Uploading || total == 0) {
+        return 0.0f;
+    }
+    return (float)(vertexBytesUploaded + indexBytesUploaded) / total;
+}
+
+void AsyncModelLoader::printReport() const {
+    size_t bytes = cooked.vertexBytes() + cooked.indexBytes();
+    std::cout << "Async load of " << path << ": worker " << loadMs << " ms, upload " << bytes / (1024.0 * 1024.0)
+              << " MiB in " << uploadFrames << " frames (" << uploadMs << " ms)" << std::endl;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <GL/glew.h>
+#include <chrono>
+#include <cstddef>
+#include <future>
+#include <string>
+#include "MeshCache.h"
+
+// Bytes of glBufferSubData one frame may issue while a model uploads (a few ms on a typical bus)
+const size_t UPLOAD_BUDGET_PER_FRAME = 16u * 1024u * 1024u;
+
+enum class ModelLoadState {
+    Idle,
+    Loading,   // parsing / cooking / mapping the cache on the worker thread
+    Uploading, // streaming into GPU buffers, a budget per frame
+    Resident,
+    Failed,
+};
+
+// Loads a model without stalling the render loop. loadCookedModel runs on a worker thread; once it
+// is done, update() allocates the vertex and the index buffer on a frame each, then streams the
+// data into them, at most a budget of bytes per frame. The buffers are only handed out when everything is uploaded, so the
+// model appears in a single frame.
+class AsyncModelLoader {
+public:
+    AsyncModelLoader() = default;
+    AsyncModelLoader(const AsyncModelLoader&) = delete;
+    AsyncModelLoader& operator=(const AsyncModelLoader&) = delete;
+    ~AsyncModelLoader();
+
+    // Start loading in the background. A loader can be started again once resident or failed,
+    // which releases the previous mesh (its buffers stay with the caller).
+    void start(const std::string& path, const CookSettings& settings);
+
+    // GL thread, once per frame. Returns true on the frame the model becomes resident.
+    bool update(size_t uploadBudget = UPLOAD_BUDGET_PER_FRAME);
+
+    ModelLoadState state() const { return loadState; }
+    float uploadProgress() const;
+
+    // Valid once resident. The buffers belong to the caller from then on.
+    CookedMesh& mesh() { return cooked; }
+    GLuint vertexBuffer() const { return vbo; }
+    GLuint indexBuffer() const { return ebo; }
+
+    // Worker time, upload time and frames spent uploading
+    void printReport() const;
+
+private:
+    ModelLoadState loadState = ModelLoadState::Idle;
+    std::string path;
+    CookSettings settings;
+    CookedMesh cooked;
+    std::future<bool> worker;
+    GLuint vbo = 0, ebo = 0;
+    size_t vertexBytesUploaded = 0, indexBytesUploaded = 0;
+
+    std::chrono::steady_clock::time_point startTime, uploadStartTime;
+    double loadMs = 0.0, uploadMs = 0.0;
+    size_t uploadFrames = 0;
+};
@@ -0,0 +1,1019 @@
+#include <algorithm>
+#include <cmath>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <glm/gtc/matrix_inverse.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "Benchmarks.h"
+#include "HeadlessContext.h"
+#include "InstanceCulling.h"
+#include "Instancing.h"
+#include "MappedFile.h"
+#include "MeshCache.h"
+#include "MeshNormals.h"
+#include "MeshOptimizer.h"
+#include "Meshlets.h"
+#include "MeshSimplifier.h"
+#include "ModelLoader.h"
+#include "OcclusionCulling.h"
+#include "Parallel.h"
+#include "Profiler.h"
+#include "RenderQueue.h"
+#include "ShaderProgram.h"
+#include "TransformHierarchy.h"
+#include "tiny_obj_loader.h"
+
+typedef std::chrono::steady_clock BenchClock;
+
+static double elapsedMs(BenchClock::time_point start) {
+    return std::chrono::duration<double, std::milli>(BenchClock::now() - start).count();
+}
+
+// Run a workload several times and print its best and average wall time
+static double timeRuns(const char* label, int iterations, const std::function<void()>& workload) {
+    double best = 1e30, total = 0.0;
+    for (int i = 0; i < iterations; i++) {
+        BenchClock::time_point start = BenchClock::now();
+        workload();
+        double ms = elapsedMs(start);
+        best = std::min(best, ms);
+        total += ms;
+    }
+    std::cout << "  " << label << ": best " << best << " ms, avg " << total / iterations << " ms" << std::endl;
+    return best;
+}
+
+// Startup cost of the OBJ text path versus the memory-mapped mesh cache path
+static int benchStartup(const std::string& modelPath, int iterations) {
+    std::cout << "Startup benchmark: " << modelPath << " (" << iterations << " runs)" << std::endl;
+
+    double textMs = timeRuns("text path (LoadObj + weld)", iterations, [&]() {
+        Mesh mesh = loadIndexedModel(modelPath);
+        if (mesh.vertices.empty()) std::exit(1);
+    });
+
+    // Make sure a valid cache exists before timing the cache path
+    CookedMesh warmup;
+    if (!loadCookedModel(modelPath, warmup)) {
+        return 1;
+    }
+    warmup = CookedMesh();
+
+    volatile uint64_t sink = 0;
+    double cacheMs = timeRuns("cache path (stamp + mmap)", iterations, [&]() {
+        CookedMesh cooked;
+        SourceStamp stamp;
+        if (!stampSource(modelPath, stamp) || !openMeshCache(modelPath, stamp, CookSettings(), cooked)) std::exit(1);
+
+        // Touch every page the way glBufferData would read the streams
+        const unsigned char* vertexBytes = (const unsigned char*)cooked.vertices;
+        const unsigned char* indexBytes = (const unsigned char*)cooked.indices;
+        uint64_t sum = 0;
+        for (size_t i = 0; i < cooked.vertexBytes(); i += 4096) sum += vertexBytes[i];
+        for (size_t i = 0; i < cooked.indexBytes(); i += 4096) sum += indexBytes[i];
+        sink = sink + sum;
+    });
+
+    std::cout << "  cache speedup: " << textMs / cacheMs << "x" << std::endl;
+    return 0;
+}
+
+template <typename T>
+static bool sameBits(const std::vector<T>& a, const std::vector<T>& b) {
+    return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+}
+
+// Bitwise comparison of two tinyobj parse results
+static bool sameObjResult(const tinyobj::attrib_t& a, const std::vector<tinyobj::shape_t>& shapesA,
+                          const tinyobj::attrib_t& b, const std::vector<tinyobj::shape_t>& shapesB) {
+    if (!sameBits(a.vertices, b.vertices) || !sameBits(a.vertex_weights, b.vertex_weights) ||
+        !sameBits(a.normals, b.normals) || !sameBits(a.texcoords, b.texcoords) || !sameBits(a.colors, b.colors) ||
+        shapesA.size() != shapesB.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < shapesA.size(); i++) {
+        const tinyobj::mesh_t& meshA = shapesA[i].mesh;
+        const tinyobj::mesh_t& meshB = shapesB[i].mesh;
+        if (shapesA[i].name != shapesB[i].name || !sameBits(meshA.indices, meshB.indices) ||
+            !sameBits(meshA.num_face_vertices, meshB.num_face_vertices) ||
+            !sameBits(meshA.material_ids, meshB.material_ids) ||
+            !sameBits(meshA.smoothing_group_ids, meshB.smoothing_group_ids)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Sequential tinyobj::LoadObj versus the chunked parallel parser at increasing thread counts
+static int benchLoader(const std::string& modelPath, int iterations) {
+    MappedFile file;
+    if (!file.open(modelPath)) {
+        std::cerr << "Failed to open: " << modelPath << std::endl;
+        return 1;
+    }
+    double megabytes = file.size() / (1024.0 * 1024.0);
+    std::cout << "Loader benchmark: " << modelPath << " (" << megabytes << " MiB, " << iterations << " runs)" << std::endl;
+
+    tinyobj::attrib_t reference;
+    std::vector<tinyobj::shape_t> referenceShapes;
+    double sequentialMs = timeRuns("LoadObj (sequential)", iterations, [&]() {
+        std::vector<tinyobj::material_t> materials;
+        std::string warn, err;
+        reference = tinyobj::attrib_t();
+        referenceShapes.clear();
+        if (!tinyobj::LoadObj(&reference, &referenceShapes, &materials, &warn, &err, modelPath.c_str())) std::exit(1);
+    });
+    std::cout << "    " << megabytes / (sequentialMs / 1000.0) << " MiB/s" << std::endl;
+
+    unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned int threads = 1; ; threads = std::min(threads * 2, maxThreads)) {
+        tinyobj::attrib_t attrib;
+        std::vector<tinyobj::shape_t> shapes;
+        std::string label = "LoadObjParallel x" + std::to_string(threads);
+        double ms = timeRuns(label.c_str(), iterations, [&]() {
+            std::vector<tinyobj::material_t> materials;
+            std::string warn, err;
+            tinyobj::MaterialFileReader materialReader("");
+            attrib = tinyobj::attrib_t();
+            shapes.clear();
+            if (!tinyobj::LoadObjParallel(&attrib, &shapes, &materials, &warn, &err, (const char*)file.data(),
+                                          file.size(), &materialReader, true, true, threads)) std::exit(1);
+        });
+        std::cout << "    " << megabytes / (ms / 1000.0) << " MiB/s, " << sequentialMs / ms << "x vs sequential, "
+                  << (sameObjResult(reference, referenceShapes, attrib, shapes) ? "identical" : "MISMATCH") << std::endl;
+        if (threads == maxThreads) break;
+    }
+    return 0;
+}
+
+// Distance in float ulps between two parse results (0 when bitwise identical)
+static uint32_t ulpDistance(float a, float b) {
+    int32_t ia, ib;
+    std::memcpy(&ia, &a, sizeof(float));
+    std::memcpy(&ib, &b, sizeof(float));
+    // Map the sign-magnitude bit patterns onto a monotonic integer line
+    int64_t la = ia < 0 ? (int64_t)INT32_MIN - ia : ia;
+    int64_t lb = ib < 0 ? (int64_t)INT32_MIN - ib : ib;
+    return (uint32_t)std::min<int64_t>(la > lb ? la - lb : lb - la, UINT32_MAX);
+}
+
+struct FloatParseTotals {
+    size_t numbers = 0;
+    size_t mismatches = 0;
+    uint32_t maxUlps = 0;
+    double legacyMs = 0.0;
+    double fastMs = 0.0;
+};
+
+// Parse the same lines with both number parsers, accumulating the time and the differences
+static void compareFloatParsers(const std::vector<std::string>& lines, int iterations, bool verbose, FloatParseTotals& totals) {
+    std::vector<float> legacy, fast;
+    legacy.reserve(3 * lines.size());
+    fast.reserve(3 * lines.size());
+
+    double legacyBest = 1e30, fastBest = 1e30;
+    for (int i = 0; i < iterations; i++) {
+        legacy.clear();
+        BenchClock::time_point start = BenchClock::now();
+        parseObjAttributeNumbers(lines, true, legacy);
+        legacyBest = std::min(legacyBest, elapsedMs(start));
+
+        fast.clear();
+        start = BenchClock::now();
+        parseObjAttributeNumbers(lines, false, fast);
+        fastBest = std::min(fastBest, elapsedMs(start));
+    }
+    if (verbose) {
+        std::cout << "  legacy (digit loop + strcspn): best " << legacyBest << " ms" << std::endl;
+        std::cout << "  fast (SWAR + from_chars, SSE2 scan): best " << fastBest << " ms" << std::endl;
+    }
+
+    totals.legacyMs += legacyBest;
+    totals.fastMs += fastBest;
+    totals.numbers += fast.size();
+    for (size_t i = 0; i < fast.size(); i++) {
+        uint32_t ulps = ulpDistance(legacy[i], fast[i]);
+        if (ulps != 0) {
+            totals.mismatches++;
+            totals.maxUlps = std::max(totals.maxUlps, ulps);
+        }
+    }
+}
+
+static void printFloatParseTotals(const FloatParseTotals& totals) {
+    std::cout << "  " << totals.numbers << " numbers, " << totals.numbers / (totals.fastMs * 1000.0)
+              << " M numbers/s, " << totals.legacyMs / totals.fastMs << "x vs legacy" << std::endl;
+    std::cout << "  " << totals.mismatches << " results differ from the legacy parser (max "
+              << totals.maxUlps << " ulp)" << std::endl;
+}
+
+// Number parsing stage of the OBJ loader in isolation: the vertex lines of a model, then
+// a synthetic file of vertexCount "v x y z" lines generated in batches
+static int benchFloats(const std::string& modelPath, int iterations, size_t vertexCount) {
+    std::ifstream file(modelPath);
+    if (!file) {
+        std::cerr << "Failed to open: " << modelPath << std::endl;
+        return 1;
+    }
+    std::vector<std::string> lines;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.size() > 2 && line[0] == 'v' && (line[1] == ' ' || line[1] == 'n' || line[1] == 't')) {
+            lines.push_back(line);
+        }
+    }
+
+    std::cout << "Float parsing benchmark: " << lines.size() << " attribute lines of " << modelPath
+              << " (" << iterations << " runs)" << std::endl;
+    FloatParseTotals model;
+    compareFloatParsers(lines, iterations, true, model);
+    printFloatParseTotals(model);
+
+    // Exporter-like numbers: mostly fixed 6 decimals, some scientific notation and integers
+    std::cout << "Synthetic file: " << vertexCount << " vertices" << std::endl;
+    const size_t batchSize = 1000000;
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<float> coordinate(-500.0f, 500.0f);
+    std::uniform_int_distribution<int> style(0, 19);
+    FloatParseTotals synthetic;
+    char number[3][32];
+    for (size_t first = 0; first < vertexCount; first += batchSize) {
+        size_t count = std::min(batchSize, vertexCount - first);
+        lines.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            for (int k = 0; k < 3; k++) {
+                int s = style(rng);
+                float value = coordinate(rng);
+                if (s == 0) std::snprintf(number[k], sizeof(number[k]), "%.7e", value * 1e-3f);
+                else if (s == 1) std::snprintf(number[k], sizeof(number[k]), "%d", (int)value);
+                else std::snprintf(number[k], sizeof(number[k]), "%.6f", value);
+            }
+            lines[i] = std::string("v ") + number[0] + " " + number[1] + " " + number[2];
+        }
+        compareFloatParsers(lines, 1, false, synthetic);
+    }
+    std::cout << "  legacy: " << synthetic.legacyMs << " ms, fast: " << synthetic.fastMs << " ms" << std::endl;
+    printFloatParseTotals(synthetic);
+    return 0;
+}
+
+// Vertex cache / overdraw / vertex fetch pass: time and before/after statistics
+static int benchOptimize(const std::string& modelPath, int iterations) {
+    Mesh source = loadIndexedModel(modelPath);
+    if (source.vertices.empty()) {
+        return 1;
+    }
+
+    std::cout << "Mesh optimization benchmark: " << modelPath << " (" << iterations << " runs)" << std::endl;
+    timeRuns("optimizeMesh", iterations, [&]() {
+        Mesh mesh = source;
+        optimizeMesh(mesh);
+    });
+
+    Mesh mesh = source;
+    MeshOptimizationReport report;
+    optimizeMesh(mesh, &report);
+    printOptimizationReport(modelPath, report);
+    return 0;
+}
+
+// Meshlet build time, then CPU culling rejections for camera poses orbiting the model: 16 azimuths
+// at 3 elevations, from far enough to see the whole model down to close-ups that clip most of it
+static int benchMeshlets(const std::string& modelPath, int iterations) {
+    Mesh mesh = loadIndexedModel(modelPath);
+    if (mesh.vertices.empty()) {
+        return 1;
+    }
+    optimizeMesh(mesh);
+
+    std::cout << "Meshlet benchmark: " << modelPath << " (" << iterations << " runs)" << std::endl;
+    timeRuns("buildMeshlets", iterations, [&]() {
+        std::vector<Meshlet> meshlets = buildMeshlets(mesh);
+        if (meshlets.empty()) std::exit(1);
+    });
+    std::vector<Meshlet> meshlets = buildMeshlets(mesh);
+    printMeshletReport(modelPath, meshlets, mesh.indices.size() / 3);
+
+    glm::vec3 lo(INFINITY), hi(-INFINITY);
+    for (const Vertex& vertex : mesh.vertices) {
+        lo = glm::min(lo, vertex.position);
+        hi = glm::max(hi, vertex.position);
+    }
+    glm::vec3 center = (lo + hi) * 0.5f;
+    float radius = glm::length(hi - lo) * 0.5f;
+    // Same lens as the viewer
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1280.0f / 720.0f, 0.1f, 100.0f * radius);
+
+    const int azimuths = 16;
+    const float elevations[] = { 0.0f, 30.0f, 60.0f };
+    const float distances[] = { 3.0f, 1.2f, 0.6f }; // in bounding radii
+    size_t totalTriangles = mesh.indices.size() / 3;
+    std::vector<DrawRange> ranges;
+
+    for (float distance : distances) {
+        for (float elevation : elevations) {
+            MeshletCullStats frustumOnly, withCones;
+            size_t rangeCount = 0;
+            double cullMs = 0.0;
+            for (int a = 0; a < azimuths; a++) {
+                float azimuth = glm::radians(360.0f * a / azimuths);
+                glm::vec3 direction(std::cos(glm::radians(elevation)) * std::sin(azimuth), std::sin(glm::radians(elevation)),
+                                    std::cos(glm::radians(elevation)) * std::cos(azimuth));
+                glm::vec3 eye = center + direction * distance * radius;
+                glm::mat4 view = glm::lookAt(eye, center, glm::vec3(0.0f, 1.0f, 0.0f));
+                Frustum frustum = extractFrustum(projection * view);
+
+                ranges.clear();
+                cullMeshlets(meshlets.data(), meshlets.size(), frustum, eye, false, ranges, &frustumOnly);
+                ranges.clear();
+                BenchClock::time_point start = BenchClock::now();
+                cullMeshlets(meshlets.data(), meshlets.size(), frustum, eye, true, ranges, &withCones);
+                cullMs += elapsedMs(start);
+                rangeCount += ranges.size();
+            }
+
+            double poses = azimuths;
+            double total = (double)meshlets.size();
+            std::printf("  distance %.1fR, elevation %2.0f: frustum rejects %5.1f%%; + cones: frustum %5.1f%%, "
+                        "backface %5.1f%%, triangles drawn %5.1f%%, %6.1f draw ranges, cull %.3f ms\n",
+                        distance, elevation, 100.0 * (frustumOnly.outsideFrustum / poses) / total,
+                        100.0 * (withCones.outsideFrustum / poses) / total, 100.0 * (withCones.backfacing / poses) / total,
+                        100.0 * (withCones.visibleTriangles / poses) / totalTriangles, rangeCount / poses, cullMs / poses);
+        }
+    }
+    return 0;
+}
+
+// Height field of about `triangles` triangles with smooth normals and colors: a large closed-border
+// surface the simplifier can take all the way down
+static Mesh makeTerrain(size_t triangles) {
+    size_t side = std::max<size_t>(2, (size_t)std::sqrt(triangles / 2.0) + 1);
+    Mesh mesh;
+    mesh.vertices.resize(side * side);
+    auto height = [](float x, float z) {
+        return 0.1f * std::sin(x * 6.0f) * std::cos(z * 5.0f) + 0.03f * std::sin(x * 23.0f + z * 17.0f);
+    };
+    for (size_t z = 0; z < side; z++) {
+        for (size_t x = 0; x < side; x++) {
+            float fx = (float)x / (side - 1), fz = (float)z / (side - 1), e = 1e-3f;
+            Vertex& vertex = mesh.vertices[z * side + x];
+            vertex.position = glm::vec3(fx, height(fx, fz), fz);
+            glm::vec3 dx(2.0f * e, height(fx + e, fz) - height(fx - e, fz), 0.0f);
+            glm::vec3 dz(0.0f, height(fx, fz + e) - height(fx, fz - e), 2.0f * e);
+            vertex.normal = glm::normalize(glm::cross(dz, dx));
+            vertex.color = glm::vec3(0.3f + vertex.position.y, 0.6f, 0.3f);
+        }
+    }
+    mesh.indices.reserve((side - 1) * (side - 1) * 6);
+    for (size_t z = 0; z + 1 < side; z++) {
+        for (size_t x = 0; x + 1 < side; x++) {
+            uint32_t a = (uint32_t)(z * side + x), b = a + 1, c = a + (uint32_t)side, d = c + 1;
+            uint32_t quad[6] = { a, c, b, b, c, d };
+            mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+        }
+    }
+    mesh.submeshes.push_back({ 0, (uint32_t)mesh.indices.size(), -1 });
+    return mesh;
+}
+
+// LOD chain build time and per-level error, for the model and a synthetic multi-million triangle surface
+static int benchLod(const std::string& modelPath, int iterations, size_t terrainTriangles) {
+    Mesh source = loadIndexedModel(modelPath);
+    if (source.vertices.empty()) {
+        return 1;
+    }
+    optimizeMesh(source);
+
+    std::cout << "LOD benchmark: " << modelPath << " (" << iterations << " runs)" << std::endl;
+    double modelMs = timeRuns("buildLodChain", iterations, [&]() {
+        Mesh mesh = source;
+        buildLodChain(mesh);
+    });
+    Mesh mesh = source;
+    LodChain chain = buildLodChain(mesh);
+    printLodReport(modelPath, chain.levels.data(), (uint32_t)chain.levels.size(), modelMs);
+
+    Mesh terrain = makeTerrain(terrainTriangles);
+    std::cout << "Synthetic surface: " << terrain.indices.size() / 3 << " triangles" << std::endl;
+    BenchClock::time_point start = BenchClock::now();
+    LodChain terrainChain = buildLodChain(terrain);
+    printLodReport("synthetic surface", terrainChain.levels.data(), (uint32_t)terrainChain.levels.size(), elapsedMs(start));
+    return 0;
+}
+
+// Normal generation on a synthetic surface, on all cores and on one; the two must match bit for bit
+static int benchNormals(int iterations, size_t triangles) {
+    Mesh terrain = makeTerrain(triangles);
+    size_t triangleCount = terrain.indices.size() / 3;
+    std::vector<glm::vec3> positions(terrain.vertices.size());
+    for (size_t v = 0; v < terrain.vertices.size(); v++) {
+        positions[v] = terrain.vertices[v].position;
+    }
+
+    std::cout << "Normal generation benchmark: " << triangleCount << " triangles, " << std::thread::hardware_concurrency()
+              << " hardware threads (" << iterations << " runs)" << std::endl;
+    std::vector<glm::vec3> parallel(triangleCount * 3), serial(triangleCount * 3);
+    timeRuns("all threads", iterations, [&]() {
+        generateCornerNormals(positions.data(), positions.size(), terrain.indices.data(), triangleCount, nullptr,
+                              NORMAL_CREASE_ANGLE, parallel.data());
+    });
+    timeRuns("one thread", iterations, [&]() {
+        generateCornerNormals(positions.data(), positions.size(), terrain.indices.data(), triangleCount, nullptr,
+                              NORMAL_CREASE_ANGLE, serial.data(), 1);
+    });
+
+    // Against the analytic normals of the height field
+    double worstDegrees = 0.0;
+    for (size_t i = 0; i < terrain.indices.size(); i++) {
+        float cosine = glm::dot(parallel[i], terrain.vertices[terrain.indices[i]].normal);
+        worstDegrees = std::max(worstDegrees, (double)glm::degrees(std::acos(std::min(1.0f, cosine))));
+    }
+    bool identical = std::memcmp(parallel.data(), serial.data(), parallel.size() * sizeof(glm::vec3)) == 0;
+    std::cout << "  deterministic across thread counts: " << (identical ? "yes" : "NO") << std::endl;
+    std::cout << "  largest deviation from the analytic normal: " << worstDegrees << " degrees" << std::endl;
+    return identical ? 0 : 1;
+}
+
+// Instance container churn, frustum culling per kernel and the per-frame LOD batching of a fleet,
+// with the model's LOD chain
+static int benchInstances(const std::string& modelPath, int iterations, uint32_t instanceCount) {
+    Mesh mesh = loadIndexedModel(modelPath);
+    if (mesh.vertices.empty()) {
+        return 1;
+    }
+    optimizeMesh(mesh);
+    LodChain chain = buildLodChain(mesh);
+
+    std::cout << "Instancing benchmark: " << instanceCount << " instances (" << iterations << " runs)" << std::endl;
+    InstanceSet fleet;
+    double addMs = timeRuns("layoutFleet (add)", iterations, [&]() {
+        layoutFleet(fleet, instanceCount, 2.5f * chain.radius);
+    });
+
+    // Remove every other instance by handle, then add them back
+    std::vector<InstanceHandle> handles(instanceCount);
+    double churnMs = timeRuns("remove half + re-add", iterations, [&]() {
+        for (uint32_t i = 0; i < fleet.size(); i++) handles[i] = fleet.handleAt(i);
+        for (uint32_t i = 0; i < instanceCount; i += 2) {
+            if (!fleet.remove(handles[i])) std::exit(1);
+        }
+        for (uint32_t i = 0; i < instanceCount; i += 2) fleet.add(glm::mat4(1.0f));
+    });
+    std::cout << "  " << addMs * 1e6 / instanceCount << " ns per add, " << churnMs * 1e6 / instanceCount
+              << " ns per remove + add" << std::endl;
+
+    // The viewer's camera and model transform
+    glm::mat4 model = glm::scale(glm::mat4(1.0f), glm::vec3(0.2f));
+    model = glm::translate(model, glm::vec3(0.0f, -12.0f, 0.0f));
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.3f, 4.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1280.0f / 720.0f, 0.1f, 100.0f);
+    layoutFleet(fleet, instanceCount, 2.5f * chain.radius);
+    InstanceBounds bounds;
+    computeInstanceBounds(fleet, chain.center, chain.radius, bounds);
+    Frustum frustum = extractFrustum(projection * view * model);
+
+    // Every kernel must keep the same instances as the scalar one
+    VisibleInstances reference, visible;
+    cullInstances(bounds, frustum, reference, 1, CullKernel::Scalar);
+    std::vector<CullKernel> kernels = { CullKernel::Scalar };
+    if (bestCullKernel() != CullKernel::Scalar) kernels.push_back(CullKernel::SSE);
+    if (bestCullKernel() == CullKernel::AVX2) kernels.push_back(CullKernel::AVX2);
+    for (CullKernel kernel : kernels) {
+        for (unsigned int threads : { 1u, 0u }) {
+            std::string label = std::string("cullInstances ") + cullKernelName(kernel) + (threads == 1 ? ", one thread" : ", all threads");
+            timeRuns(label.c_str(), iterations, [&]() { cullInstances(bounds, frustum, visible, threads, kernel); });
+            if (visible.count != reference.count ||
+                !std::equal(visible.indices.begin(), visible.indices.begin() + visible.count, reference.indices.begin())) {
+                std::cerr << "  " << label << " disagrees with the scalar kernel" << std::endl;
+                return 1;
+            }
+        }
+    }
+    std::cout << "  " << reference.count << " of " << fleet.size() << " instances in the frustum" << std::endl;
+
+    InstanceBatches batches;
+    timeRuns("batchInstancesByLod (visible)", iterations, [&]() {
+        batchInstancesByLod(fleet, reference.indices.data(), reference.count, view * model, chain.levels.data(),
+                            (uint32_t)chain.levels.size(), chain.center, chain.radius, 720.0f, glm::radians(45.0f), batches);
+    });
+    std::cout << "  instances per LOD:";
+    for (uint32_t level = 0; level < LOD_LEVEL_COUNT; level++) {
+        std::cout << " " << batches.levelOffsets[level + 1] - batches.levelOffsets[level];
+    }
+    std::cout << std::endl;
+    return 0;
+}
+
+// CPU occlusion culling of a frustum-culled fleet: occluder generation, then for the viewer's
+// camera and a camera at car height between two rows, rasterizing on one and on all threads, the
+// pyramid and the occludee tests. Each depth buffer and pyramid is written as
+// occlusion_<camera><level>.pfm/.pgm for inspection.
+static int benchOcclusion(const std::string& modelPath, int iterations, uint32_t instanceCount) {
+    Mesh mesh = loadIndexedModel(modelPath);
+    if (mesh.vertices.empty()) {
+        return 1;
+    }
+    optimizeMesh(mesh);
+    LodChain chain = buildLodChain(mesh);
+
+    std::cout << "Occlusion benchmark: " << instanceCount << " instances (" << iterations << " runs)" << std::endl;
+    OccluderMesh occluder;
+    timeRuns("buildOccluderMesh", 1, [&]() { occluder = buildOccluderMesh(mesh); });
+    std::cout << "  occluder: " << occluder.indices.size() / 3 << " triangles, " << occluder.positions.size()
+              << " positions (model " << mesh.indices.size() / 3 << " triangles)" << std::endl;
+
+    float spacing = 2.5f * chain.radius;
+    InstanceSet fleet;
+    layoutFleet(fleet, instanceCount, spacing);
+    InstanceBounds bounds;
+    computeInstanceBounds(fleet, chain.center, chain.radius, bounds);
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1280.0f / 720.0f, 0.1f, 100.0f);
+
+    glm::mat4 model = glm::scale(glm::mat4(1.0f), glm::vec3(0.2f));
+    model = glm::translate(model, glm::vec3(0.0f, -12.0f, 0.0f));
+    glm::mat4 viewer = glm::lookAt(glm::vec3(0.0f, 0.3f, 4.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)) * model;
+    // Same world scale as the viewer, so the far plane reaches as many rows
+    float side = std::ceil(std::sqrt((float)instanceCount)) * spacing;
+    glm::vec3 eye = glm::vec3(model * glm::vec4(0.5f * spacing, chain.center.y, -0.5f * side - spacing, 1.0f));
+    glm::mat4 street = glm::lookAt(eye, eye + glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f)) * model;
+
+    const char* names[] = { "viewer", "street" };
+    const glm::mat4* cameras[] = { &viewer, &street };
+    for (int camera = 0; camera < 2; camera++) {
+        std::cout << "  " << names[camera] << " camera" << std::endl;
+        const glm::mat4& viewFromFleet = *cameras[camera];
+        VisibleInstances inFrustum, visible;
+        cullInstances(bounds, extractFrustum(projection * viewFromFleet), inFrustum);
+
+        OcclusionBuffer buffer;
+        std::vector<uint32_t> occluders;
+        std::vector<glm::mat4> transforms;
+        timeRuns("selectOccluders", iterations, [&]() {
+            buffer.selectOccluders(bounds, inFrustum, viewFromFleet, MAX_OCCLUDERS, occluders);
+            transforms.clear();
+            for (uint32_t index : occluders) {
+                transforms.push_back(viewFromFleet * unpackInstanceTransform(fleet.data()[index]));
+            }
+        });
+
+        for (unsigned int threads : { 1u, 0u }) {
+            std::string label = std::string("render ") + (threads == 1 ? "one thread" : "all threads");
+            timeRuns(label.c_str(), iterations, [&]() {
+                buffer.render(occluder, projection, transforms.data(), transforms.size(), threads);
+            });
+        }
+        timeRuns("buildPyramid", iterations, [&]() { buffer.buildPyramid(); });
+        timeRuns("cullOccludedInstances", iterations, [&]() {
+            visible.indices.assign(inFrustum.indices.begin(), inFrustum.indices.begin() + inFrustum.count);
+            visible.count = inFrustum.count;
+            buffer.cullOccludedInstances(fleet, occluder.boxMin, occluder.boxMax, viewFromFleet, visible);
+        });
+        std::cout << "  " << occluders.size() << " occluders, " << buffer.triangleCount() << " triangles rasterized, "
+                  << inFrustum.count << " instances in the frustum, " << visible.count << " not occluded" << std::endl;
+
+        std::string prefix = std::string("occlusion_") + names[camera];
+        if (!buffer.dumpLevels(prefix)) {
+            return 1;
+        }
+        std::cout << "  wrote " << prefix << "0.pgm .. " << prefix << buffer.levelCount() - 1 << ".pgm (and .pfm)" << std::endl;
+    }
+    return 0;
+}
+
+// Composing a transform hierarchy of roughly nodeCount nodes (roots with ten children each, three
+// levels deep, added depth-first so the first update sorts them) against a plain glm loop
+static int benchTransforms(int iterations, size_t nodeCount) {
+    const uint32_t fanout = 10;
+    size_t roots = std::max<size_t>(1, nodeCount / (1 + fanout + fanout * fanout + fanout * fanout * fanout));
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> offset(-5.0f, 5.0f), angle(-3.14159f, 3.14159f), stretch(0.5f, 2.0f);
+
+    TransformHierarchy hierarchy;
+    std::vector<TransformHandle> parentOf, rootHandles;
+    std::function<void(TransformHandle, int)> addSubtree = [&](TransformHandle parent, int depth) {
+        glm::vec3 axis = glm::normalize(glm::vec3(offset(random), offset(random), offset(random)) + glm::vec3(0.01f));
+        TransformHandle node = hierarchy.add(parent, glm::vec3(offset(random), offset(random), offset(random)),
+                                             glm::angleAxis(angle(random), axis),
+                                             glm::vec3(stretch(random), stretch(random), stretch(random)));
+        parentOf.push_back(parent);
+        if (depth < 3) {
+            for (uint32_t c = 0; c < fanout; c++) {
+                addSubtree(node, depth + 1);
+            }
+        }
+    };
+    hierarchy.reserve(roots * 1111);
+    for (size_t r = 0; r < roots; r++) {
+        rootHandles.push_back((TransformHandle)hierarchy.size());
+        addSubtree(NO_TRANSFORM_PARENT, 0);
+    }
+
+    std::cout << "Transform benchmark: " << hierarchy.size() << " nodes, " << roots << " roots, "
+              << std::thread::hardware_concurrency() << " hardware threads (" << iterations << " runs)" << std::endl;
+    BenchClock::time_point start = BenchClock::now();
+    hierarchy.update();
+    std::cout << "  first update (sort and compose): " << elapsedMs(start) << " ms" << std::endl;
+
+    // Nudging every root recomposes everything below it
+    auto touchRoots = [&]() {
+        for (TransformHandle root : rootHandles) {
+            hierarchy.translateLocal(root, glm::vec3(0.0f));
+        }
+    };
+    size_t composed = 0;
+    timeRuns("all nodes, all threads", iterations, [&]() {
+        touchRoots();
+        composed = hierarchy.update();
+    });
+    timeRuns("all nodes, one thread", iterations, [&]() {
+        touchRoots();
+        hierarchy.update(1);
+    });
+    std::cout << "  " << composed << " nodes composed per full update" << std::endl;
+    timeRuns("one subtree", iterations, [&]() {
+        hierarchy.rotateLocal(rootHandles[0], 0.01f, glm::vec3(0.0f, 1.0f, 0.0f));
+        composed = hierarchy.update();
+    });
+    std::cout << "  " << composed << " nodes composed for one subtree" << std::endl;
+    timeRuns("nothing changed", iterations, [&]() { hierarchy.update(); });
+
+    // Reference: matrices per node in creation order, with an explicit inverse for the normals
+    std::vector<glm::mat4> expected(hierarchy.size());
+    timeRuns("glm loop, one thread", iterations, [&]() {
+        for (size_t n = 0; n < expected.size(); n++) {
+            TransformHandle node = (TransformHandle)n;
+            glm::mat4 local = glm::translate(glm::mat4(1.0f), hierarchy.translation(node)) *
+                              glm::mat4_cast(hierarchy.rotation(node)) * glm::scale(glm::mat4(1.0f), hierarchy.scale(node));
+            expected[n] = parentOf[n] == NO_TRANSFORM_PARENT ? local : expected[parentOf[n]] * local;
+        }
+    });
+    float worldError = 0.0f, normalError = 0.0f;
+    for (size_t n = 0; n < expected.size(); n++) {
+        const glm::mat4& world = hierarchy.world((TransformHandle)n);
+        glm::mat3 normal = glm::transpose(glm::inverse(glm::mat3(expected[n])));
+        for (int c = 0; c < 4; c++) {
+            for (int r = 0; r < 4; r++) {
+                float scale = std::max(1.0f, std::fabs(expected[n][c][r]));
+                worldError = std::max(worldError, std::fabs(world[c][r] - expected[n][c][r]) / scale);
+            }
+        }
+        for (int c = 0; c < 3; c++) {
+            for (int r = 0; r < 3; r++) {
+                float scale = std::max(1.0f, std::fabs(normal[c][r]));
+                normalError = std::max(normalError, std::fabs(hierarchy.normalMatrix((TransformHandle)n)[c][r] - normal[c][r]) / scale);
+            }
+        }
+    }
+    std::cout << "  largest relative difference from glm: world " << worldError << ", normal " << normalError << std::endl;
+    return worldError < 1e-4f && normalError < 1e-3f ? 0 : 1;
+}
+
+// Program, material and vertex array switches a submission in this order would make
+static size_t countStateChanges(const std::vector<DrawItem>& items) {
+    const int shift = SORT_KEY_DEPTH_BITS;
+    const uint64_t programMask = ((1ull << SORT_KEY_PROGRAM_BITS) - 1) << (SORT_KEY_MATERIAL_BITS + SORT_KEY_VERTEX_ARRAY_BITS + shift);
+    const uint64_t materialMask = ((1ull << SORT_KEY_MATERIAL_BITS) - 1) << (SORT_KEY_VERTEX_ARRAY_BITS + shift);
+    const uint64_t vertexArrayMask = ((1ull << SORT_KEY_VERTEX_ARRAY_BITS) - 1) << shift;
+    size_t changes = 0;
+    for (size_t i = 1; i < items.size(); i++) {
+        uint64_t different = items[i].key ^ items[i - 1].key;
+        changes += ((different & programMask) != 0) + ((different & materialMask) != 0) + ((different & vertexArrayMask) != 0);
+    }
+    return changes;
+}
+
+// Filling a render queue with itemCount random draws from one list per thread, then sorting it
+static int benchRenderQueue(int iterations, size_t itemCount) {
+    unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+    RenderQueue queue;
+    auto fill = [&]() {
+        queue.reset(threads);
+        parallelFor(threads, [&](size_t t) {
+            DrawList& list = queue.list(t);
+            std::mt19937 random((uint32_t)t + 1);
+            size_t begin = itemCount * t / threads, end = itemCount * (t + 1) / threads;
+            for (size_t i = begin; i < end; i++) {
+                uint32_t bits = random();
+                DrawCommand command = { (uint32_t)list.ranges.size(), 0, 0, 1, 1, (uint16_t)(bits % 8),
+                                        (uint16_t)((bits >> 3) % 256), 4 };
+                list.ranges.push_back({ (uint32_t)i * 3, 3 });
+                list.push(makeSortKey(RENDER_PASS_OPAQUE, command.program, command.material, (bits >> 11) % 16,
+                                      depthBucket((float)(bits >> 15) / 1000.0f, 0.1f, 100.0f)),
+                          command);
+            }
+        }, threads);
+    };
+
+    std::cout << "Render queue benchmark: " << itemCount << " draws from " << threads << " lists (" << iterations
+              << " runs)" << std::endl;
+    timeRuns("fill", iterations, fill);
+    double best = 1e30, total = 0.0;
+    for (int i = 0; i < iterations; i++) {
+        fill();
+        double ms = queue.sort();
+        best = std::min(best, ms);
+        total += ms;
+    }
+    std::cout << "  sort: best " << best << " ms, avg " << total / iterations << " ms" << std::endl;
+
+    // Keys ascend, equal keys keep list order, and every command is present once
+    const std::vector<DrawItem>& sorted = queue.sorted();
+    bool ordered = sorted.size() == itemCount;
+    for (size_t i = 1; ordered && i < sorted.size(); i++) {
+        ordered = sorted[i - 1].key < sorted[i].key || (sorted[i - 1].key == sorted[i].key && sorted[i - 1].command < sorted[i].command);
+    }
+    std::vector<DrawItem> submitted;
+    for (size_t t = 0; t < queue.listCount(); t++) {
+        submitted.insert(submitted.end(), queue.list(t).items.begin(), queue.list(t).items.end());
+    }
+    std::cout << "  program/material/vertex array changes: " << countStateChanges(submitted) << " in submission order, "
+              << countStateChanges(sorted) << " sorted" << std::endl;
+    std::cout << "  sorted correctly: " << (ordered ? "yes" : "NO") << std::endl;
+    return ordered ? 0 : 1;
+}
+
+// Cost of one empty PROFILE_ZONE: two timestamps and a ring append
+static int benchProfiler(int iterations, size_t zoneCount) {
+#if A2_PROFILE
+    std::cout << "Profiler benchmark: " << zoneCount << " empty zones (" << iterations << " runs)" << std::endl;
+    double best = timeRuns("zones", iterations, [&]() {
+        for (size_t i = 0; i < zoneCount; i++) {
+            PROFILE_ZONE("empty");
+        }
+    });
+    double nsPerZone = best * 1e6 / zoneCount;
+    std::cout << "  " << nsPerZone << " ns per zone" << std::endl;
+    return nsPerZone < 50.0 ? 0 : 1;
+#else
+    (void)iterations;
+    (void)zoneCount;
+    std::cout << "Profiler benchmark: built with A2_PROFILE=0, zones compile to nothing" << std::endl;
+    return 0;
+#endif
+}
+
+// The model shader's instance and normal transform (a2.h) on the float vertex layout. By default
+// normals take the normal matrix computed once on the CPU; PER_VERTEX_INVERSE takes the transpose
+// of the inverse of the full transform in every vertex instead, as the shader did before.
+static const char* normalBenchVertexSource = "#version 330 core\n"
+"layout (location = 0) in vec3 aPos;\n"
+"layout (location = 2) in vec3 aNormal;\n"
+"layout (location = 3) in vec4 aInstanceRow0;\n"
+"layout (location = 4) in vec4 aInstanceRow1;\n"
+"layout (location = 5) in vec4 aInstanceRow2;\n"
+"out vec3 FragPos;\n"
+"out vec3 Normal;\n"
+"uniform mat4 model;\n"
+"uniform mat4 view;\n"
+"uniform mat4 projection;\n"
+"uniform mat3 normalMatrix;\n"
+"void main()\n"
+"{\n"
+"   mat4 instance = transpose(mat4(aInstanceRow0, aInstanceRow1, aInstanceRow2, vec4(0.0, 0.0, 0.0, 1.0)));\n"
+"   mat4 world = model * instance;\n"
+"   FragPos = vec3(world * vec4(aPos, 1.0));\n"
+"#ifdef PER_VERTEX_INVERSE\n"
+"   Normal = mat3(transpose(inverse(world))) * aNormal;\n"
+"#else\n"
+"   Normal = normalMatrix * (mat3(instance) * aNormal);\n"
+"#endif\n"
+"   gl_Position = projection * view * vec4(FragPos, 1.0);\n"
+"}\n";
+
+// Diffuse and specular lighting of a single color, about the cost of the model's material shading
+static const char* normalBenchFragmentSource = "#version 330 core\n"
+"in vec3 FragPos;\n"
+"in vec3 Normal;\n"
+"out vec4 FragColor;\n"
+"uniform vec3 lightPos;\n"
+"uniform vec3 viewPos;\n"
+"void main()\n"
+"{\n"
+"   vec3 norm = normalize(Normal);\n"
+"   vec3 lightDir = normalize(lightPos - FragPos);\n"
+"   vec3 reflectDir = reflect(-lightDir, norm);\n"
+"   float spec = pow(max(dot(normalize(viewPos - FragPos), reflectDir), 0.0), 32.0);\n"
+"   vec3 color = vec3(0.8, 0.3, 0.2) * (0.1 + max(dot(norm, lightDir), 0.0)) + vec3(0.5 * spec);\n"
+"   FragColor = vec4(color, 1.0);\n"
+"}\n";
+
+// GPU cost of the two normal transforms on an instanced fleet drawn into a headless 1280x720
+// render target: the vertex stage alone (GL_RASTERIZER_DISCARD) and the full frame, each run a
+// clear, one instanced draw of the model's triangle soup and a glFinish. The two full frames are compared pixel by pixel.
+static int benchNormalMatrix(const std::string& modelPath, int iterations, uint32_t instanceCount) {
+    Mesh mesh = loadIndexedModel(modelPath);
+    if (mesh.vertices.empty()) {
+        return 1;
+    }
+
+    HeadlessContext context;
+    if (!context.create()) {
+        return 1;
+    }
+    GLenum err = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+    // GLEW built for GLX finds no X display behind an EGL context, but has loaded GL by then
+    if (err == GLEW_ERROR_NO_GLX_DISPLAY) {
+        err = GLEW_OK;
+    }
+#endif
+    if (err != GLEW_OK) {
+        std::cerr << "Error: " << glewGetErrorString(err) << std::endl;
+        return 1;
+    }
+    if (!context.createFramebuffer(1280, 720)) {
+        return 1;
+    }
+
+    ShaderProgram programs[2];
+    if (!programs[0].build(normalBenchVertexSource, normalBenchFragmentSource, "normal matrix") ||
+        !programs[1].build(normalBenchVertexSource, normalBenchFragmentSource, "per-vertex inverse",
+                           "#define PER_VERTEX_INVERSE\n")) {
+        return 1;
+    }
+
+    glm::vec3 lo = mesh.vertices[0].position, hi = lo;
+    for (const Vertex& vertex : mesh.vertices) {
+        lo = glm::min(lo, vertex.position);
+        hi = glm::max(hi, vertex.position);
+    }
+    float radius = glm::length(hi - lo) * 0.5f;
+    InstanceSet fleet;
+    layoutFleet(fleet, instanceCount, 2.5f * radius);
+
+    // Drawn as a triangle soup, so every corner is one vertex invocation whatever the driver
+    // reuses between indexed corners
+    std::vector<Vertex> corners(mesh.indices.size());
+    for (size_t i = 0; i < mesh.indices.size(); i++) {
+        corners[i] = mesh.vertices[mesh.indices[i]];
+    }
+    GLuint vao, buffers[2];
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(2, buffers);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+    glBufferData(GL_ARRAY_BUFFER, corners.size() * sizeof(Vertex), corners.data(), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+    glBindBuffer(GL_ARRAY_BUFFER, buffers[1]);
+    glBufferData(GL_ARRAY_BUFFER, fleet.size() * sizeof(InstanceTransform), fleet.data(), GL_STATIC_DRAW);
+    for (unsigned int row = 0; row < 3; row++) {
+        glEnableVertexAttribArray(3 + row);
+        glVertexAttribPointer(3 + row, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceTransform),
+                              (void*)(row * sizeof(glm::vec4)));
+        glVertexAttribDivisor(3 + row, 1);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // The whole fleet in view, under a model matrix that rotates and scales non-uniformly, so the
+    // normal matrix is not just the model's upper 3x3
+    float extent = 2.5f * radius * std::ceil(std::sqrt((float)instanceCount));
+    glm::mat4 model = glm::scale(glm::rotate(glm::mat4(1.0f), 0.4f, glm::vec3(0.0f, 1.0f, 0.0f)), glm::vec3(1.0f, 1.2f, 0.8f));
+    glm::vec3 eye(0.0f, 0.6f * extent, 0.9f * extent);
+    glm::mat4 view = glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 1280.0f / 720.0f, 0.01f * extent, 4.0f * extent);
+    for (ShaderProgram& program : programs) {
+        program.use();
+        program.set(uniformId("model"), model);
+        program.set(uniformId("view"), view);
+        program.set(uniformId("projection"), projection);
+        if (program.hasUniform(uniformId("normalMatrix"))) {
+            program.set(uniformId("normalMatrix"), glm::inverseTranspose(glm::mat3(model)));
+        }
+        program.set(uniformId("lightPos"), eye + glm::vec3(0.0f, extent, 0.0f));
+        program.set(uniformId("viewPos"), eye);
+    }
+    glEnable(GL_DEPTH_TEST);
+
+    std::cout << "Normal matrix benchmark: " << modelPath << ", " << instanceCount << " instances ("
+              << corners.size() * instanceCount << " vertex invocations, " << iterations << " runs)" << std::endl;
+    auto drawFleet = [&](const ShaderProgram& program) {
+        program.use();
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, (GLsizei)corners.size(), (GLsizei)fleet.size());
+        glFinish();
+    };
+    // The two programs alternate within each run, so drift in the machine's load hits both alike
+    const char* labels[2][2] = { { "normal matrix, vertex stage", "per-vertex inverse, vertex stage" },
+                                 { "normal matrix, full frame", "per-vertex inverse, full frame" } };
+    double best[2][2];
+    std::vector<unsigned char> frames[2];
+    for (int fullFrame = 0; fullFrame < 2; fullFrame++) {
+        if (fullFrame) {
+            glDisable(GL_RASTERIZER_DISCARD);
+        }
+        else {
+            glEnable(GL_RASTERIZER_DISCARD);
+        }
+        double total[2] = { 0.0, 0.0 };
+        best[fullFrame][0] = best[fullFrame][1] = 1e30;
+        for (int run = -1; run < iterations; run++) {
+            for (int variant = 0; variant < 2; variant++) {
+                BenchClock::time_point start = BenchClock::now();
+                drawFleet(programs[variant]);
+                double ms = elapsedMs(start);
+                // Run -1 only warms up: the driver finishes compiling on the first draw
+                if (run >= 0) {
+                    best[fullFrame][variant] = std::min(best[fullFrame][variant], ms);
+                    total[variant] += ms;
+                }
+            }
+        }
+        for (int variant = 0; variant < 2; variant++) {
+            std::cout << "  " << labels[fullFrame][variant] << ": best " << best[fullFrame][variant] << " ms, avg "
+                      << total[variant] / iterations << " ms" << std::endl;
+            if (fullFrame) {
+                drawFleet(programs[variant]);
+                context.readPixels(frames[variant]);
+            }
+        }
+    }
+    size_t differing = 0;
+    for (size_t i = 0; i < frames[0].size(); i += 3) {
+        differing += std::memcmp(&frames[0][i], &frames[1][i], 3) != 0;
+    }
+    std::cout << "  vertex stage " << best[0][1] / best[0][0] << "x faster, full frame " << best[1][1] / best[1][0]
+              << "x faster; " << differing << " of " << frames[0].size() / 3 << " pixels differ" << std::endl;
+
+    glBindVertexArray(0);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteBuffers(2, buffers);
+    return 0;
+}
+
+int runBenchmark(int argc, char** argv) {
+    if (argc < 1) {
+        std::cerr << "Usage: a2 --bench <startup|loader|floats|optimize|meshlets|lod|normals|instances|occlusion|transforms|renderqueue|profiler|normalmatrix> [model path] [iterations]" << std::endl;
+        return 1;
+    }
+
+    std::string name = argv[0];
+    std::string modelPath = argc > 1 ? argv[1] : "../cybertruck.obj";
+    int iterations = argc > 2 ? std::max(1, std::atoi(argv[2])) : 5;
+
+    if (name == "startup") return benchStartup(modelPath, iterations);
+    if (name == "loader") return benchLoader(modelPath, iterations);
+    if (name == "optimize") return benchOptimize(modelPath, iterations);
+    if (name == "meshlets") return benchMeshlets(modelPath, iterations);
+    if (name == "normals") {
+        // Optional 4th argument: triangle count of the synthetic surface
+        size_t triangles = argc > 3 ? (size_t)std::atoll(argv[3]) : 10000000;
+        return benchNormals(iterations, triangles);
+    }
+    if (name == "instances") {
+        // Optional 4th argument: fleet size
+        uint32_t instanceCount = argc > 3 ? (uint32_t)std::max(1, std::atoi(argv[3])) : 100000;
+        return benchInstances(modelPath, iterations, instanceCount);
+    }
+    if (name == "occlusion") {
+        // Optional 4th argument: fleet size
+        uint32_t instanceCount = argc > 3 ? (uint32_t)std::max(1, std::atoi(argv[3])) : 10000;
+        return benchOcclusion(modelPath, iterations, instanceCount);
+    }
+    if (name == "transforms") {
+        // Optional 4th argument: node count
+        size_t nodeCount = argc > 3 ? (size_t)std::atoll(argv[3]) : 1000000;
+        return benchTransforms(iterations, nodeCount);
+    }
+    if (name == "renderqueue") {
+        // Optional 4th argument: draw count
+        size_t itemCount = argc > 3 ? (size_t)std::atoll(argv[3]) : 100000;
+        return benchRenderQueue(iterations, itemCount);
+    }
+    if (name == "profiler") {
+        // Optional 4th argument: zone count
+        size_t zoneCount = argc > 3 ? (size_t)std::atoll(argv[3]) : 1000000;
+        return benchProfiler(iterations, zoneCount);
+    }
+    if (name == "normalmatrix") {
+        // Optional 4th argument: fleet size
+        uint32_t instanceCount = argc > 3 ? (uint32_t)std::max(1, std::atoi(argv[3])) : 200;
+        return benchNormalMatrix(modelPath, iterations, instanceCount);
+    }
+    if (name == "lod") {
+        // Optional 4th argument: triangle count of the synthetic surface
+        size_t terrainTriangles = argc > 3 ? (size_t)std::atoll(argv[3]) : 10000000;
+        return benchLod(modelPath, iterations, terrainTriangles);
+    }
+    if (name == "floats") {
+        // Optional 4th argument: vertex count of the synthetic file
+        size_t vertexCount = argc > 3 ? (size_t)std::atoll(argv[3]) : 50000000;
+        return benchFloats(modelPath, iterations, vertexCount);
+    }
+
+    std::cerr << "Unknown benchmark: " << name << std::endl;
+    return 1;
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+// Command-line benchmarks, run without opening a window:
+//   a2 --bench <name> [model path] [iterations]
+// Returns the process exit code.
+int runBenchmark(int argc, char** argv);
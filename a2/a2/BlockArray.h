@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Append-only arena array stored in fixed-size blocks. Growing never moves existing
+// elements, so there is no transient 2x copy as with std::vector reallocation and
+// the slack is bounded by one block.
+template <typename T, size_t BlockShift = 14>
+class BlockArray {
+public:
+    static const size_t BLOCK_SIZE = size_t(1) << BlockShift;
+
+    void push_back(const T& value) {
+        if ((count & (BLOCK_SIZE - 1)) == 0 && count / BLOCK_SIZE == blocks.size()) {
+            blocks.emplace_back(new T[BLOCK_SIZE]);
+        }
+        blocks[count >> BlockShift][count & (BLOCK_SIZE - 1)] = value;
+        count++;
+    }
+
+    T& operator[](size_t i) { return blocks[i >> BlockShift][i & (BLOCK_SIZE - 1)]; }
+    const T& operator[](size_t i) const { return blocks[i >> BlockShift][i & (BLOCK_SIZE - 1)]; }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    size_t bytes() const { return blocks.size() * BLOCK_SIZE * sizeof(T); }
+
+    void clear() {
+        blocks.clear();
+        count = 0;
+    }
+
+private:
+    std::vector<std::unique_ptr<T[]>> blocks;
+    size_t count = 0;
+};
@@ -0,0 +1,125 @@
+#include <chrono>
+#include <iostream>
+#include "GLStateCache.h"
+#include "Instancing.h"
+#include "Profiler.h"
+
+bool GLStateCache::changed(bool different) {
+    if (different) {
+        stats.binds++;
+    }
+    else {
+        stats.bindsSkipped++;
+    }
+    return different;
+}
+
+void GLStateCache::useProgram(GLuint id) {
+    if (changed(program != id)) {
+        glUseProgram(id);
+        program = id;
+    }
+}
+
+void GLStateCache::bindVertexArray(GLuint id) {
+    if (changed(vertexArray != id)) {
+        glBindVertexArray(id);
+        vertexArray = id;
+    }
+}
+
+void GLStateCache::bindArrayBuffer(GLuint id) {
+    if (changed(arrayBuffer != id)) {
+        glBindBuffer(GL_ARRAY_BUFFER, id);
+        arrayBuffer = id;
+    }
+}
+
+void GLStateCache::polygonMode(GLenum value) {
+    if (changed(mode != value)) {
+        glPolygonMode(GL_FRONT_AND_BACK, value);
+        mode = value;
+    }
+}
+
+void GLStateCache::cullFace(bool enabled) {
+    if (changed(culling != (int)enabled)) {
+        if (enabled) {
+            glEnable(GL_CULL_FACE);
+        }
+        else {
+            glDisable(GL_CULL_FACE);
+        }
+        culling = enabled;
+    }
+}
+
+void GLStateCache::pointInstances(GLuint buffer, size_t offset) {
+    if (!changed(instanceBuffer != buffer || instanceOffset != offset || instanceVertexArray != vertexArray)) {
+        return;
+    }
+    bindArrayBuffer(buffer);
+    for (unsigned int row = 0; row < 3; row++) {
+        glVertexAttribPointer(INSTANCE_ATTRIBUTE_LOCATION + row, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceTransform),
+                              (void*)(offset + row * sizeof(glm::vec4)));
+    }
+    instanceBuffer = buffer;
+    instanceOffset = offset;
+    instanceVertexArray = vertexArray;
+}
+
+void GLStateCache::invalidate() {
+    program = vertexArray = arrayBuffer = instanceBuffer = instanceVertexArray = UNKNOWN;
+    mode = 0;
+    culling = -1;
+    instanceOffset = SIZE_MAX;
+}
+
+void GLStateCache::submit(const RenderQueue& queue, ShaderProgram* const* programs, GLuint instanceBuffer,
+                          size_t instanceOffset) {
+    PROFILE_ZONE("draw submission");
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (const DrawItem& item : queue.sorted()) {
+        const DrawCommand& command = queue.command(item.command);
+        const DrawRange* ranges = queue.ranges(item.command);
+        ShaderProgram& program = *programs[command.program];
+        useProgram(program.id());
+        bindVertexArray(command.vertexArray);
+        program.set(uniformId("materialIndex"), (int)command.material);
+        GLenum indexType = command.indexSize == sizeof(uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+        // Plain draws still read the instance attributes, at instance firstInstance
+        pointInstances(instanceBuffer, instanceOffset + command.firstInstance * sizeof(InstanceTransform));
+        if (command.instanceCount > 0) {
+            for (uint32_t r = 0; r < command.rangeCount; r++) {
+                glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)ranges[r].indexCount, indexType,
+                                        (const void*)((size_t)ranges[r].indexOffset * command.indexSize),
+                                        (GLsizei)command.instanceCount);
+                stats.draws++;
+            }
+            continue;
+        }
+
+        counts.clear();
+        offsets.clear();
+        for (uint32_t r = 0; r < command.rangeCount; r++) {
+            counts.push_back((GLsizei)ranges[r].indexCount);
+            offsets.push_back((const void*)((size_t)ranges[r].indexOffset * command.indexSize));
+        }
+        glMultiDrawElements(GL_TRIANGLES, counts.data(), indexType, offsets.data(), (GLsizei)command.rangeCount);
+        stats.draws++;
+    }
+
+    stats.items += queue.sorted().size();
+    stats.frames++;
+    stats.submitMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void printRenderStats(const RenderStats& stats) {
+    double perFrame = stats.frames > 0 ? 1.0 / stats.frames : 0.0;
+    std::cout << "Render queue over " << stats.frames << " frames, per frame: " << stats.items * perFrame << " items, "
+              << stats.draws * perFrame << " draws, " << stats.binds * perFrame << " binds issued, "
+              << stats.bindsSkipped * perFrame << " skipped, sort " << stats.sortMs * perFrame << " ms, submit "
+              << stats.submitMs * perFrame << " ms" << std::endl;
+}
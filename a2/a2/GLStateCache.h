@@ -0,0 +1,59 @@
+#pragma once
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "RenderQueue.h"
+#include "ShaderProgram.h"
+
+// Render queue counters, summed over the frames since the last reset
+struct RenderStats {
+    size_t frames = 0;
+    size_t items = 0;         // queued draw commands
+    size_t draws = 0;         // glDraw* calls issued
+    size_t binds = 0;         // state changes that reached GL
+    size_t bindsSkipped = 0;  // state changes dropped because the state was already current
+    double sortMs = 0.0;
+    double submitMs = 0.0;
+};
+
+// Shadow copy of the GL state the renderer changes, so setting what is already current costs no
+// GL call. Anything that changes this state behind the cache's back must call invalidate().
+class GLStateCache {
+public:
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vertexArray);
+    void bindArrayBuffer(GLuint buffer);
+    void polygonMode(GLenum mode);
+    void cullFace(bool enabled);
+    // Point the instance transform attributes of the bound vertex array at the transforms
+    // starting `offset` bytes into `buffer`. GL 3.3 has no base instance, so each instanced
+    // range re-points.
+    void pointInstances(GLuint buffer, size_t offset);
+    void invalidate();
+
+    // Issue the queue's sorted draws. programs[command.program] is made current for each command
+    // and its materialIndex uniform set (the program's own cache skips repeats); transforms are
+    // read from the array starting instanceOffset bytes into instanceBuffer.
+    void submit(const RenderQueue& queue, ShaderProgram* const* programs, GLuint instanceBuffer, size_t instanceOffset);
+
+    RenderStats stats;
+
+private:
+    bool changed(bool different);
+
+    std::vector<GLsizei> counts; // glMultiDrawElements arguments, kept across frames
+    std::vector<const void*> offsets;
+
+    static const GLuint UNKNOWN = 0xFFFFFFFFu;
+    GLuint program = UNKNOWN;
+    GLuint vertexArray = UNKNOWN;
+    GLuint arrayBuffer = UNKNOWN;
+    GLenum mode = 0;
+    int culling = -1;
+    GLuint instanceBuffer = UNKNOWN;    // what the bound vertex array's instance attributes point at
+    size_t instanceOffset = SIZE_MAX;
+    GLuint instanceVertexArray = UNKNOWN;
+};
+
+void printRenderStats(const RenderStats& stats);
@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include "GpuTimer.h"
+#include "Profiler.h"
+
+GpuTimer::~GpuTimer() {
+    release();
+}
+
+bool GpuTimer::create() {
+    release();
+    for (int i = 0; i < GPU_TIMER_FRAME_COUNT; i++) {
+        glGenQueries(GPU_TIMER_MAX_PASSES * 2, queries[i]);
+        frames[i] = FrameQueries();
+    }
+    GLint counterBits = 0;
+    glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &counterBits);
+    if (counterBits == 0) {
+        std::cerr << "GPU timestamps are not supported; passes will not be timed" << std::endl;
+        release();
+        return false;
+    }
+#if A2_PROFILE
+    // The GPU clock's reading now, as the commands so far reach the GPU
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    profilerCalibrateGpu(gpuNow);
+#endif
+    frame = GPU_TIMER_FRAME_COUNT - 1;
+    inPass = false;
+    created = true;
+    return true;
+}
+
+void GpuTimer::release() {
+    for (int i = 0; i < GPU_TIMER_FRAME_COUNT; i++) {
+        if (queries[i][0] != 0) {
+            glDeleteQueries(GPU_TIMER_MAX_PASSES * 2, queries[i]);
+        }
+        std::fill(queries[i], queries[i] + GPU_TIMER_MAX_PASSES * 2, 0);
+        frames[i] = FrameQueries();
+    }
+    created = false;
+}
+
+void GpuTimer::collect(int index, bool wait) {
+    FrameQueries& queued = frames[index];
+    if (!queued.pending) {
+        return;
+    }
+    queued.pending = false;
+    if (queued.passCount == 0) {
+        return;
+    }
+
+    // The last query is written last, so once it is done the whole frame is
+    GLint available = 0;
+    glGetQueryObjectiv(queries[index][queued.passCount * 2 - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available && !wait) {
+        stats.dropped++;
+        return;
+    }
+
+    GLuint64 timestamps[GPU_TIMER_MAX_PASSES * 2];
+    for (int i = 0; i < queued.passCount * 2; i++) {
+        glGetQueryObjectui64v(queries[index][i], GL_QUERY_RESULT, &timestamps[i]);
+    }
+    for (int pass = 0; pass < queued.passCount; pass++) {
+        const char* name = queued.names[pass];
+        GLuint64 start = timestamps[pass * 2], end = std::max(timestamps[pass * 2 + 1], start);
+        int slot = 0;
+        while (slot < stats.passCount && strcmp(stats.passes[slot].name, name) != 0) {
+            slot++;
+        }
+        if (slot == stats.passCount) {
+            if (stats.passCount == GPU_TIMER_MAX_PASSES) {
+                continue;
+            }
+            stats.passes[stats.passCount++].name = name;
+        }
+        double ms = (end - start) / 1e6;
+        GpuPassStats& passStats = stats.passes[slot];
+        passStats.count++;
+        passStats.totalMs += ms;
+        passStats.worstMs = std::max(passStats.worstMs, ms);
+#if A2_PROFILE
+        profilerRecordGpu(name, start, end);
+#endif
+    }
+    double frameMs = (double)(int64_t)(timestamps[queued.passCount * 2 - 1] - timestamps[0]) / 1e6;
+    stats.frames++;
+    stats.totalMs += std::max(frameMs, 0.0);
+    stats.worstMs = std::max(stats.worstMs, frameMs);
+}
+
+void GpuTimer::beginFrame() {
+    if (!created) {
+        return;
+    }
+    frame = (frame + 1) % GPU_TIMER_FRAME_COUNT;
+    collect(frame, false);
+    frames[frame].passCount = 0;
+}
+
+void GpuTimer::beginPass(const char* name) {
+    FrameQueries& current = frames[frame];
+    if (!created || inPass) {
+        return;
+    }
+    if (current.passCount == GPU_TIMER_MAX_PASSES) {
+        stats.overflows++;
+        return;
+    }
+    current.names[current.passCount] = name;
+    glQueryCounter(queries[frame][current.passCount * 2], GL_TIMESTAMP);
+    inPass = true;
+}
+
+void GpuTimer::endPass() {
+    if (!inPass) {
+        return;
+    }
+    FrameQueries& current = frames[frame];
+    glQueryCounter(queries[frame][current.passCount * 2 + 1], GL_TIMESTAMP);
+    current.passCount++;
+    inPass = false;
+}
+
+void GpuTimer::endFrame() {
+    if (!created) {
+        return;
+    }
+    endPass();
+    frames[frame].pending = true;
+}
+
+void GpuTimer::finish() {
+    if (!created) {
+        return;
+    }
+    // Oldest first, so the profiler's GPU lane stays in order
+    for (int i = 1; i <= GPU_TIMER_FRAME_COUNT; i++) {
+        collect((frame + i) % GPU_TIMER_FRAME_COUNT, true);
+    }
+}
+
+void GpuTimer::printStats() const {
+    double perFrame = stats.frames > 0 ? 1.0 / stats.frames : 0.0;
+    std::cout << "GPU time over " << stats.frames << " frames: avg " << stats.totalMs * perFrame << " ms, worst "
+              << stats.worstMs << " ms, " << stats.dropped << " frames dropped, " << stats.overflows << " passes over the limit"
+              << std::endl;
+    for (int i = 0; i < stats.passCount; i++) {
+        const GpuPassStats& pass = stats.passes[i];
+        std::cout << "  " << pass.name << ": avg " << pass.totalMs / pass.count << " ms, worst " << pass.worstMs << " ms over "
+                  << pass.count << " passes" << std::endl;
+    }
+}
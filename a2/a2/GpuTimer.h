@@ -0,0 +1,74 @@
+#pragma once
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+
+// Frames of queries in flight: a frame's results are read when its queries are about to be
+// reused, this many frames later, by which time the GPU has normally finished them
+const int GPU_TIMER_FRAME_COUNT = 3;
+// Passes one frame may time
+const int GPU_TIMER_MAX_PASSES = 8;
+
+// GPU time of one named pass, summed over the frames since the last reset
+struct GpuPassStats {
+    const char* name = nullptr;
+    size_t count = 0;
+    double totalMs = 0.0;
+    double worstMs = 0.0;
+};
+
+// GPU timer counters, summed over the frames since the last reset
+struct GpuTimerStats {
+    size_t frames = 0;        // frames whose results were read
+    double totalMs = 0.0;     // first pass start to last pass end, summed
+    double worstMs = 0.0;
+    size_t dropped = 0;       // frames still unfinished when their queries came round again
+    size_t overflows = 0;     // passes past GPU_TIMER_MAX_PASSES, not timed
+    GpuPassStats passes[GPU_TIMER_MAX_PASSES];
+    int passCount = 0;
+};
+
+// Times render passes on the GPU with GL_TIMESTAMP queries written at each pass's start and end,
+// in a ring of GPU_TIMER_FRAME_COUNT frames of query objects. Results are only read once the ring
+// comes back to a frame, so timing never waits for the GPU; a frame still unfinished then is
+// dropped rather than waited for. Timestamps rather than GL_TIME_ELAPSED, because elapsed queries
+// cannot overlap and carry no position in time: with timestamps each pass also lands on the CPU
+// profiler's timeline, in its GPU lane, at the time the GPU ran it.
+class GpuTimer {
+public:
+    GpuTimer() = default;
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+    ~GpuTimer();
+
+    // Create the queries and line the GPU clock up with the profiler's
+    bool create();
+    void release();
+
+    // Start a frame, reading back the results of the frame whose queries it reuses
+    void beginFrame();
+    // Time the commands issued until endPass(). name must outlive the timer (a literal); passes
+    // with the same name are summed together. Passes do not nest.
+    void beginPass(const char* name);
+    void endPass();
+    void endFrame();
+    // Read back every frame still in flight, waiting for the GPU
+    void finish();
+
+    void printStats() const;
+    GpuTimerStats stats;
+
+private:
+    struct FrameQueries {
+        const char* names[GPU_TIMER_MAX_PASSES] = {};
+        int passCount = 0;
+        bool pending = false;
+    };
+    void collect(int index, bool wait);
+
+    GLuint queries[GPU_TIMER_FRAME_COUNT][GPU_TIMER_MAX_PASSES * 2] = {};
+    FrameQueries frames[GPU_TIMER_FRAME_COUNT];
+    int frame = GPU_TIMER_FRAME_COUNT - 1;
+    bool inPass = false;
+    bool created = false;
+};
@@ -0,0 +1,140 @@
+#include <cstring>
+#include <iostream>
+#include "HeadlessContext.h"
+#ifndef _WIN32
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+HeadlessContext::~HeadlessContext() {
+    release();
+}
+
+bool HeadlessContext::create() {
+#ifdef _WIN32
+    std::cerr << "Headless rendering needs EGL, which is only used on Linux" << std::endl;
+    return false;
+#else
+    release();
+
+    // The surfaceless platform needs neither a display server nor pbuffer support
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    bool surfaceless = clientExtensions && strstr(clientExtensions, "EGL_MESA_platform_surfaceless");
+    EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+    if (surfaceless) {
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay) {
+            eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        }
+    }
+    if (eglDisplay == EGL_NO_DISPLAY) {
+        surfaceless = false;
+        eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, nullptr, nullptr)) {
+        std::cerr << "Failed to initialize EGL" << std::endl;
+        return false;
+    }
+    display = eglDisplay;
+
+    // Surfaceless contexts render only to framebuffer objects, so any config will do
+    EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint configCount = 0;
+    if (!eglBindAPI(EGL_OPENGL_API) || !eglChooseConfig(eglDisplay, configAttributes, &config, 1, &configCount) ||
+        configCount == 0) {
+        std::cerr << "No EGL config for desktop OpenGL" << std::endl;
+        release();
+        return false;
+    }
+
+    EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    context = eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT, contextAttributes);
+    if (context == EGL_NO_CONTEXT) {
+        std::cerr << "Failed to create an OpenGL 3.3 core context" << std::endl;
+        context = nullptr;
+        release();
+        return false;
+    }
+
+    if (!surfaceless) {
+        EGLint pbufferAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        surface = eglCreatePbufferSurface(eglDisplay, config, pbufferAttributes);
+        if (surface == EGL_NO_SURFACE) {
+            std::cerr << "Failed to create an EGL pbuffer" << std::endl;
+            surface = nullptr;
+            release();
+            return false;
+        }
+    }
+    EGLSurface target = surface ? (EGLSurface)surface : EGL_NO_SURFACE;
+    if (!eglMakeCurrent(eglDisplay, target, target, (EGLContext)context)) {
+        std::cerr << "Failed to make the headless context current" << std::endl;
+        release();
+        return false;
+    }
+    return true;
+#endif
+}
+
+bool HeadlessContext::createFramebuffer(int width, int height) {
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glGenRenderbuffers(2, renderbuffers);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Headless framebuffer is incomplete" << std::endl;
+        return false;
+    }
+    glViewport(0, 0, width, height);
+    framebufferWidth = width;
+    framebufferHeight = height;
+    return true;
+}
+
+void HeadlessContext::readPixels(std::vector<unsigned char>& rgb) const {
+    rgb.resize((size_t)framebufferWidth * framebufferHeight * 3);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, framebufferWidth, framebufferHeight, GL_RGB, GL_UNSIGNED_BYTE, rgb.data());
+}
+
+void HeadlessContext::release() {
+#ifndef _WIN32
+    if (framebuffer != 0) {
+        glDeleteRenderbuffers(2, renderbuffers);
+        glDeleteFramebuffers(1, &framebuffer);
+        framebuffer = 0;
+        renderbuffers[0] = renderbuffers[1] = 0;
+    }
+    if (display) {
+        eglMakeCurrent((EGLDisplay)display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (surface) {
+            eglDestroySurface((EGLDisplay)display, (EGLSurface)surface);
+        }
+        if (context) {
+            eglDestroyContext((EGLDisplay)display, (EGLContext)context);
+        }
+        eglTerminate((EGLDisplay)display);
+    }
+    display = context = surface = nullptr;
+    framebufferWidth = framebufferHeight = 0;
+#endif
+}
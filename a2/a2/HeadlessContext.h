@@ -0,0 +1,36 @@
+#pragma once
+#include <GL/glew.h>
+#include <vector>
+
+// A GL 3.3 core context with no window or display, for benchmarking on machines without one
+// (Mesa's llvmpipe on a build farm). The context comes from EGL: the surfaceless platform when
+// the driver offers it, else the default display with a 1x1 pbuffer. Frames are drawn into a
+// framebuffer object of color and depth renderbuffers, which stays bound as the draw target.
+// Linux only; elsewhere create() reports that headless mode is unavailable.
+class HeadlessContext {
+public:
+    HeadlessContext() = default;
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+    ~HeadlessContext();
+
+    // Create the context and make it current
+    bool create();
+    // Once GL is loaded: create and bind the width x height render target and set the viewport
+    bool createFramebuffer(int width, int height);
+    void release();
+
+    // Read the render target back as RGB, rows bottom to top
+    void readPixels(std::vector<unsigned char>& rgb) const;
+
+    int width() const { return framebufferWidth; }
+    int height() const { return framebufferHeight; }
+
+private:
+    void* display = nullptr; // EGLDisplay
+    void* context = nullptr; // EGLContext
+    void* surface = nullptr; // EGLSurface, only without the surfaceless platform
+    GLuint framebuffer = 0;
+    GLuint renderbuffers[2] = {}; // color, depth
+    int framebufferWidth = 0, framebufferHeight = 0;
+};
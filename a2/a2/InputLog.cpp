@@ -0,0 +1,65 @@
+#include <cstring>
+#include <iostream>
+#include "InputLog.h"
+#include "MappedFile.h"
+
+static const char INPUT_LOG_MAGIC[4] = { 'A', '2', 'I', 'L' };
+static const uint32_t INPUT_LOG_VERSION = 1;
+
+struct InputLogHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t frameCount;
+};
+
+// Frames are packed without the struct's padding
+static const size_t INPUT_FRAME_BYTES = sizeof(float) + sizeof(uint16_t);
+
+bool InputLog::save(const std::string& path) const {
+    InputLogHeader header = {};
+    std::memcpy(header.magic, INPUT_LOG_MAGIC, sizeof(header.magic));
+    header.version = INPUT_LOG_VERSION;
+    header.frameCount = (uint32_t)frames.size();
+
+    std::vector<unsigned char> bytes(sizeof(header) + frames.size() * INPUT_FRAME_BYTES);
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    unsigned char* out = bytes.data() + sizeof(header);
+    for (const InputFrame& frame : frames) {
+        std::memcpy(out, &frame.time, sizeof(frame.time));
+        std::memcpy(out + sizeof(frame.time), &frame.keys, sizeof(frame.keys));
+        out += INPUT_FRAME_BYTES;
+    }
+    if (!writeFileAtomically(path, bytes)) {
+        std::cerr << "Failed to write input log " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool InputLog::load(const std::string& path) {
+    frames.clear();
+    MappedFile file;
+    if (!file.open(path)) {
+        std::cerr << "Failed to open input log " << path << std::endl;
+        return false;
+    }
+
+    InputLogHeader header = {};
+    if (file.size() >= sizeof(header)) {
+        std::memcpy(&header, file.data(), sizeof(header));
+    }
+    if (file.size() < sizeof(header) || std::memcmp(header.magic, INPUT_LOG_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != INPUT_LOG_VERSION || file.size() != sizeof(header) + header.frameCount * INPUT_FRAME_BYTES) {
+        std::cerr << "Not a version " << INPUT_LOG_VERSION << " input log: " << path << std::endl;
+        return false;
+    }
+
+    frames.resize(header.frameCount);
+    const unsigned char* in = file.data() + sizeof(header);
+    for (InputFrame& frame : frames) {
+        std::memcpy(&frame.time, in, sizeof(frame.time));
+        std::memcpy(&frame.keys, in + sizeof(frame.time), sizeof(frame.keys));
+        in += INPUT_FRAME_BYTES;
+    }
+    return true;
+}
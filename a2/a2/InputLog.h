@@ -0,0 +1,44 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Keys the viewer reacts to, one bit each in an input frame's key state
+enum InputKey : uint16_t {
+    INPUT_KEY_ESCAPE = 1 << 0,
+    INPUT_KEY_TAB = 1 << 1,
+    INPUT_KEY_W = 1 << 2,
+    INPUT_KEY_S = 1 << 3,
+    INPUT_KEY_A = 1 << 4,
+    INPUT_KEY_D = 1 << 5,
+    INPUT_KEY_Q = 1 << 6,
+    INPUT_KEY_E = 1 << 7,
+    INPUT_KEY_R = 1 << 8,
+    INPUT_KEY_F = 1 << 9,
+    INPUT_KEY_O = 1 << 10
+};
+
+// What the input handler saw in one frame: the keys held and the time its repeat delays use
+struct InputFrame {
+    float time;
+    uint16_t keys;
+};
+
+// Key state of every frame of a run, saved as a small binary log (a header, then 6 bytes per
+// frame). Replaying a log feeds frame i of it to frame i of the run, whatever the wall clock
+// says, so transforms, toggles and dumps happen on exactly the same frames again.
+class InputLog {
+public:
+    void clear() { frames.clear(); }
+    void record(float time, uint16_t keys) { frames.push_back({ time, keys }); }
+
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+
+    size_t size() const { return frames.size(); }
+    const InputFrame& operator[](size_t index) const { return frames[index]; }
+
+private:
+    std::vector<InputFrame> frames;
+};
@@ -0,0 +1,353 @@
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include "InstanceCulling.h"
+#include "Parallel.h"
+
+// x86 builds get the SIMD kernels. GCC and Clang compile the AVX2 one for that target only, so
+// the rest of the binary keeps the baseline ISA and the kernel is picked at run time.
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define CULL_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define CULL_TARGET_AVX2
+#else
+#define CULL_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// Groups per work item when culling on several threads (64K instances)
+static const size_t CULL_CHUNK_GROUPS = 1024;
+
+void computeGroupBounds(InstanceBounds& bounds) {
+    size_t count = bounds.count;
+    size_t groups = (count + CULL_GROUP - 1) / CULL_GROUP;
+    size_t paddedGroups = (groups + CULL_BATCH - 1) / CULL_BATCH * CULL_BATCH;
+    size_t padded = paddedGroups * CULL_GROUP;
+    bounds.x.resize(padded);
+    bounds.y.resize(padded);
+    bounds.z.resize(padded);
+    bounds.radius.resize(padded);
+    bounds.groupX.resize(paddedGroups);
+    bounds.groupY.resize(paddedGroups);
+    bounds.groupZ.resize(paddedGroups);
+    bounds.groupRadius.resize(paddedGroups);
+
+    // A radius of -FLT_MAX puts a sphere outside every plane
+    for (size_t i = count; i < padded; i++) {
+        bounds.x[i] = bounds.y[i] = bounds.z[i] = 0.0f;
+        bounds.radius[i] = -FLT_MAX;
+    }
+
+    // Group spheres around the centre of their members' box
+    for (size_t group = 0; group < paddedGroups; group++) {
+        size_t first = group * CULL_GROUP;
+        size_t last = std::min(count, first + CULL_GROUP);
+        if (first >= last) {
+            bounds.groupX[group] = bounds.groupY[group] = bounds.groupZ[group] = 0.0f;
+            bounds.groupRadius[group] = -FLT_MAX;
+            continue;
+        }
+        glm::vec3 boxMin(FLT_MAX), boxMax(-FLT_MAX);
+        for (size_t i = first; i < last; i++) {
+            glm::vec3 position(bounds.x[i], bounds.y[i], bounds.z[i]);
+            boxMin = glm::min(boxMin, position);
+            boxMax = glm::max(boxMax, position);
+        }
+        glm::vec3 groupCenter = 0.5f * (boxMin + boxMax);
+        float groupRadius = 0.0f;
+        for (size_t i = first; i < last; i++) {
+            groupRadius = std::max(groupRadius, glm::length(glm::vec3(bounds.x[i], bounds.y[i], bounds.z[i]) - groupCenter) + bounds.radius[i]);
+        }
+        bounds.groupX[group] = groupCenter.x;
+        bounds.groupY[group] = groupCenter.y;
+        bounds.groupZ[group] = groupCenter.z;
+        bounds.groupRadius[group] = groupRadius;
+    }
+}
+
+void computeInstanceBounds(const InstanceSet& instances, const glm::vec3& center, float radius, InstanceBounds& bounds) {
+    size_t count = instances.size();
+    bounds.x.resize(count);
+    bounds.y.resize(count);
+    bounds.z.resize(count);
+    bounds.radius.resize(count);
+
+    glm::vec4 centre(center, 1.0f);
+    const InstanceTransform* transforms = instances.data();
+    for (size_t i = 0; i < count; i++) {
+        const InstanceTransform& instance = transforms[i];
+        bounds.x[i] = glm::dot(instance.rows[0], centre);
+        bounds.y[i] = glm::dot(instance.rows[1], centre);
+        bounds.z[i] = glm::dot(instance.rows[2], centre);
+        bounds.radius[i] = radius * glm::length(glm::vec3(instance.rows[0]));
+    }
+
+    bounds.count = count;
+    computeGroupBounds(bounds);
+    bounds.revision = instances.revision();
+    bounds.modelCenter = center;
+    bounds.modelRadius = radius;
+}
+
+const char* cullKernelName(CullKernel kernel) {
+    switch (kernel) {
+    case CullKernel::AVX2: return "AVX2";
+    case CullKernel::SSE: return "SSE";
+    default: return "scalar";
+    }
+}
+
+CullKernel bestCullKernel() {
+#ifdef CULL_X86
+    static const CullKernel best = []() {
+#if defined(_MSC_VER) && !defined(__clang__)
+        // AVX2 needs the CPU flag and the OS saving the YMM registers
+        int info[4];
+        __cpuid(info, 1);
+        bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+        __cpuidex(info, 7, 0);
+        bool avx2 = osSavesYmm && (info[1] & (1 << 5)) != 0;
+#else
+        bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+        return avx2 ? CullKernel::AVX2 : CullKernel::SSE;
+    }();
+    return best;
+#else
+    return CullKernel::Scalar;
+#endif
+}
+
+// Each kernel culls groups [firstGroup, lastGroup), a multiple of CULL_BATCH, writes the indices of
+// the visible instances to out and returns how many there are. A group is outside when its sphere
+// is behind any plane and inside when it is in front of all six. out needs room for every
+// instance of the groups plus CULL_BATCH. All kernels sum the plane distance in the same order, so
+// they keep exactly the same instances.
+
+static size_t cullScalar(const InstanceBounds& bounds, size_t firstGroup, size_t lastGroup, const Frustum& frustum,
+                         uint32_t* out) {
+    size_t visible = 0;
+    for (size_t group = firstGroup; group < lastGroup; group++) {
+        bool outside = false, inside = true;
+        for (const glm::vec4& plane : frustum.planes) {
+            float distance = plane.x * bounds.groupX[group] + plane.y * bounds.groupY[group] + plane.z * bounds.groupZ[group] + plane.w;
+            outside |= distance < -bounds.groupRadius[group];
+            inside &= distance >= bounds.groupRadius[group];
+        }
+        if (outside) {
+            continue;
+        }
+
+        size_t first = group * CULL_GROUP;
+        if (inside) {
+            size_t last = std::min(first + CULL_GROUP, bounds.count);
+            for (size_t i = first; i < last; i++) {
+                out[visible++] = (uint32_t)i;
+            }
+            continue;
+        }
+        for (size_t i = first; i < first + CULL_GROUP; i++) {
+            bool kept = true;
+            for (const glm::vec4& plane : frustum.planes) {
+                kept &= plane.x * bounds.x[i] + plane.y * bounds.y[i] + plane.z * bounds.z[i] + plane.w >= -bounds.radius[i];
+            }
+            out[visible] = (uint32_t)i;
+            visible += kept;
+        }
+    }
+    return visible;
+}
+
+#ifdef CULL_X86
+
+static size_t cullSSE(const InstanceBounds& bounds, size_t firstGroup, size_t lastGroup, const Frustum& frustum,
+                      uint32_t* out) {
+    __m128 planes[6][4];
+    for (int p = 0; p < 6; p++) {
+        for (int k = 0; k < 4; k++) {
+            planes[p][k] = _mm_set1_ps(frustum.planes[p][k]);
+        }
+    }
+    auto distance = [&](int p, __m128 x, __m128 y, __m128 z) {
+        return _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(planes[p][0], x), _mm_mul_ps(planes[p][1], y)),
+                                     _mm_mul_ps(planes[p][2], z)), planes[p][3]);
+    };
+
+    size_t visible = 0;
+    for (size_t g = firstGroup; g < lastGroup; g += 4) {
+        __m128 radius = _mm_loadu_ps(&bounds.groupRadius[g]);
+        __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), radius);
+        __m128 x = _mm_loadu_ps(&bounds.groupX[g]), y = _mm_loadu_ps(&bounds.groupY[g]), z = _mm_loadu_ps(&bounds.groupZ[g]);
+        __m128 outside = _mm_setzero_ps();
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < 6; p++) {
+            __m128 d = distance(p, x, y, z);
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(d, negativeRadius));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(d, radius));
+        }
+        int outsideMask = _mm_movemask_ps(outside), insideMask = _mm_movemask_ps(inside);
+
+        for (int lane = 0; lane < 4; lane++) {
+            if (outsideMask & (1 << lane)) {
+                continue;
+            }
+            size_t first = (g + lane) * CULL_GROUP;
+            if (insideMask & (1 << lane)) {
+                __m128i indices = _mm_add_epi32(_mm_set1_epi32((int)first), _mm_setr_epi32(0, 1, 2, 3));
+                for (size_t k = 0; k < CULL_GROUP; k += 4) {
+                    _mm_storeu_si128((__m128i*)(out + visible + k), indices);
+                    indices = _mm_add_epi32(indices, _mm_set1_epi32(4));
+                }
+                visible += std::min(CULL_GROUP, bounds.count - first);
+                continue;
+            }
+
+            for (size_t i = first; i < first + CULL_GROUP; i += 4) {
+                __m128 instanceNegativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&bounds.radius[i]));
+                __m128 ix = _mm_loadu_ps(&bounds.x[i]), iy = _mm_loadu_ps(&bounds.y[i]), iz = _mm_loadu_ps(&bounds.z[i]);
+                __m128 kept = _mm_castsi128_ps(_mm_set1_epi32(-1));
+                for (int p = 0; p < 6; p++) {
+                    kept = _mm_and_ps(kept, _mm_cmpge_ps(distance(p, ix, iy, iz), instanceNegativeRadius));
+                }
+                for (int mask = _mm_movemask_ps(kept); mask != 0; mask &= mask - 1) {
+                    int bit = 0;
+                    while (!(mask & (1 << bit))) bit++;
+                    out[visible++] = (uint32_t)(i + bit);
+                }
+            }
+        }
+    }
+    return visible;
+}
+
+// For every 8-bit lane mask: the set lanes, packed to the front
+struct CompactTable {
+    uint8_t lanes[256][8];
+    uint8_t counts[256];
+
+    CompactTable() {
+        for (int mask = 0; mask < 256; mask++) {
+            int count = 0;
+            for (int lane = 0; lane < 8; lane++) {
+                if (mask & (1 << lane)) lanes[mask][count++] = (uint8_t)lane;
+            }
+            for (int k = count; k < 8; k++) lanes[mask][k] = 0;
+            counts[mask] = (uint8_t)count;
+        }
+    }
+};
+static const CompactTable COMPACT_TABLE;
+
+CULL_TARGET_AVX2
+static size_t cullAVX2(const InstanceBounds& bounds, size_t firstGroup, size_t lastGroup, const Frustum& frustum,
+                       uint32_t* out) {
+    __m256 planes[6][4];
+    for (int p = 0; p < 6; p++) {
+        for (int k = 0; k < 4; k++) {
+            planes[p][k] = _mm256_set1_ps(frustum.planes[p][k]);
+        }
+    }
+    auto distance = [&](int p, __m256 x, __m256 y, __m256 z) CULL_TARGET_AVX2 {
+        return _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planes[p][0], x), _mm256_mul_ps(planes[p][1], y)),
+                                           _mm256_mul_ps(planes[p][2], z)), planes[p][3]);
+    };
+
+    size_t visible = 0;
+    __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i eight = _mm256_set1_epi32(8);
+    for (size_t g = firstGroup; g < lastGroup; g += 8) {
+        __m256 radius = _mm256_loadu_ps(&bounds.groupRadius[g]);
+        __m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), radius);
+        __m256 x = _mm256_loadu_ps(&bounds.groupX[g]), y = _mm256_loadu_ps(&bounds.groupY[g]), z = _mm256_loadu_ps(&bounds.groupZ[g]);
+        __m256 outside = _mm256_setzero_ps();
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int p = 0; p < 6; p++) {
+            __m256 d = distance(p, x, y, z);
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(d, negativeRadius, _CMP_LT_OQ));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, radius, _CMP_GE_OQ));
+        }
+        int outsideMask = _mm256_movemask_ps(outside), insideMask = _mm256_movemask_ps(inside);
+        if (outsideMask == 0xFF) {
+            continue;
+        }
+
+        for (int lane = 0; lane < 8; lane++) {
+            if (outsideMask & (1 << lane)) {
+                continue;
+            }
+            size_t first = (g + lane) * CULL_GROUP;
+            if (insideMask & (1 << lane)) {
+                __m256i indices = _mm256_add_epi32(_mm256_set1_epi32((int)first), lanes);
+                for (size_t k = 0; k < CULL_GROUP; k += 8) {
+                    _mm256_storeu_si256((__m256i*)(out + visible + k), indices);
+                    indices = _mm256_add_epi32(indices, eight);
+                }
+                visible += std::min(CULL_GROUP, bounds.count - first);
+                continue;
+            }
+
+            // Move the kept lanes' indices to the front and store all 8; the next store overwrites the rest
+            for (size_t i = first; i < first + CULL_GROUP; i += 8) {
+                __m256 instanceNegativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&bounds.radius[i]));
+                __m256 ix = _mm256_loadu_ps(&bounds.x[i]), iy = _mm256_loadu_ps(&bounds.y[i]), iz = _mm256_loadu_ps(&bounds.z[i]);
+                __m256 kept = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+                for (int p = 0; p < 6; p++) {
+                    kept = _mm256_and_ps(kept, _mm256_cmp_ps(distance(p, ix, iy, iz), instanceNegativeRadius, _CMP_GE_OQ));
+                }
+                int mask = _mm256_movemask_ps(kept);
+                __m256i order = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)COMPACT_TABLE.lanes[mask]));
+                __m256i indices = _mm256_add_epi32(_mm256_set1_epi32((int)i), lanes);
+                _mm256_storeu_si256((__m256i*)(out + visible), _mm256_permutevar8x32_epi32(indices, order));
+                visible += COMPACT_TABLE.counts[mask];
+            }
+        }
+    }
+    return visible;
+}
+
+#endif
+
+static size_t cullRange(const InstanceBounds& bounds, size_t firstGroup, size_t lastGroup, const Frustum& frustum,
+                        uint32_t* out, CullKernel kernel) {
+#ifdef CULL_X86
+    if (kernel == CullKernel::AVX2) return cullAVX2(bounds, firstGroup, lastGroup, frustum, out);
+    if (kernel == CullKernel::SSE) return cullSSE(bounds, firstGroup, lastGroup, frustum, out);
+#endif
+    return cullScalar(bounds, firstGroup, lastGroup, frustum, out);
+}
+
+size_t cullInstances(const InstanceBounds& bounds, const Frustum& frustum, VisibleInstances& visible,
+                     unsigned int threads, CullKernel kernel) {
+    size_t groups = bounds.groupX.size();
+    if (visible.indices.size() < bounds.x.size() + CULL_BATCH) {
+        visible.indices.resize(bounds.x.size() + CULL_BATCH);
+    }
+
+    size_t chunks = (groups + CULL_CHUNK_GROUPS - 1) / CULL_CHUNK_GROUPS;
+    if (chunks <= 1 || threads == 1) {
+        visible.count = cullRange(bounds, 0, groups, frustum, visible.indices.data(), kernel);
+        return visible.count;
+    }
+
+    // Chunks write to their own scratch slice, then the slices are packed in order
+    size_t stride = CULL_CHUNK_GROUPS * CULL_GROUP + CULL_BATCH;
+    if (visible.scratch.size() < chunks * stride) {
+        visible.scratch.resize(chunks * stride);
+    }
+    std::vector<size_t> counts(chunks);
+    workerPool().parallelFor(chunks, [&](size_t chunk) {
+        size_t first = chunk * CULL_CHUNK_GROUPS;
+        size_t last = std::min(groups, first + CULL_CHUNK_GROUPS);
+        counts[chunk] = cullRange(bounds, first, last, frustum, visible.scratch.data() + chunk * stride, kernel);
+    }, threads);
+
+    size_t count = 0;
+    for (size_t chunk = 0; chunk < chunks; chunk++) {
+        std::memcpy(visible.indices.data() + count, visible.scratch.data() + chunk * stride, counts[chunk] * sizeof(uint32_t));
+        count += counts[chunk];
+    }
+    visible.count = count;
+    return count;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Instancing.h"
+#include "Meshlets.h"
+
+// Spheres per kernel step
+const size_t CULL_BATCH = 8;
+// Consecutive instances under one group sphere. Groups outside the frustum are skipped and groups
+// inside it are taken whole, so only groups crossing a plane test their instances one by one.
+const size_t CULL_GROUP = 64;
+
+// Instance bounding spheres in SoA form, in the space the instance transforms map into (the
+// fleet's model space, tested against extractFrustum(projection * view * model)), plus one sphere
+// per CULL_GROUP instances. Instances are padded to whole groups and groups to a multiple of
+// CULL_BATCH with spheres no plane accepts, so kernels have no tail.
+struct InstanceBounds {
+    std::vector<float> x, y, z, radius;
+    std::vector<float> groupX, groupY, groupZ, groupRadius;
+    size_t count = 0;
+
+    // What the spheres were computed from, to tell when they are stale
+    uint64_t revision = ~0ull;
+    glm::vec3 modelCenter = glm::vec3(0.0f);
+    float modelRadius = 0.0f;
+
+    bool current(const InstanceSet& instances, const glm::vec3& center, float radius) const {
+        return revision == instances.revision() && modelCenter == center && modelRadius == radius;
+    }
+};
+
+// Pad the first count spheres and build the group spheres over them
+void computeGroupBounds(InstanceBounds& bounds);
+
+// Transform the model's bounding sphere by every instance (rotation, uniform scale, translation)
+void computeInstanceBounds(const InstanceSet& instances, const glm::vec3& center, float radius, InstanceBounds& bounds);
+
+enum class CullKernel {
+    Scalar,
+    SSE,  // 4 spheres per step, SSE2
+    AVX2, // 8 spheres per step, table-driven compaction
+};
+
+// Widest kernel this CPU runs, detected once
+CullKernel bestCullKernel();
+const char* cullKernelName(CullKernel kernel);
+
+// Indices of the visible instances, ascending. The buffers only grow, so steady-state frames
+// allocate nothing; indices may hold stale entries past count.
+struct VisibleInstances {
+    std::vector<uint32_t> indices;
+    size_t count = 0;
+    std::vector<uint32_t> scratch; // per-chunk output when culling on several threads
+};
+
+// Keep the instances whose sphere is not entirely outside one of the six planes. Large sets are
+// split into chunks culled on up to `threads` threads (0 = one per hardware thread).
+size_t cullInstances(const InstanceBounds& bounds, const Frustum& frustum, VisibleInstances& visible,
+                     unsigned int threads = 0, CullKernel kernel = bestCullKernel());
@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <glm/gtc/matrix_transform.hpp>
+#include "Instancing.h"
+
+InstanceTransform packInstanceTransform(const glm::mat4& transform) {
+    glm::mat4 rows = glm::transpose(transform);
+    return { { rows[0], rows[1], rows[2] } };
+}
+
+glm::mat4 unpackInstanceTransform(const InstanceTransform& instance) {
+    return glm::transpose(glm::mat4(instance.rows[0], instance.rows[1], instance.rows[2], glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)));
+}
+
+InstanceHandle InstanceSet::add(const glm::mat4& transform) {
+    uint32_t slot = freeSlots;
+    if (slot != NO_SLOT) {
+        freeSlots = slots[slot];
+    }
+    else {
+        // The all-ones slot is never handed out: at generation 255 its handle is INVALID_INSTANCE
+        if (slots.size() >= SLOT_MASK) {
+            return INVALID_INSTANCE;
+        }
+        slot = (uint32_t)slots.size();
+        slots.push_back(0);
+        generations.push_back(0);
+    }
+
+    changes++;
+    InstanceHandle handle = ((uint32_t)generations[slot] << SLOT_BITS) | slot;
+    slots[slot] = (uint32_t)transforms.size();
+    transforms.push_back(packInstanceTransform(transform));
+    handles.push_back(handle);
+    return handle;
+}
+
+bool InstanceSet::contains(InstanceHandle handle) const {
+    uint32_t slot = handle & SLOT_MASK;
+    if (handle == INVALID_INSTANCE || slot >= slots.size() || generations[slot] != handle >> SLOT_BITS) {
+        return false;
+    }
+    // A free slot holds a free-list link instead of a dense index
+    uint32_t index = slots[slot];
+    return index < handles.size() && handles[index] == handle;
+}
+
+bool InstanceSet::remove(InstanceHandle handle) {
+    if (!contains(handle)) {
+        return false;
+    }
+    changes++;
+    uint32_t slot = handle & SLOT_MASK;
+    uint32_t index = slots[slot];
+
+    // The last instance fills the hole
+    uint32_t last = (uint32_t)transforms.size() - 1;
+    if (index != last) {
+        transforms[index] = transforms[last];
+        handles[index] = handles[last];
+        slots[handles[index] & SLOT_MASK] = index;
+    }
+    transforms.pop_back();
+    handles.pop_back();
+
+    generations[slot]++;
+    slots[slot] = freeSlots;
+    freeSlots = slot;
+    return true;
+}
+
+void InstanceSet::setTransform(InstanceHandle handle, const glm::mat4& transform) {
+    if (contains(handle)) {
+        transforms[slots[handle & SLOT_MASK]] = packInstanceTransform(transform);
+        changes++;
+    }
+}
+
+void InstanceSet::clear() {
+    transforms.clear();
+    handles.clear();
+    slots.clear();
+    generations.clear();
+    freeSlots = NO_SLOT;
+    changes++;
+}
+
+void InstanceSet::reserve(size_t count) {
+    transforms.reserve(count);
+    handles.reserve(count);
+    slots.reserve(count);
+    generations.reserve(count);
+}
+
+void layoutFleet(InstanceSet& instances, uint32_t count, float spacing, uint32_t seed) {
+    instances.clear();
+    instances.reserve(count);
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> yaw(0.0f, glm::two_pi<float>());
+
+    uint32_t side = (uint32_t)std::ceil(std::sqrt((double)count));
+    float origin = -0.5f * spacing * (float)(side - 1);
+    for (uint32_t i = 0; i < count; i++) {
+        glm::vec3 position(origin + spacing * (float)(i % side), 0.0f, origin + spacing * (float)(i / side));
+        glm::mat4 transform = glm::translate(glm::mat4(1.0f), position);
+        instances.add(glm::rotate(transform, yaw(random), glm::vec3(0.0f, 1.0f, 0.0f)));
+    }
+}
+
+void batchInstancesByLod(const InstanceSet& instances, const uint32_t* visible, size_t visibleCount,
+                         const glm::mat4& modelView, const MeshLod* levels, uint32_t levelCount, const glm::vec3& center,
+                         float radius, float viewportHeight, float fovY, InstanceBatches& batches) {
+    size_t count = visible ? visibleCount : instances.size();
+    levelCount = std::min(levelCount, LOD_LEVEL_COUNT);
+
+    // lodPixelsPerUnit per instance without forming modelView * instance: an instance only adds a
+    // rotation and a uniform scale, so the axis scale is the model-view's times the instance's
+    // (exact while the model-view scales uniformly) and only the bounds centre is transformed
+    float baseScale = std::max(glm::length(glm::vec3(modelView[0])),
+                               std::max(glm::length(glm::vec3(modelView[1])), glm::length(glm::vec3(modelView[2]))));
+    float pixelsPerDistance = viewportHeight / (2.0f * std::tan(fovY * 0.5f));
+
+    // Level of every instance, then a counting sort keeps the instances of a level contiguous
+    std::vector<uint8_t>& selected = batches.selected;
+    selected.resize(count);
+    uint32_t counts[LOD_LEVEL_COUNT] = {};
+    const InstanceTransform* instanceData = instances.data();
+    for (size_t i = 0; i < count; i++) {
+        uint32_t level = 0;
+        if (levelCount > 1) {
+            const InstanceTransform& instance = instanceData[visible ? visible[i] : i];
+            glm::vec4 centre(center, 1.0f);
+            glm::vec3 modelCentre(glm::dot(instance.rows[0], centre), glm::dot(instance.rows[1], centre),
+                                  glm::dot(instance.rows[2], centre));
+            float scale = baseScale * glm::length(glm::vec3(instance.rows[0]));
+            float distance = glm::length(glm::vec3(modelView * glm::vec4(modelCentre, 1.0f))) - radius * scale;
+            float pixelsPerUnit = distance > 0.0f ? scale * pixelsPerDistance / distance : std::numeric_limits<float>::max();
+            level = selectLod(levels, levelCount, pixelsPerUnit);
+        }
+        selected[i] = (uint8_t)level;
+        counts[level]++;
+    }
+
+    batches.levelOffsets[0] = 0;
+    for (uint32_t level = 0; level < LOD_LEVEL_COUNT; level++) {
+        batches.levelOffsets[level + 1] = batches.levelOffsets[level] + counts[level];
+    }
+    uint32_t fill[LOD_LEVEL_COUNT];
+    std::copy(batches.levelOffsets, batches.levelOffsets + LOD_LEVEL_COUNT, fill);
+    batches.transforms.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        batches.transforms[fill[selected[i]]++] = instanceData[visible ? visible[i] : i];
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "MeshSimplifier.h"
+
+// First vertex attribute location of the per-instance transform rows (3, 4 and 5)
+const unsigned int INSTANCE_ATTRIBUTE_LOCATION = 3;
+
+// Affine instance transform stored as the three rows of a 3x4 matrix, which is what the instanced
+// vertex attributes read. Instances only rotate, scale uniformly and translate, so the upper 3x3
+// transforms normals as well and no separate normal data is needed.
+struct InstanceTransform {
+    glm::vec4 rows[3];
+};
+static_assert(sizeof(InstanceTransform) == 48, "InstanceTransform is uploaded as three vec4 attributes");
+
+InstanceTransform packInstanceTransform(const glm::mat4& transform);
+glm::mat4 unpackInstanceTransform(const InstanceTransform& instance);
+
+// Stable name of an instance: slot in the low 24 bits, slot generation in the high 8, so the
+// handle of a removed instance does not alias the one that reuses its slot. A set holds at most
+// 2^24 - 1 instances, so no live handle equals INVALID_INSTANCE.
+typedef uint32_t InstanceHandle;
+const InstanceHandle INVALID_INSTANCE = 0xFFFFFFFFu;
+
+// Instances kept in dense arrays that upload as-is. Adding appends; removing moves the last
+// instance into the hole. Both are O(1) and the arrays never have gaps, so the order of
+// instances changes on removal and only handles identify them.
+class InstanceSet {
+public:
+    InstanceHandle add(const glm::mat4& transform);
+    bool remove(InstanceHandle handle);
+    bool contains(InstanceHandle handle) const;
+    void setTransform(InstanceHandle handle, const glm::mat4& transform);
+    void clear();
+    void reserve(size_t count);
+
+    size_t size() const { return transforms.size(); }
+    bool empty() const { return transforms.empty(); }
+    const InstanceTransform* data() const { return transforms.data(); }
+    InstanceHandle handleAt(size_t index) const { return handles[index]; }
+    // Bumped by every change, so derived data (bounds) can tell it is stale
+    uint64_t revision() const { return changes; }
+
+private:
+    static const uint32_t SLOT_BITS = 24;
+    static const uint32_t SLOT_MASK = (1u << SLOT_BITS) - 1;
+    static const uint32_t NO_SLOT = 0xFFFFFFFFu;
+
+    std::vector<InstanceTransform> transforms; // dense
+    std::vector<InstanceHandle> handles;       // dense index -> handle
+    std::vector<uint32_t> slots;               // slot -> dense index, or the next free slot
+    std::vector<uint8_t> generations;          // per slot, bumped on removal
+    uint32_t freeSlots = NO_SLOT;
+    uint64_t changes = 0;
+};
+
+// Replace the set with a square grid of count instances `spacing` apart in the XZ plane,
+// centred on the origin, each turned by a random yaw
+void layoutFleet(InstanceSet& instances, uint32_t count, float spacing, uint32_t seed = 1);
+
+// Instances regrouped by level of detail for one frame: level l draws the transforms
+// [levelOffsets[l], levelOffsets[l + 1]) in a single instanced call per submesh
+struct InstanceBatches {
+    std::vector<InstanceTransform> transforms;
+    uint32_t levelOffsets[LOD_LEVEL_COUNT + 1] = {};
+    std::vector<uint8_t> selected; // level per instance, kept to avoid a per-frame allocation
+};
+
+// Pick a level per instance as lodPixelsPerUnit + selectLod do for a single model (modelView
+// excludes the instance transform) and counting-sort the transforms into per-level ranges.
+// Only the instances listed in `visible` are batched, or all of them when it is null.
+void batchInstancesByLod(const InstanceSet& instances, const uint32_t* visible, size_t visibleCount,
+                         const glm::mat4& modelView, const MeshLod* levels, uint32_t levelCount, const glm::vec3& center,
+                         float radius, float viewportHeight, float fovY, InstanceBatches& batches);
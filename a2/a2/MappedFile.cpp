@@ -0,0 +1,161 @@
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <utility>
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        std::swap(bytes, other.bytes);
+        std::swap(length, other.length);
+        std::swap(opened, other.opened);
+#ifdef _WIN32
+        std::swap(fileHandle, other.fileHandle);
+        std::swap(mappingHandle, other.mappingHandle);
+#endif
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& path) {
+    close();
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        return false;
+    }
+
+    fileHandle = file;
+    length = (size_t)fileSize.QuadPart;
+    opened = true;
+    if (length == 0) {
+        return true; // Empty files cannot be mapped
+    }
+
+    mappingHandle = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mappingHandle == NULL) {
+        close();
+        return false;
+    }
+
+    bytes = (const unsigned char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    if (bytes == nullptr) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close() {
+    if (bytes != nullptr) UnmapViewOfFile(bytes);
+    if (mappingHandle != nullptr) CloseHandle((HANDLE)mappingHandle);
+    if (fileHandle != nullptr) CloseHandle((HANDLE)fileHandle);
+    bytes = nullptr;
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+    length = 0;
+    opened = false;
+}
+
+#else
+
+bool MappedFile::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    length = (size_t)st.st_size;
+    opened = true;
+    if (length > 0) {
+        void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            ::close(fd);
+            length = 0;
+            opened = false;
+            return false;
+        }
+        // Whole-file reads are sequential; let the kernel read ahead aggressively
+        madvise(mapped, length, MADV_SEQUENTIAL);
+        madvise(mapped, length, MADV_WILLNEED);
+        bytes = (const unsigned char*)mapped;
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+    return true;
+}
+
+void MappedFile::close() {
+    if (bytes != nullptr) munmap((void*)bytes, length);
+    bytes = nullptr;
+    length = 0;
+    opened = false;
+}
+
+#endif
+
+static unsigned long currentProcessId() {
+#ifdef _WIN32
+    return (unsigned long)GetCurrentProcessId();
+#else
+    return (unsigned long)getpid();
+#endif
+}
+
+bool writeFileAtomically(const std::string& path, const std::vector<unsigned char>& bytes) {
+    // Unique per process and per call, so two writers of the same path never share a temporary
+    static std::atomic<unsigned int> writeCount(0);
+    std::string tmpPath = path + "." + std::to_string(currentProcessId()) + "." + std::to_string(writeCount++) + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        out.write((const char*)bytes.data(), (std::streamsize)bytes.size());
+        // The last of the data only reaches the file on close, which can fail too (a full disk)
+        out.close();
+        if (!out) {
+            std::error_code ec;
+            std::filesystem::remove(tmpPath, ec);
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, path, ec);
+    if (ec) {
+        std::filesystem::remove(tmpPath, ec);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Read-only memory mapping of a whole file (mmap on POSIX, file mapping objects on Windows)
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen() const { return opened; }
+    const unsigned char* data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    const unsigned char* bytes = nullptr;
+    size_t length = 0;
+    bool opened = false;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
+
+// Write a whole file under a temporary name unique to this process and call, and rename it over
+// path once it is completely written and closed, so readers never see a truncated file
+bool writeFileAtomically(const std::string& path, const std::vector<unsigned char>& bytes);
@@ -0,0 +1,198 @@
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+#include "Mesh.h"
+
+static_assert(sizeof(Vertex) == 9 * sizeof(float), "Vertex must stay tightly packed for bitwise welding");
+static_assert(sizeof(MaterialBlockEntry) == 48, "MaterialBlockEntry must match the std140 layout of the shader");
+
+// Hash the raw bits of the 9 floats of a vertex (64-bit multiply-xorshift mixing)
+static inline uint64_t hashVertex(const Vertex& vertex) {
+    uint32_t words[9];
+    std::memcpy(words, &vertex, sizeof(words));
+
+    uint64_t h = 0x9E3779B97F4A7C15ull;
+    for (uint32_t w : words) {
+        h = (h ^ w) * 0xFF51AFD7ED558CCDull;
+        h ^= h >> 32;
+    }
+    return h;
+}
+
+VertexWelder::VertexWelder(Mesh& mesh, size_t expectedVertices) : mesh(mesh) {
+    // Keep the load factor under 50% for short probe sequences
+    size_t capacity = 16;
+    while (capacity < 2 * (expectedVertices + mesh.vertices.size())) {
+        capacity <<= 1;
+    }
+    slots.assign(capacity, 0);
+    mask = capacity - 1;
+
+    // Vertices already in the mesh take part in welding
+    for (size_t i = 0; i < mesh.vertices.size(); i++) {
+        size_t slot = hashVertex(mesh.vertices[i]) & mask;
+        while (slots[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = (uint32_t)i + 1;
+    }
+}
+
+uint32_t VertexWelder::insert(const Vertex& vertex) {
+    if (2 * (mesh.vertices.size() + 1) > slots.size()) {
+        grow();
+    }
+
+    size_t slot = hashVertex(vertex) & mask;
+    while (slots[slot] != 0) {
+        uint32_t candidate = slots[slot] - 1;
+        if (std::memcmp(&mesh.vertices[candidate], &vertex, sizeof(Vertex)) == 0) {
+            return candidate;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    uint32_t index = (uint32_t)mesh.vertices.size();
+    mesh.vertices.push_back(vertex);
+    slots[slot] = index + 1;
+    return index;
+}
+
+void VertexWelder::grow() {
+    std::vector<uint32_t> old;
+    old.swap(slots);
+    slots.assign(old.size() * 2, 0);
+    mask = slots.size() - 1;
+
+    for (uint32_t entry : old) {
+        if (entry == 0) continue;
+        size_t slot = hashVertex(mesh.vertices[entry - 1]) & mask;
+        while (slots[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = entry;
+    }
+}
+
+Mesh weldVertices(const std::vector<Vertex>& soup) {
+    Mesh mesh;
+    mesh.indices.reserve(soup.size());
+
+    VertexWelder welder(mesh, soup.size() / 4);
+    for (const Vertex& vertex : soup) {
+        welder.emit(vertex);
+    }
+
+    mesh.vertices.shrink_to_fit();
+    return mesh;
+}
+
+std::vector<uint32_t> weldPositions(const std::vector<Vertex>& vertices, size_t& positionCount) {
+    size_t capacity = 16;
+    while (capacity < 2 * vertices.size()) {
+        capacity <<= 1;
+    }
+    std::vector<uint32_t> slots(capacity, 0); // vertex + 1 of the first vertex at a position
+    std::vector<uint32_t> positionOf(vertices.size());
+    positionCount = 0;
+
+    for (size_t v = 0; v < vertices.size(); v++) {
+        uint32_t words[3];
+        std::memcpy(words, &vertices[v].position, sizeof(words));
+        uint64_t h = 0x9E3779B97F4A7C15ull;
+        for (uint32_t w : words) {
+            h = (h ^ w) * 0xFF51AFD7ED558CCDull;
+            h ^= h >> 32;
+        }
+
+        size_t slot = h & (capacity - 1);
+        while (slots[slot] != 0 &&
+               std::memcmp(&vertices[slots[slot] - 1].position, &vertices[v].position, sizeof(glm::vec3)) != 0) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        if (slots[slot] == 0) {
+            slots[slot] = (uint32_t)v + 1;
+            positionOf[v] = (uint32_t)positionCount++;
+        }
+        else {
+            positionOf[v] = positionOf[slots[slot] - 1];
+        }
+    }
+    return positionOf;
+}
+
+void groupSubmeshesByMaterial(Mesh& mesh) {
+    if (mesh.submeshes.size() <= 1) {
+        return;
+    }
+
+    // Collect the runs of every material in order of first use
+    std::unordered_map<int32_t, size_t> groupOf;
+    std::vector<std::vector<const Submesh*>> groups;
+    for (const Submesh& run : mesh.submeshes) {
+        auto inserted = groupOf.emplace(run.materialId, groups.size());
+        if (inserted.second) {
+            groups.emplace_back();
+        }
+        groups[inserted.first->second].push_back(&run);
+    }
+    if (groups.size() == mesh.submeshes.size()) {
+        return; // Already one run per material
+    }
+
+    std::vector<uint32_t> indices;
+    std::vector<Submesh> submeshes;
+    indices.reserve(mesh.indices.size());
+    submeshes.reserve(groups.size());
+    for (const auto& runs : groups) {
+        Submesh grouped = { (uint32_t)indices.size(), 0, runs.front()->materialId };
+        for (const Submesh* run : runs) {
+            indices.insert(indices.end(), mesh.indices.begin() + run->indexOffset,
+                           mesh.indices.begin() + run->indexOffset + run->indexCount);
+            grouped.indexCount += run->indexCount;
+        }
+        submeshes.push_back(grouped);
+    }
+
+    std::cout << "Grouped " << mesh.submeshes.size() << " material runs into " << submeshes.size()
+              << " submeshes" << std::endl;
+    mesh.indices.swap(indices);
+    mesh.submeshes.swap(submeshes);
+}
+
+std::vector<MaterialBlockEntry> packMaterialBlock(const Material* materials, size_t count) {
+    // Default: the plain white look the viewer had before materials were used
+    MaterialBlockEntry fallback;
+    fallback.diffuse = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+    fallback.specular = glm::vec4(0.5f, 0.5f, 0.5f, 32.0f);
+    fallback.emission = glm::vec4(0.0f);
+
+    std::vector<MaterialBlockEntry> block(MAX_MATERIALS, fallback);
+    if (count > (size_t)DEFAULT_MATERIAL_SLOT) {
+        std::cerr << "Only the first " << DEFAULT_MATERIAL_SLOT << " of " << count
+                  << " materials fit in the uniform block" << std::endl;
+        count = DEFAULT_MATERIAL_SLOT;
+    }
+    for (size_t i = 0; i < count; i++) {
+        block[i].diffuse = glm::vec4(materials[i].diffuse, materials[i].dissolve);
+        block[i].specular = glm::vec4(materials[i].specular, materials[i].shininess);
+        block[i].emission = glm::vec4(materials[i].emission, 0.0f);
+    }
+    return block;
+}
+
+void printWeldReport(const std::string& name, size_t soupVertexCount, const Mesh& mesh) {
+    size_t soupBytes = soupVertexCount * sizeof(Vertex);
+    size_t weldedBytes = mesh.vertexBytes() + mesh.indexBytes();
+
+    std::cout << "Vertex welding report for " << name << std::endl;
+    std::cout << "  before: " << soupVertexCount << " vertices, "
+              << soupBytes / 1024.0 << " KiB VBO (glDrawArrays)" << std::endl;
+    std::cout << "  after:  " << mesh.vertices.size() << " vertices + " << mesh.indices.size()
+              << " indices (" << mesh.indexSize() * 8 << "-bit), "
+              << mesh.vertexBytes() / 1024.0 << " KiB VBO + " << mesh.indexBytes() / 1024.0 << " KiB EBO" << std::endl;
+    if (!mesh.vertices.empty() && weldedBytes > 0) {
+        std::cout << "  " << (double)soupVertexCount / mesh.vertices.size() << "x fewer unique vertices, "
+                  << (double)soupBytes / weldedBytes << "x less buffer memory" << std::endl;
+    }
+}
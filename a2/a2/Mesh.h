@@ -0,0 +1,100 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Interleaved vertex layout uploaded to the VBO (36 bytes, no padding)
+struct Vertex {
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec3 color;
+};
+
+// Contiguous range of the index buffer drawn with a single material
+struct Submesh {
+    uint32_t indexOffset;
+    uint32_t indexCount;
+    int32_t materialId; // -1 when the faces have no material
+};
+
+// Shading parameters of an MTL material (plain data so it can be stored in the mesh cache)
+struct Material {
+    char name[64];
+    glm::vec3 diffuse;   // Kd
+    glm::vec3 specular;  // Ks
+    glm::vec3 emission;  // Ke
+    float shininess;     // Ns
+    float dissolve;      // d
+};
+
+// One entry of the fragment shader's Materials uniform block (std140, 48 bytes)
+struct MaterialBlockEntry {
+    glm::vec4 diffuse;  // rgb = Kd, a = d
+    glm::vec4 specular; // rgb = Ks, a = Ns
+    glm::vec4 emission; // rgb = Ke
+};
+
+// Entries in the Materials uniform block (48 * 256 = 12 KiB, under the 16 KiB GL minimum).
+// The last slot holds the default material used by faces without one.
+const size_t MAX_MATERIALS = 256;
+const int32_t DEFAULT_MATERIAL_SLOT = (int32_t)MAX_MATERIALS - 1;
+
+// Indexed triangle list: every 3 indices form one triangle of the vertex array
+struct Mesh {
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<Submesh> submeshes;
+    std::vector<Material> materials;
+    std::vector<std::string> materialLibraries; // every .mtl the source names, found or not, as written
+
+    // 16-bit indices are enough as long as every vertex is addressable by a uint16_t
+    bool fitsUint16Indices() const { return vertices.size() <= 0x10000; }
+    size_t indexSize() const { return fitsUint16Indices() ? sizeof(uint16_t) : sizeof(uint32_t); }
+
+    size_t vertexBytes() const { return vertices.size() * sizeof(Vertex); }
+    size_t indexBytes() const { return indices.size() * indexSize(); }
+};
+
+// Open-addressing hash table that deduplicates vertices as they are emitted.
+// Vertices are compared bitwise, so only exactly identical tuples are welded.
+class VertexWelder {
+public:
+    explicit VertexWelder(Mesh& mesh, size_t expectedVertices = 0);
+
+    // Returns the index of an identical vertex already in the mesh, or appends it
+    uint32_t insert(const Vertex& vertex);
+    // Insert and append the resulting index to mesh.indices
+    void emit(const Vertex& vertex) { mesh.indices.push_back(insert(vertex)); }
+
+private:
+    void grow();
+
+    Mesh& mesh;
+    std::vector<uint32_t> slots; // vertex index + 1, 0 marks an empty slot
+    size_t mask = 0;
+};
+
+// Weld identical (position, normal, color) tuples of an unindexed triangle soup
+// into a compact vertex array plus index buffer
+Mesh weldVertices(const std::vector<Vertex>& soup);
+
+// Id of the distinct position of every vertex (positions compared bitwise), numbered in order of
+// first appearance. Vertices split only by their normal or color then act as one point.
+std::vector<uint32_t> weldPositions(const std::vector<Vertex>& vertices, size_t& positionCount);
+
+// Reorder the triangles so that all faces of a material form one contiguous index range,
+// leaving one submesh per material (in order of first use, faces keep their relative order)
+void groupSubmeshesByMaterial(Mesh& mesh);
+
+// Uniform block slot of a submesh's material
+inline int32_t materialSlot(int32_t materialId) {
+    return materialId >= 0 && materialId < DEFAULT_MATERIAL_SLOT ? materialId : DEFAULT_MATERIAL_SLOT;
+}
+
+// Fill a whole Materials uniform block; materials past the last slot fall back to the default
+std::vector<MaterialBlockEntry> packMaterialBlock(const Material* materials, size_t count);
+
+// Print before/after vertex counts and buffer memory of welding a triangle soup
+void printWeldReport(const std::string& name, size_t soupVertexCount, const Mesh& mesh);
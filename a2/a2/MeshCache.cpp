@@ -0,0 +1,422 @@
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include "MeshCache.h"
+#include "MeshOptimizer.h"
+#include "ModelLoader.h"
+#include "Profiler.h"
+
+namespace fs = std::filesystem;
+
+// On-disk header; every section starts on a 16-byte boundary after it
+struct MeshCacheHeader {
+    char magic[4];
+    uint32_t version;
+    SourceStamp source;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t indexSize;
+    uint32_t submeshCount;
+    uint32_t materialCount;
+    uint32_t vertexSize; // vertex stride at cook time, guards against layout changes
+    uint32_t vertexFormat;
+    uint32_t optimized;
+    uint32_t meshletCount; // 0 when cooked without meshlets
+    uint32_t lodCount;     // 0 when cooked without LODs, else levels of submeshCount ranges each
+    glm::vec3 lodCenter;
+    float lodRadius;
+    PositionQuantization positionQuantization;
+    QuantizationError quantizationError;
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint64_t submeshOffset;
+    uint64_t materialOffset;
+    uint64_t meshletOffset;
+    uint64_t lodOffset;
+    uint64_t lodSubmeshOffset;
+    uint32_t libraryCount;
+    uint32_t libraryPadding;
+    uint64_t libraryOffset;
+    uint64_t fileSize;
+};
+
+// On-disk material library, followed by its name; each one starts on a 16-byte boundary
+struct LibraryEntry {
+    SourceStamp stamp;
+    uint32_t nameLength;
+    uint32_t padding;
+};
+
+static const char MESH_CACHE_MAGIC[4] = { 'A', '2', 'M', 'C' };
+
+static inline uint64_t alignUp(uint64_t offset) {
+    return (offset + 15) & ~(uint64_t)15;
+}
+
+// Word-at-a-time 64-bit hash, fast enough to run over a multi-hundred-MB source at startup
+static uint64_t hashBytes(const unsigned char* data, size_t size) {
+    const uint64_t prime = 0x9E3779B97F4A7C15ull;
+    uint64_t h = size * prime;
+
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        h = (h ^ (word * 0xFF51AFD7ED558CCDull)) * prime;
+        h ^= h >> 29;
+    }
+    for (; i < size; i++) {
+        h = (h ^ data[i]) * prime;
+    }
+    h ^= h >> 32;
+    return h;
+}
+
+std::string meshCachePath(const std::string& sourcePath) {
+    return sourcePath + ".meshcache";
+}
+
+bool stampSource(const std::string& path, SourceStamp& stamp) {
+    std::error_code ec;
+    fs::file_time_type mtime = fs::last_write_time(path, ec);
+    if (ec) {
+        return false;
+    }
+    uintmax_t size = fs::file_size(path, ec);
+    if (ec) {
+        return false;
+    }
+
+    stamp.size = size;
+    stamp.mtime = (int64_t)mtime.time_since_epoch().count();
+    stamp.hash = 0;
+    return true;
+}
+
+bool hashSource(const std::string& path, SourceStamp& stamp) {
+    MappedFile source;
+    if (!source.open(path)) {
+        return false;
+    }
+    stamp.hash = hashBytes(source.data(), source.size());
+    return true;
+}
+
+// Whether a file still matches the stamp a cache recorded. Size and modification time settle it
+// when they match; when only the time differs the file is hashed, once, into current.
+static bool stampMatches(const std::string& path, const SourceStamp& recorded, SourceStamp& current) {
+    if (recorded.size != current.size) {
+        return false;
+    }
+    if (current.size == SOURCE_MISSING || recorded.mtime == current.mtime) {
+        return true;
+    }
+    if (current.hash == 0 && !hashSource(path, current)) {
+        return false;
+    }
+    return recorded.hash == current.hash;
+}
+
+// A material library next to the source, stamped as missing when it cannot be read
+static SourceStamp stampLibrary(const std::string& path) {
+    SourceStamp stamp;
+    if (!stampSource(path, stamp)) {
+        stamp = { SOURCE_MISSING, 0, 0 };
+    }
+    return stamp;
+}
+
+std::vector<unsigned char> cookMesh(const Mesh& mesh, const std::vector<Meshlet>& meshlets, const LodChain& lods,
+                                    const SourceStamp& stamp, const std::vector<LibraryStamp>& libraries,
+                                    const CookSettings& settings) {
+    VertexFormat format = settings.vertexFormat;
+    std::vector<PackedVertex> packed;
+    MeshCacheHeader header = {};
+    header.positionQuantization = { glm::vec3(0.0f), glm::vec3(1.0f) };
+    if (format == VertexFormat::Quantized) {
+        quantizeVertices(mesh.vertices, packed, header.positionQuantization, header.quantizationError);
+    }
+    const void* vertexData = format == VertexFormat::Quantized ? (const void*)packed.data() : (const void*)mesh.vertices.data();
+    size_t vertexBytes = mesh.vertices.size() * vertexStride(format);
+
+    std::memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+    header.version = MESH_CACHE_VERSION;
+    header.source = stamp;
+    header.vertexCount = (uint32_t)mesh.vertices.size();
+    header.indexCount = (uint32_t)mesh.indices.size();
+    header.indexSize = (uint32_t)mesh.indexSize();
+    header.submeshCount = (uint32_t)mesh.submeshes.size();
+    header.materialCount = (uint32_t)mesh.materials.size();
+    header.vertexSize = (uint32_t)vertexStride(format);
+    header.vertexFormat = (uint32_t)format;
+    header.optimized = settings.optimize ? 1 : 0;
+    header.meshletCount = (uint32_t)meshlets.size();
+    header.lodCount = (uint32_t)lods.levels.size();
+    header.lodCenter = lods.center;
+    header.lodRadius = lods.radius;
+
+    header.vertexOffset = alignUp(sizeof(MeshCacheHeader));
+    header.indexOffset = alignUp(header.vertexOffset + vertexBytes);
+    header.submeshOffset = alignUp(header.indexOffset + mesh.indexBytes());
+    header.materialOffset = alignUp(header.submeshOffset + mesh.submeshes.size() * sizeof(Submesh));
+    header.meshletOffset = alignUp(header.materialOffset + mesh.materials.size() * sizeof(Material));
+    header.lodOffset = alignUp(header.meshletOffset + meshlets.size() * sizeof(Meshlet));
+    header.lodSubmeshOffset = alignUp(header.lodOffset + lods.levels.size() * sizeof(MeshLod));
+    header.libraryCount = (uint32_t)libraries.size();
+    header.libraryOffset = alignUp(header.lodSubmeshOffset + lods.submeshes.size() * sizeof(Submesh));
+    header.fileSize = header.libraryOffset;
+    for (const LibraryStamp& library : libraries) {
+        header.fileSize = alignUp(header.fileSize + sizeof(LibraryEntry) + library.name.size());
+    }
+
+    std::vector<unsigned char> blob(header.fileSize, 0);
+    std::memcpy(blob.data(), &header, sizeof(header));
+    if (!mesh.vertices.empty()) {
+        std::memcpy(blob.data() + header.vertexOffset, vertexData, vertexBytes);
+    }
+
+    // Indices are stored in their final EBO format
+    if (mesh.fitsUint16Indices()) {
+        uint16_t* indices16 = (uint16_t*)(blob.data() + header.indexOffset);
+        for (size_t i = 0; i < mesh.indices.size(); i++) {
+            indices16[i] = (uint16_t)mesh.indices[i];
+        }
+    }
+    else if (!mesh.indices.empty()) {
+        std::memcpy(blob.data() + header.indexOffset, mesh.indices.data(), mesh.indexBytes());
+    }
+
+    if (!mesh.submeshes.empty()) {
+        std::memcpy(blob.data() + header.submeshOffset, mesh.submeshes.data(), mesh.submeshes.size() * sizeof(Submesh));
+    }
+    if (!mesh.materials.empty()) {
+        std::memcpy(blob.data() + header.materialOffset, mesh.materials.data(), mesh.materials.size() * sizeof(Material));
+    }
+    if (!meshlets.empty()) {
+        std::memcpy(blob.data() + header.meshletOffset, meshlets.data(), meshlets.size() * sizeof(Meshlet));
+    }
+    if (!lods.levels.empty()) {
+        std::memcpy(blob.data() + header.lodOffset, lods.levels.data(), lods.levels.size() * sizeof(MeshLod));
+        std::memcpy(blob.data() + header.lodSubmeshOffset, lods.submeshes.data(), lods.submeshes.size() * sizeof(Submesh));
+    }
+    uint64_t libraryOffset = header.libraryOffset;
+    for (const LibraryStamp& library : libraries) {
+        LibraryEntry entry = { library.stamp, (uint32_t)library.name.size(), 0 };
+        std::memcpy(blob.data() + libraryOffset, &entry, sizeof(entry));
+        std::memcpy(blob.data() + libraryOffset + sizeof(entry), library.name.data(), library.name.size());
+        libraryOffset = alignUp(libraryOffset + sizeof(entry) + library.name.size());
+    }
+    return blob;
+}
+
+bool writeMeshCache(const std::string& cachePath, const std::vector<unsigned char>& blob) {
+    // A crash mid-write never leaves a truncated cache behind
+    return writeFileAtomically(cachePath, blob);
+}
+
+// Point the cooked mesh streams into a validated cache image
+static bool bindCookedMesh(const unsigned char* data, size_t size, const CookSettings& settings, CookedMesh& cooked) {
+    VertexFormat format = settings.vertexFormat;
+    if (size < sizeof(MeshCacheHeader)) {
+        return false;
+    }
+
+    MeshCacheHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != MESH_CACHE_VERSION || header.vertexFormat != (uint32_t)format ||
+        header.vertexSize != vertexStride(format) || header.optimized != (settings.optimize ? 1u : 0u) ||
+        (header.meshletCount != 0) != settings.buildMeshlets || (header.lodCount != 0) != settings.buildLods ||
+        header.fileSize != size) {
+        return false;
+    }
+    if (header.indexSize != sizeof(uint16_t) && header.indexSize != sizeof(uint32_t)) {
+        return false;
+    }
+
+    // Reject section tables that point outside the file
+    if (header.vertexOffset + (uint64_t)header.vertexCount * header.vertexSize > size ||
+        header.indexOffset + (uint64_t)header.indexCount * header.indexSize > size ||
+        header.submeshOffset + (uint64_t)header.submeshCount * sizeof(Submesh) > size ||
+        header.materialOffset + (uint64_t)header.materialCount * sizeof(Material) > size ||
+        header.meshletOffset + (uint64_t)header.meshletCount * sizeof(Meshlet) > size ||
+        header.lodOffset + (uint64_t)header.lodCount * sizeof(MeshLod) > size ||
+        header.lodSubmeshOffset + (uint64_t)header.lodCount * header.submeshCount * sizeof(Submesh) > size ||
+        header.libraryOffset > size) {
+        return false;
+    }
+
+    cooked.vertices = data + header.vertexOffset;
+    cooked.vertexCount = header.vertexCount;
+    cooked.vertexFormat = format;
+    cooked.vertexStride = header.vertexSize;
+    cooked.positionQuantization = header.positionQuantization;
+    cooked.quantizationError = header.quantizationError;
+    cooked.indices = data + header.indexOffset;
+    cooked.indexCount = header.indexCount;
+    cooked.indexSize = header.indexSize;
+    cooked.submeshes = (const Submesh*)(data + header.submeshOffset);
+    cooked.submeshCount = header.submeshCount;
+    cooked.materials = (const Material*)(data + header.materialOffset);
+    cooked.materialCount = header.materialCount;
+    cooked.meshlets = (const Meshlet*)(data + header.meshletOffset);
+    cooked.meshletCount = header.meshletCount;
+    cooked.lods = (const MeshLod*)(data + header.lodOffset);
+    cooked.lodCount = header.lodCount;
+    cooked.lodSubmeshes = (const Submesh*)(data + header.lodSubmeshOffset);
+    cooked.lodCenter = header.lodCenter;
+    cooked.lodRadius = header.lodRadius;
+    return true;
+}
+
+// Whether the source and every material library it named still match what the cache was cooked from
+static bool sourcesCurrent(const unsigned char* data, size_t size, const std::string& sourcePath, SourceStamp& stamp) {
+    MeshCacheHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (!stampMatches(sourcePath, header.source, stamp)) {
+        return false;
+    }
+
+    std::string directory = modelDirectory(sourcePath);
+    uint64_t offset = header.libraryOffset;
+    for (uint32_t i = 0; i < header.libraryCount; i++) {
+        LibraryEntry entry;
+        if (offset + sizeof(entry) > size) {
+            return false;
+        }
+        std::memcpy(&entry, data + offset, sizeof(entry));
+        if (offset + sizeof(entry) + entry.nameLength > size) {
+            return false;
+        }
+        std::string path = directory + std::string((const char*)data + offset + sizeof(entry), entry.nameLength);
+        SourceStamp current = stampLibrary(path);
+        if (!stampMatches(path, entry.stamp, current)) {
+            return false;
+        }
+        offset = alignUp(offset + sizeof(entry) + entry.nameLength);
+    }
+    return true;
+}
+
+bool openMeshCache(const std::string& sourcePath, SourceStamp& stamp, const CookSettings& settings, CookedMesh& cooked) {
+    MappedFile file;
+    if (!file.open(meshCachePath(sourcePath))) {
+        return false;
+    }
+    if (!bindCookedMesh(file.data(), file.size(), settings, cooked) ||
+        !sourcesCurrent(file.data(), file.size(), sourcePath, stamp)) {
+        return false;
+    }
+    cooked.file = std::move(file);
+    cooked.owned.clear();
+    return true;
+}
+
+bool loadCookedModel(const std::string& sourcePath, CookedMesh& cooked, const CookSettings& settings) {
+    PROFILE_ZONE("loadCookedModel");
+    SourceStamp stamp;
+    if (!stampSource(sourcePath, stamp)) {
+        std::cerr << "Failed to open: " << sourcePath << std::endl;
+        return false;
+    }
+
+    std::string cachePath = meshCachePath(sourcePath);
+    if (openMeshCache(sourcePath, stamp, settings, cooked)) {
+        std::cout << "Loaded mesh cache: " << cachePath << std::endl;
+        if (settings.vertexFormat == VertexFormat::Quantized) {
+            printQuantizationReport(sourcePath, cooked.vertexCount, cooked.quantizationError);
+        }
+        return true;
+    }
+
+    // Cache missing or stale: parse the OBJ text and cook it. Huge sources are streamed
+    // so the intermediate attrib/shape arrays never have to fit in memory.
+    if (stamp.hash == 0 && !hashSource(sourcePath, stamp)) {
+        std::cerr << "Failed to open: " << sourcePath << std::endl;
+        return false;
+    }
+    Mesh mesh = stamp.size > STREAMING_LOAD_THRESHOLD ? loadModelStreaming(sourcePath) : loadIndexedModel(sourcePath);
+    if (mesh.vertices.empty()) {
+        return false;
+    }
+
+    if (settings.optimize) {
+        MeshOptimizationReport report;
+        optimizeMesh(mesh, &report);
+        printOptimizationReport(sourcePath, report);
+    }
+
+    // Meshlets are cut from the final triangle order, so they come after the optimizer
+    std::vector<Meshlet> meshlets;
+    if (settings.buildMeshlets) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        meshlets = buildMeshlets(mesh);
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        printMeshletReport(sourcePath, meshlets, mesh.indices.size() / 3);
+        std::cout << "  built in " << milliseconds << " ms" << std::endl;
+    }
+
+    // LOD levels go after the meshlets: they append to the index buffer, level 0 stays where it is
+    LodChain lods;
+    if (settings.buildLods) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        lods = buildLodChain(mesh);
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        printLodReport(sourcePath, lods.levels.data(), (uint32_t)lods.levels.size(), milliseconds);
+    }
+
+    // The libraries the parse just read, stamped so an edited .mtl invalidates the cache too
+    std::vector<LibraryStamp> libraries;
+    for (const std::string& name : mesh.materialLibraries) {
+        std::string path = modelDirectory(sourcePath) + name;
+        SourceStamp libraryStamp = stampLibrary(path);
+        if (libraryStamp.size != SOURCE_MISSING) {
+            hashSource(path, libraryStamp);
+        }
+        libraries.push_back({ name, libraryStamp });
+    }
+
+    std::vector<unsigned char> blob = cookMesh(mesh, meshlets, lods, stamp, libraries, settings);
+    bool written = writeMeshCache(cachePath, blob) && openMeshCache(sourcePath, stamp, settings, cooked);
+    if (written) {
+        std::cout << "Wrote mesh cache: " << cachePath << std::endl;
+    }
+    else {
+        // Read-only location: keep the cooked image in memory for this run
+        std::cerr << "Could not write mesh cache: " << cachePath << std::endl;
+        cooked.file.close();
+        cooked.owned = std::move(blob);
+        if (!bindCookedMesh(cooked.owned.data(), cooked.owned.size(), settings, cooked)) {
+            return false;
+        }
+    }
+
+    if (settings.vertexFormat == VertexFormat::Quantized) {
+        printQuantizationReport(sourcePath, cooked.vertexCount, cooked.quantizationError);
+    }
+    return true;
+}
+
+Mesh decodeCookedMesh(const CookedMesh& cooked) {
+    Mesh mesh;
+    mesh.vertices.resize(cooked.vertexCount);
+    if (cooked.vertexFormat == VertexFormat::Quantized) {
+        const PackedVertex* packed = (const PackedVertex*)cooked.vertices;
+        for (uint32_t v = 0; v < cooked.vertexCount; v++) {
+            mesh.vertices[v] = unpackVertex(packed[v], cooked.positionQuantization);
+        }
+    }
+    else if (cooked.vertexCount > 0) {
+        std::memcpy(mesh.vertices.data(), cooked.vertices, cooked.vertexBytes());
+    }
+
+    mesh.indices.resize(cooked.indexCount);
+    for (uint32_t i = 0; i < cooked.indexCount; i++) {
+        mesh.indices[i] = cooked.indexSize == sizeof(uint16_t) ? ((const uint16_t*)cooked.indices)[i]
+                                                               : ((const uint32_t*)cooked.indices)[i];
+    }
+    mesh.submeshes.assign(cooked.submeshes, cooked.submeshes + cooked.submeshCount);
+    mesh.materials.assign(cooked.materials, cooked.materials + cooked.materialCount);
+    return mesh;
+}
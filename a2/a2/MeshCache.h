@@ -0,0 +1,98 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+#include "Mesh.h"
+#include "Meshlets.h"
+#include "MeshSimplifier.h"
+#include "VertexFormat.h"
+
+// Bump whenever the cooked layout or the loader output changes so stale caches are rebuilt
+const uint32_t MESH_CACHE_VERSION = 11;
+
+// Size, modification time and content hash of a file a cache was cooked from: the source model
+// and each material library it names. hash is 0 until hashSource computes it.
+struct SourceStamp {
+    uint64_t size;
+    int64_t mtime;
+    uint64_t hash;
+};
+
+// Stamp size of a material library that did not exist at cook time
+const uint64_t SOURCE_MISSING = UINT64_MAX;
+
+// A material library named by the source model (relative to its directory), stamped at cook time
+struct LibraryStamp {
+    std::string name;
+    SourceStamp stamp;
+};
+
+// How a source model is turned into a cache; a cache cooked with other settings is rebuilt
+struct CookSettings {
+    VertexFormat vertexFormat = VertexFormat::Float;
+    bool optimize = true; // vertex cache / overdraw / vertex fetch pass (see MeshOptimizer.h)
+    bool buildMeshlets = false; // cluster side table for per-meshlet culling (see Meshlets.h)
+    bool buildLods = false; // simplified levels appended to the index buffer (see MeshSimplifier.h)
+};
+
+// GPU-ready mesh streams pointing straight into a memory-mapped cache file.
+// When the cache could not be written the same layout is kept in an owned buffer instead.
+struct CookedMesh {
+    const void* vertices = nullptr; // Vertex or PackedVertex elements, see vertexFormat
+    uint32_t vertexCount = 0;
+    VertexFormat vertexFormat = VertexFormat::Float;
+    uint32_t vertexStride = sizeof(Vertex);
+    PositionQuantization positionQuantization = { glm::vec3(0.0f), glm::vec3(1.0f) };
+    QuantizationError quantizationError = {};
+    const void* indices = nullptr; // uint16_t or uint32_t elements, see indexSize
+    uint32_t indexCount = 0;
+    uint32_t indexSize = 0;
+    const Submesh* submeshes = nullptr;
+    uint32_t submeshCount = 0;
+    const Material* materials = nullptr;
+    uint32_t materialCount = 0;
+    const Meshlet* meshlets = nullptr; // in submesh order, empty unless cooked with buildMeshlets
+    uint32_t meshletCount = 0;
+    const MeshLod* lods = nullptr; // finest to coarsest, empty unless cooked with buildLods
+    uint32_t lodCount = 0;
+    const Submesh* lodSubmeshes = nullptr; // submeshCount ranges per level, level-major
+    glm::vec3 lodCenter = glm::vec3(0.0f);
+    float lodRadius = 0.0f;
+
+    size_t vertexBytes() const { return (size_t)vertexCount * vertexStride; }
+    size_t indexBytes() const { return (size_t)indexCount * indexSize; }
+
+    MappedFile file;
+    std::vector<unsigned char> owned;
+};
+
+// Cache file written next to the source model
+std::string meshCachePath(const std::string& sourcePath);
+
+// Size and modification time of a file, false when it cannot be read. Checking a cache needs
+// nothing more unless they changed, so the hash is left at 0 for hashSource to fill in.
+bool stampSource(const std::string& path, SourceStamp& stamp);
+// Hash a whole file into stamp.hash
+bool hashSource(const std::string& path, SourceStamp& stamp);
+
+// Serialize a mesh (and its meshlets and LOD chain, if built) into the versioned cache layout,
+// with vertices in the settings' format. LOD indices must already be appended to mesh.indices.
+// The stamps must be hashed.
+std::vector<unsigned char> cookMesh(const Mesh& mesh, const std::vector<Meshlet>& meshlets, const LodChain& lods,
+                                    const SourceStamp& stamp, const std::vector<LibraryStamp>& libraries,
+                                    const CookSettings& settings);
+// Write a cooked blob to a temporary file and rename it over the cache path
+bool writeMeshCache(const std::string& cachePath, const std::vector<unsigned char>& blob);
+// Map the cache of sourcePath and validate it against the wanted settings, the source and its
+// material libraries. A file whose size and modification time match the cache's stamp is
+// current; one whose time alone changed is hashed and compared by content, which also fills in
+// stamp.hash for the source.
+bool openMeshCache(const std::string& sourcePath, SourceStamp& stamp, const CookSettings& settings, CookedMesh& cooked);
+
+// Load a model through its cache, cooking it from the OBJ text when the cache is missing, stale
+// or was cooked with other settings
+bool loadCookedModel(const std::string& sourcePath, CookedMesh& cooked, const CookSettings& settings = CookSettings());
+
+// Float vertices and 32-bit indices of a cooked mesh, for processing it further at load time
+Mesh decodeCookedMesh(const CookedMesh& cooked);
@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "MeshNormals.h"
+#include "Parallel.h"
+
+// Triangles per work item. The face pass gathers a batch into SoA arrays first, so the cross
+// products, lengths and normalization run as plain loops over floats the compiler vectorizes.
+static const size_t NORMAL_BATCH = 1024;
+
+// Unit face normals (zero for degenerate faces) and the interior angle at each corner
+struct FaceFrames {
+    std::vector<float> x, y, z;
+    std::vector<float> angles; // 3 per triangle
+};
+
+static void computeFaceFrames(const glm::vec3* positions, const uint32_t* cornerPositions, size_t triangleCount,
+                              FaceFrames& faces, unsigned int threads) {
+    faces.x.resize(triangleCount);
+    faces.y.resize(triangleCount);
+    faces.z.resize(triangleCount);
+    faces.angles.resize(triangleCount * 3);
+
+    parallelFor((triangleCount + NORMAL_BATCH - 1) / NORMAL_BATCH, [&](size_t block) {
+        size_t first = block * NORMAL_BATCH;
+        size_t count = std::min(NORMAL_BATCH, triangleCount - first);
+
+        // Edges b - a, c - a and c - b of the batch
+        float e1x[NORMAL_BATCH], e1y[NORMAL_BATCH], e1z[NORMAL_BATCH];
+        float e2x[NORMAL_BATCH], e2y[NORMAL_BATCH], e2z[NORMAL_BATCH];
+        float e3x[NORMAL_BATCH], e3y[NORMAL_BATCH], e3z[NORMAL_BATCH];
+        for (size_t i = 0; i < count; i++) {
+            const uint32_t* corners = cornerPositions + (first + i) * 3;
+            const glm::vec3& a = positions[corners[0]];
+            const glm::vec3& b = positions[corners[1]];
+            const glm::vec3& c = positions[corners[2]];
+            e1x[i] = b.x - a.x; e1y[i] = b.y - a.y; e1z[i] = b.z - a.z;
+            e2x[i] = c.x - a.x; e2y[i] = c.y - a.y; e2z[i] = c.z - a.z;
+            e3x[i] = c.x - b.x; e3y[i] = c.y - b.y; e3z[i] = c.z - b.z;
+        }
+
+        float* nx = faces.x.data() + first;
+        float* ny = faces.y.data() + first;
+        float* nz = faces.z.data() + first;
+        float area[NORMAL_BATCH];
+        for (size_t i = 0; i < count; i++) {
+            float x = e1y[i] * e2z[i] - e1z[i] * e2y[i];
+            float y = e1z[i] * e2x[i] - e1x[i] * e2z[i];
+            float z = e1x[i] * e2y[i] - e1y[i] * e2x[i];
+            float length = std::sqrt(x * x + y * y + z * z);
+            float scale = length > 0.0f ? 1.0f / length : 0.0f;
+            nx[i] = x * scale;
+            ny[i] = y * scale;
+            nz[i] = z * scale;
+            area[i] = length;
+        }
+
+        // Every corner's edge pair spans the same |cross|, so each angle is atan2(|cross|, dot)
+        float* angles = faces.angles.data() + first * 3;
+        for (size_t i = 0; i < count; i++) {
+            float dotA = e1x[i] * e2x[i] + e1y[i] * e2y[i] + e1z[i] * e2z[i];
+            float dotB = -(e1x[i] * e3x[i] + e1y[i] * e3y[i] + e1z[i] * e3z[i]);
+            float dotC = e2x[i] * e3x[i] + e2y[i] * e3y[i] + e2z[i] * e3z[i];
+            angles[i * 3 + 0] = std::atan2(area[i], dotA);
+            angles[i * 3 + 1] = std::atan2(area[i], dotB);
+            angles[i * 3 + 2] = std::atan2(area[i], dotC);
+        }
+    }, threads);
+}
+
+void generateCornerNormals(const glm::vec3* positions, size_t positionCount, const uint32_t* cornerPositions,
+                           size_t triangleCount, const uint32_t* smoothingGroups, float creaseAngle,
+                           glm::vec3* normals, unsigned int threads) {
+    FaceFrames faces;
+    computeFaceFrames(positions, cornerPositions, triangleCount, faces, threads);
+
+    // Position -> triangles, filled in triangle order: this fixes the summation order per corner
+    std::vector<uint32_t> offsets(positionCount + 1, 0);
+    for (size_t i = 0; i < triangleCount * 3; i++) {
+        offsets[cornerPositions[i] + 1]++;
+    }
+    for (size_t p = 0; p < positionCount; p++) {
+        offsets[p + 1] += offsets[p];
+    }
+    std::vector<uint32_t> triangles(triangleCount * 3);
+    {
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < triangleCount * 3; i++) {
+            triangles[fill[cornerPositions[i]]++] = (uint32_t)(i / 3);
+        }
+    }
+
+    float creaseCosine = std::cos(glm::radians(creaseAngle));
+    parallelFor((triangleCount + NORMAL_BATCH - 1) / NORMAL_BATCH, [&](size_t block) {
+        size_t end = std::min(triangleCount, (block + 1) * NORMAL_BATCH);
+        for (size_t t = block * NORMAL_BATCH; t < end; t++) {
+            uint32_t group = smoothingGroups ? smoothingGroups[t] : 1;
+            glm::vec3 face(faces.x[t], faces.y[t], faces.z[t]);
+            bool degenerate = face == glm::vec3(0.0f);
+
+            for (int k = 0; k < 3; k++) {
+                uint32_t position = cornerPositions[t * 3 + k];
+                glm::vec3 sum = group == 0 ? face : glm::vec3(0.0f);
+                for (uint32_t a = offsets[position]; group != 0 && a < offsets[position + 1]; a++) {
+                    uint32_t other = triangles[a];
+                    if (smoothingGroups && smoothingGroups[other] != group) continue;
+                    glm::vec3 otherFace(faces.x[other], faces.y[other], faces.z[other]);
+                    // A degenerate face has no crease to respect and takes whatever surrounds it
+                    if (!degenerate && glm::dot(face, otherFace) < creaseCosine) continue;
+
+                    const uint32_t* corners = cornerPositions + (size_t)other * 3;
+                    int corner = corners[0] == position ? 0 : corners[1] == position ? 1 : 2;
+                    sum += faces.angles[(size_t)other * 3 + corner] * otherFace;
+                }
+
+                float length = glm::length(sum);
+                normals[t * 3 + k] = length > 0.0f ? sum / length : glm::vec3(0.0f, 0.0f, 1.0f);
+            }
+        }
+    }, threads);
+}
+
+void generateMissingNormals(Mesh& mesh, float creaseAngle) {
+    std::vector<uint8_t> missing(mesh.vertices.size(), 0);
+    bool anyMissing = false;
+    for (size_t v = 0; v < mesh.vertices.size(); v++) {
+        missing[v] = mesh.vertices[v].normal == glm::vec3(0.0f);
+        anyMissing |= missing[v] != 0;
+    }
+    if (!anyMissing) {
+        return;
+    }
+
+    size_t positionCount = 0;
+    std::vector<uint32_t> positionOf = weldPositions(mesh.vertices, positionCount);
+    std::vector<glm::vec3> positions(positionCount);
+    for (size_t v = 0; v < mesh.vertices.size(); v++) {
+        positions[positionOf[v]] = mesh.vertices[v].position;
+    }
+
+    size_t triangleCount = mesh.indices.size() / 3;
+    std::vector<uint32_t> cornerPositions(triangleCount * 3);
+    for (size_t i = 0; i < cornerPositions.size(); i++) {
+        cornerPositions[i] = positionOf[mesh.indices[i]];
+    }
+    std::vector<glm::vec3> normals(cornerPositions.size());
+    generateCornerNormals(positions.data(), positionCount, cornerPositions.data(), triangleCount, nullptr, creaseAngle,
+                          normals.data());
+
+    // Weld again with the new normals; corners keep their place in the index buffer
+    Mesh source;
+    source.vertices.swap(mesh.vertices);
+    source.indices.swap(mesh.indices);
+    mesh.indices.reserve(source.indices.size());
+    VertexWelder welder(mesh, source.vertices.size());
+    for (size_t i = 0; i < source.indices.size(); i++) {
+        Vertex vertex = source.vertices[source.indices[i]];
+        if (missing[source.indices[i]]) {
+            vertex.normal = normals[i];
+        }
+        welder.emit(vertex);
+    }
+    mesh.vertices.shrink_to_fit();
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include "Mesh.h"
+
+// Faces meeting at a sharper angle than this (in degrees) keep separate normals along their edge
+const float NORMAL_CREASE_ANGLE = 60.0f;
+
+// Angle-weighted normal of every corner of a triangle list. cornerPositions holds 3 indices into
+// positions per triangle; corners with the same index are the same point. A corner averages the
+// faces around its point that are in its triangle's smoothing group and within creaseAngle of
+// its own face. Group 0 shades flat; smoothingGroups may be null to put every face in one group.
+// Each corner sums its neighbours in triangle order, so the output is the same for any thread count.
+void generateCornerNormals(const glm::vec3* positions, size_t positionCount, const uint32_t* cornerPositions,
+                           size_t triangleCount, const uint32_t* smoothingGroups, float creaseAngle,
+                           glm::vec3* normals, unsigned int threads = 0);
+
+// Replace the zero normals of a mesh (faces without vn in the OBJ) with generated ones, all faces
+// in one smoothing group. Positions are welded by value so faces still smooth across color seams;
+// vertices whose corners end up with different normals are split. Index ranges are unchanged.
+void generateMissingNormals(Mesh& mesh, float creaseAngle = NORMAL_CREASE_ANGLE);
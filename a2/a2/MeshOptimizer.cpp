@@ -0,0 +1,385 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include "MeshOptimizer.h"
+#include "Parallel.h"
+
+VertexCacheStats analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+                                    unsigned int cacheSize) {
+    VertexCacheStats stats;
+    stats.triangles = indexCount / 3;
+
+    // FIFO cache as timestamps: a vertex is resident while fewer than cacheSize misses happened since its own
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<bool> referenced(vertexCount, false);
+    uint32_t timestamp = cacheSize + 1;
+    for (size_t i = 0; i < stats.triangles * 3; i++) {
+        uint32_t v = indices[i];
+        if (timestamp - cacheTime[v] > cacheSize) {
+            cacheTime[v] = timestamp++;
+            stats.transforms++;
+        }
+        if (!referenced[v]) {
+            referenced[v] = true;
+            stats.vertices++;
+        }
+    }
+
+    stats.acmr = stats.triangles ? (float)stats.transforms / stats.triangles : 0.0f;
+    stats.atvr = stats.vertices ? (float)stats.transforms / stats.vertices : 0.0f;
+    return stats;
+}
+
+// Depth-tested rasterization of the triangles, in order, into one orthographic view
+static void rasterizeView(const uint32_t* indices, size_t indexCount, const Vertex* vertices, int axis, float direction,
+                          const glm::vec3& minimum, float scale, std::vector<float>& depth, size_t& shaded) {
+    const int size = OVERDRAW_VIEW_SIZE;
+    const int uAxis = (axis + 1) % 3, vAxis = (axis + 2) % 3;
+
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        glm::vec3 p[3];
+        for (int k = 0; k < 3; k++) {
+            glm::vec3 position = vertices[indices[i + k]].position - minimum;
+            // Closer to the viewer = smaller depth
+            p[k] = glm::vec3(position[uAxis] * scale, position[vAxis] * scale, -direction * position[axis]);
+        }
+
+        float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[1].y - p[0].y) * (p[2].x - p[0].x);
+        if (area == 0.0f) {
+            continue;
+        }
+        if (area < 0.0f) {
+            // No culling: rasterize back faces with the winding flipped
+            std::swap(p[1], p[2]);
+            area = -area;
+        }
+
+        int x0 = std::max(0, (int)std::floor(std::min(p[0].x, std::min(p[1].x, p[2].x))));
+        int x1 = std::min(size - 1, (int)std::ceil(std::max(p[0].x, std::max(p[1].x, p[2].x))));
+        int y0 = std::max(0, (int)std::floor(std::min(p[0].y, std::min(p[1].y, p[2].y))));
+        int y1 = std::min(size - 1, (int)std::ceil(std::max(p[0].y, std::max(p[1].y, p[2].y))));
+
+        for (int y = y0; y <= y1; y++) {
+            float py = y + 0.5f;
+            for (int x = x0; x <= x1; x++) {
+                float px = x + 0.5f;
+                float w0 = (p[2].x - p[1].x) * (py - p[1].y) - (p[2].y - p[1].y) * (px - p[1].x);
+                float w1 = (p[0].x - p[2].x) * (py - p[2].y) - (p[0].y - p[2].y) * (px - p[2].x);
+                float w2 = (p[1].x - p[0].x) * (py - p[0].y) - (p[1].y - p[0].y) * (px - p[0].x);
+                if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f) {
+                    continue;
+                }
+
+                float z = (w0 * p[0].z + w1 * p[1].z + w2 * p[2].z) / area;
+                float& stored = depth[(size_t)y * size + x];
+                if (z < stored) {
+                    stored = z;
+                    shaded++;
+                }
+            }
+        }
+    }
+}
+
+OverdrawStats analyzeOverdraw(const uint32_t* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount) {
+    OverdrawStats stats;
+    if (vertexCount == 0 || indexCount < 3) {
+        return stats;
+    }
+
+    glm::vec3 minimum = vertices[0].position, maximum = vertices[0].position;
+    for (size_t i = 1; i < vertexCount; i++) {
+        minimum = glm::min(minimum, vertices[i].position);
+        maximum = glm::max(maximum, vertices[i].position);
+    }
+    glm::vec3 extent = maximum - minimum;
+    float largest = std::max(extent.x, std::max(extent.y, extent.z));
+    if (largest <= 0.0f) {
+        return stats;
+    }
+    // One uniform scale keeps the aspect ratio in every view
+    float scale = (OVERDRAW_VIEW_SIZE - 1) / largest;
+
+    const float infinity = std::numeric_limits<float>::infinity();
+    std::vector<float> depth((size_t)OVERDRAW_VIEW_SIZE * OVERDRAW_VIEW_SIZE);
+    for (int axis = 0; axis < 3; axis++) {
+        for (float direction : { 1.0f, -1.0f }) {
+            std::fill(depth.begin(), depth.end(), infinity);
+            rasterizeView(indices, indexCount, vertices, axis, direction, minimum, scale, depth, stats.pixelsShaded);
+            for (float z : depth) {
+                stats.pixelsCovered += z < infinity;
+            }
+        }
+    }
+
+    stats.overdraw = stats.pixelsCovered ? (float)stats.pixelsShaded / stats.pixelsCovered : 0.0f;
+    return stats;
+}
+
+void optimizeVertexCache(uint32_t* destination, const uint32_t* indices, size_t indexCount, size_t vertexCount,
+                         std::vector<uint32_t>* hardBoundaries, unsigned int cacheSize) {
+    size_t faceCount = indexCount / 3;
+    if (hardBoundaries) {
+        hardBoundaries->assign(1, 0);
+    }
+    if (faceCount == 0) {
+        return;
+    }
+
+    // Triangles around every vertex, and how many of them are still to be emitted
+    std::vector<uint32_t> liveCount(vertexCount, 0), adjacencyOffset(vertexCount + 1, 0);
+    for (size_t i = 0; i < faceCount * 3; i++) {
+        liveCount[indices[i]]++;
+    }
+    for (size_t v = 0; v < vertexCount; v++) {
+        adjacencyOffset[v + 1] = adjacencyOffset[v] + liveCount[v];
+    }
+    std::vector<uint32_t> adjacency(faceCount * 3);
+    std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+    for (size_t i = 0; i < faceCount * 3; i++) {
+        adjacency[fill[indices[i]]++] = (uint32_t)(i / 3);
+    }
+
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(faceCount, false);
+    std::vector<uint32_t> deadEnd, candidates;
+    deadEnd.reserve(faceCount * 3);
+
+    const uint32_t none = std::numeric_limits<uint32_t>::max();
+    uint32_t timestamp = cacheSize + 1;
+    size_t cursor = 0; // next vertex to try once the dead-end stack runs dry
+    size_t written = 0;
+    uint32_t fanning = indices[0];
+
+    while (fanning != none) {
+        // Emit every remaining triangle around the fanning vertex
+        candidates.clear();
+        for (uint32_t a = adjacencyOffset[fanning]; a < adjacencyOffset[fanning + 1]; a++) {
+            uint32_t face = adjacency[a];
+            if (emitted[face]) continue;
+            emitted[face] = true;
+
+            for (int k = 0; k < 3; k++) {
+                uint32_t v = indices[face * 3 + k];
+                destination[written++] = v;
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                liveCount[v]--;
+                if (timestamp - cacheTime[v] > cacheSize) {
+                    cacheTime[v] = timestamp++;
+                }
+            }
+        }
+
+        // Next fanning vertex: the oldest candidate that will still be in the cache after its fan
+        uint32_t next = none;
+        int bestPriority = -1;
+        for (uint32_t v : candidates) {
+            if (liveCount[v] == 0) continue;
+            int priority = 0;
+            if (timestamp - cacheTime[v] + 2 * liveCount[v] <= cacheSize) {
+                priority = (int)(timestamp - cacheTime[v]);
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                next = v;
+            }
+        }
+
+        // Dead end: back up to a recently used vertex, or jump to the next unfinished one
+        while (next == none && !deadEnd.empty()) {
+            uint32_t v = deadEnd.back();
+            deadEnd.pop_back();
+            if (liveCount[v] > 0) next = v;
+        }
+        if (next == none) {
+            while (cursor < vertexCount && liveCount[cursor] == 0) {
+                cursor++;
+            }
+            if (cursor < vertexCount) {
+                next = (uint32_t)cursor;
+                if (hardBoundaries) hardBoundaries->push_back((uint32_t)(written / 3));
+            }
+        }
+        fanning = next;
+    }
+}
+
+void optimizeOverdraw(uint32_t* indices, size_t indexCount, const Vertex* vertices,
+                      const std::vector<uint32_t>& hardBoundaries, float threshold, unsigned int cacheSize) {
+    size_t faceCount = indexCount / 3;
+    if (faceCount < 2) {
+        return;
+    }
+    uint32_t vertexCount = *std::max_element(indices, indices + faceCount * 3) + 1;
+
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    uint32_t timestamp = cacheSize + 1;
+    auto triangleMisses = [&](size_t face) {
+        uint32_t misses = 0;
+        for (int k = 0; k < 3; k++) {
+            uint32_t v = indices[face * 3 + k];
+            if (timestamp - cacheTime[v] > cacheSize) {
+                cacheTime[v] = timestamp++;
+                misses++;
+            }
+        }
+        return misses;
+    };
+    // Moving the clock past every stored time empties the cache
+    auto flushCache = [&]() { timestamp += cacheSize + 1; };
+
+    // Split each hard cluster wherever the running ACMR has dropped to within threshold of the cluster's
+    std::vector<size_t> clusters;
+    for (size_t h = 0; h < hardBoundaries.size(); h++) {
+        size_t begin = hardBoundaries[h];
+        size_t end = h + 1 < hardBoundaries.size() ? hardBoundaries[h + 1] : faceCount;
+        if (begin >= end) continue;
+
+        flushCache();
+        size_t clusterMisses = 0;
+        for (size_t f = begin; f < end; f++) {
+            clusterMisses += triangleMisses(f);
+        }
+        float limit = threshold * clusterMisses / (end - begin);
+
+        flushCache();
+        clusters.push_back(begin);
+        size_t start = begin, misses = 0;
+        for (size_t f = begin; f + 1 < end; f++) {
+            misses += triangleMisses(f);
+            if ((float)misses / (f + 1 - start) <= limit) {
+                clusters.push_back(f + 1);
+                start = f + 1;
+                misses = 0;
+                flushCache();
+            }
+        }
+    }
+    if (clusters.size() < 2) {
+        return;
+    }
+
+    // Sort key: how much a cluster faces away from the mesh centre (area-weighted centroid and normal)
+    std::vector<glm::vec3> centroid(clusters.size(), glm::vec3(0.0f)), normal(clusters.size(), glm::vec3(0.0f));
+    std::vector<float> area(clusters.size(), 0.0f);
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t c = 0; c < clusters.size(); c++) {
+        size_t end = c + 1 < clusters.size() ? clusters[c + 1] : faceCount;
+        for (size_t f = clusters[c]; f < end; f++) {
+            const glm::vec3& a = vertices[indices[f * 3 + 0]].position;
+            const glm::vec3& b = vertices[indices[f * 3 + 1]].position;
+            const glm::vec3& d = vertices[indices[f * 3 + 2]].position;
+            glm::vec3 cross = glm::cross(b - a, d - a);
+            float faceArea = glm::length(cross);
+            centroid[c] += (a + b + d) * (faceArea / 3.0f);
+            normal[c] += cross;
+            area[c] += faceArea;
+        }
+        meshCentroid += centroid[c];
+        meshArea += area[c];
+    }
+    if (meshArea > 0.0f) {
+        meshCentroid /= meshArea;
+    }
+
+    std::vector<float> key(clusters.size(), 0.0f);
+    std::vector<size_t> order(clusters.size());
+    for (size_t c = 0; c < clusters.size(); c++) {
+        order[c] = c;
+        float length = glm::length(normal[c]);
+        if (area[c] > 0.0f && length > 0.0f) {
+            key[c] = glm::dot(centroid[c] / area[c] - meshCentroid, normal[c] / length);
+        }
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return key[a] > key[b]; });
+
+    std::vector<uint32_t> sorted;
+    sorted.reserve(faceCount * 3);
+    for (size_t c : order) {
+        size_t end = c + 1 < clusters.size() ? clusters[c + 1] : faceCount;
+        sorted.insert(sorted.end(), indices + clusters[c] * 3, indices + end * 3);
+    }
+    std::copy(sorted.begin(), sorted.end(), indices);
+}
+
+void optimizeVertexFetch(Mesh& mesh) {
+    const uint32_t unused = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> remap(mesh.vertices.size(), unused);
+    std::vector<Vertex> vertices;
+    vertices.reserve(mesh.vertices.size());
+
+    for (uint32_t& index : mesh.indices) {
+        if (remap[index] == unused) {
+            remap[index] = (uint32_t)vertices.size();
+            vertices.push_back(mesh.vertices[index]);
+        }
+        index = remap[index];
+    }
+    mesh.vertices.swap(vertices);
+}
+
+// Cache and overdraw reordering of one submesh, on compact local vertex ids so the
+// per-vertex tables are sized by the submesh rather than the whole mesh
+static void optimizeSubmesh(Mesh& mesh, const Submesh& submesh) {
+    size_t indexCount = submesh.indexCount - submesh.indexCount % 3;
+    if (indexCount < 6) {
+        return;
+    }
+    uint32_t* indices = mesh.indices.data() + submesh.indexOffset;
+
+    std::vector<uint32_t> globalOf(indices, indices + indexCount);
+    std::sort(globalOf.begin(), globalOf.end());
+    globalOf.erase(std::unique(globalOf.begin(), globalOf.end()), globalOf.end());
+
+    std::vector<uint32_t> local(indexCount);
+    for (size_t i = 0; i < indexCount; i++) {
+        local[i] = (uint32_t)(std::lower_bound(globalOf.begin(), globalOf.end(), indices[i]) - globalOf.begin());
+    }
+    std::vector<Vertex> vertices(globalOf.size());
+    for (size_t v = 0; v < globalOf.size(); v++) {
+        vertices[v] = mesh.vertices[globalOf[v]];
+    }
+
+    std::vector<uint32_t> reordered(indexCount);
+    std::vector<uint32_t> hardBoundaries;
+    optimizeVertexCache(reordered.data(), local.data(), indexCount, globalOf.size(), &hardBoundaries);
+    optimizeOverdraw(reordered.data(), indexCount, vertices.data(), hardBoundaries);
+
+    for (size_t i = 0; i < indexCount; i++) {
+        indices[i] = globalOf[reordered[i]];
+    }
+}
+
+void optimizeMesh(Mesh& mesh, MeshOptimizationReport* report) {
+    if (report) {
+        report->submeshes = mesh.submeshes.size();
+        report->cacheBefore = analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+        report->overdrawBefore = analyzeOverdraw(mesh.indices.data(), mesh.indices.size(), mesh.vertices.data(), mesh.vertices.size());
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // Submeshes own disjoint index ranges and only read the shared vertices
+    parallelFor(mesh.submeshes.size(), [&](size_t s) { optimizeSubmesh(mesh, mesh.submeshes[s]); });
+    optimizeVertexFetch(mesh);
+
+    if (report) {
+        report->milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        report->cacheAfter = analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+        report->overdrawAfter = analyzeOverdraw(mesh.indices.data(), mesh.indices.size(), mesh.vertices.data(), mesh.vertices.size());
+    }
+}
+
+void printOptimizationReport(const std::string& name, const MeshOptimizationReport& report) {
+    std::cout << "Mesh optimization report for " << name << " (" << report.submeshes << " submeshes, "
+              << report.milliseconds << " ms)" << std::endl;
+    std::cout << "  ACMR " << report.cacheBefore.acmr << " -> " << report.cacheAfter.acmr
+              << ", ATVR " << report.cacheBefore.atvr << " -> " << report.cacheAfter.atvr
+              << " (" << VERTEX_CACHE_SIZE << "-entry FIFO)" << std::endl;
+    std::cout << "  overdraw " << report.overdrawBefore.overdraw << " -> " << report.overdrawAfter.overdraw
+              << " (" << report.overdrawAfter.pixelsCovered << " pixels covered in 6 views)" << std::endl;
+}
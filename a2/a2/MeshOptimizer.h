@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "Mesh.h"
+
+// FIFO post-transform cache size the reordering targets and the statistics simulate
+const unsigned int VERTEX_CACHE_SIZE = 16;
+
+// Resolution of each of the 6 axis-aligned views rasterized by the overdraw simulator
+const int OVERDRAW_VIEW_SIZE = 256;
+
+// Post-transform vertex cache efficiency of an index buffer (FIFO cache simulation)
+struct VertexCacheStats {
+    size_t triangles = 0;
+    size_t vertices = 0;   // distinct vertices referenced
+    size_t transforms = 0; // cache misses = vertex shader invocations
+    float acmr = 0.0f;     // transforms per triangle (0.5 is ideal on large grids, 3 is worst)
+    float atvr = 0.0f;     // transforms per referenced vertex (1 is ideal)
+};
+
+// Depth-tested fragments versus covered pixels, summed over 6 orthographic views.
+// No faces are culled, matching the viewer.
+struct OverdrawStats {
+    size_t pixelsCovered = 0;
+    size_t pixelsShaded = 0;
+    float overdraw = 0.0f; // shaded / covered (1 is ideal)
+};
+
+struct MeshOptimizationReport {
+    VertexCacheStats cacheBefore, cacheAfter;
+    OverdrawStats overdrawBefore, overdrawAfter;
+    size_t submeshes = 0;
+    double milliseconds = 0.0; // optimization time, analysis excluded
+};
+
+VertexCacheStats analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+                                    unsigned int cacheSize = VERTEX_CACHE_SIZE);
+OverdrawStats analyzeOverdraw(const uint32_t* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount);
+
+// Tipsify (Sander et al. 2007): reorder triangles for the post-transform cache.
+// Also returns the offsets (in triangles) where the walk had to jump to a new region.
+void optimizeVertexCache(uint32_t* destination, const uint32_t* indices, size_t indexCount, size_t vertexCount,
+                         std::vector<uint32_t>* hardBoundaries = nullptr, unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+// Split a cache-optimized index buffer into clusters that keep the cache efficiency within
+// `threshold` of the original and sort them so outward facing clusters are drawn first
+void optimizeOverdraw(uint32_t* indices, size_t indexCount, const Vertex* vertices,
+                      const std::vector<uint32_t>& hardBoundaries, float threshold = 1.05f,
+                      unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+// Reorder the vertex buffer into first-use order of the index buffer and remap the indices.
+// Unreferenced vertices are dropped.
+void optimizeVertexFetch(Mesh& mesh);
+
+// Full pass: cache and overdraw reordering of every submesh (in parallel), then the vertex fetch remap.
+// Fills the before/after statistics when a report is given.
+void optimizeMesh(Mesh& mesh, MeshOptimizationReport* report = nullptr);
+
+void printOptimizationReport(const std::string& name, const MeshOptimizationReport& report);
@@ -0,0 +1,550 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "Parallel.h"
+
+static_assert(sizeof(MeshLod) == 3 * sizeof(uint32_t), "MeshLod is stored verbatim in the mesh cache");
+
+// Weight of the attribute term against the squared distance term of a collapse cost.
+// The attribute distance is scaled by the squared edge length, so short edges across a seam
+// stay cheap while long ones that would smear a hard edge over a large area do not.
+static const float ATTRIBUTE_WEIGHT = 0.5f;
+
+// Collapses may not turn an adjacent triangle by more than ~75 degrees
+static const float FLIP_COSINE = 0.25f;
+
+// A pass only takes collapses up to this multiple of the cost its goal would reach
+static const float COST_SLACK = 1.5f;
+
+// A level is done within this fraction of its target triangle count, or once this many passes
+// in a row managed less than an eighth of what they set out to do (the flip test and the locked
+// borders leave only slow progress there)
+static const float TARGET_TOLERANCE = 0.02f;
+static const int STALLED_PASSES = 3;
+
+// Symmetric 4x4 quadric of area-weighted plane distances, plus the total weight
+struct Quadric {
+    float a00, a01, a02, a03;
+    float a11, a12, a13;
+    float a22, a23;
+    float a33;
+    float weight;
+};
+
+static void addPlane(Quadric& q, const glm::vec3& n, float d, float weight) {
+    q.a00 += weight * n.x * n.x;
+    q.a01 += weight * n.x * n.y;
+    q.a02 += weight * n.x * n.z;
+    q.a03 += weight * n.x * d;
+    q.a11 += weight * n.y * n.y;
+    q.a12 += weight * n.y * n.z;
+    q.a13 += weight * n.y * d;
+    q.a22 += weight * n.z * n.z;
+    q.a23 += weight * n.z * d;
+    q.a33 += weight * d * d;
+    q.weight += weight;
+}
+
+static void addQuadric(Quadric& q, const Quadric& r) {
+    float* dst = &q.a00;
+    const float* src = &r.a00;
+    for (int i = 0; i < 11; i++) {
+        dst[i] += src[i];
+    }
+}
+
+// Weighted mean squared distance of p to the accumulated planes
+static float quadricError(const Quadric& q, const glm::vec3& p) {
+    float rx = q.a00 * p.x + q.a01 * p.y + q.a02 * p.z + q.a03;
+    float ry = q.a01 * p.x + q.a11 * p.y + q.a12 * p.z + q.a13;
+    float rz = q.a02 * p.x + q.a12 * p.y + q.a22 * p.z + q.a23;
+    float r = rx * p.x + ry * p.y + rz * p.z + q.a03 * p.x + q.a13 * p.y + q.a23 * p.z + q.a33;
+    return q.weight > 0.0f ? std::fabs(r) / q.weight : 0.0f;
+}
+
+struct Collapse {
+    uint32_t from, to;
+    float cost;
+    float positionError;
+};
+
+// Order collapses by the top 12 bits of their (non-negative) cost: exponent and 3 mantissa bits
+// are plenty for a greedy pass and keep the sort linear. The sort is stable, so each bucket
+// stays in mesh order and the pass touches memory less randomly.
+static void sortCollapses(std::vector<Collapse>& collapses, std::vector<Collapse>& scratch) {
+    const size_t buckets = 1 << 11;
+    std::vector<uint32_t> offsets(buckets + 1, 0);
+    auto key = [](float cost) {
+        uint32_t bits;
+        std::memcpy(&bits, &cost, sizeof(bits));
+        return (bits & 0x7FFFFFFF) >> 20;
+    };
+    for (const Collapse& c : collapses) {
+        offsets[key(c.cost) + 1]++;
+    }
+    for (size_t b = 0; b < buckets; b++) {
+        offsets[b + 1] += offsets[b];
+    }
+    scratch.resize(collapses.size());
+    for (const Collapse& c : collapses) {
+        scratch[offsets[key(c.cost)]++] = c;
+    }
+    collapses.swap(scratch);
+}
+
+// Simplification state of a whole mesh. Collapses act on positions (all vertices at one position
+// move together) and each attribute vertex of the removed position is replaced by the closest
+// attribute vertex of the kept one. Triangles keep their submesh, so material boundaries are just
+// another attribute seam and stay closed.
+class Simplifier {
+public:
+    Simplifier(const Mesh& mesh, float extent);
+
+    // Collapse until at most targetTriangles remain or nothing more can collapse
+    void simplify(size_t targetTriangles);
+
+    size_t triangleCount() const { return indices.size() / 3; }
+    uint32_t positionIndex(uint32_t vertex) const { return positionOf[vertex]; }
+    float error() const { return std::sqrt(maxPositionError) * extent; }
+    // Current triangles of one submesh
+    void appendIndices(uint32_t submesh, std::vector<uint32_t>& out) const;
+
+private:
+    void buildAdjacency();
+    size_t collapsePass(size_t targetTriangles, size_t& goal);
+    float attributeDistance(uint32_t from, uint32_t to, uint32_t* nearest) const;
+    bool flips(uint32_t from, uint32_t to) const;
+
+    float extent;
+    std::vector<uint32_t> positionOf;    // vertex -> position
+    std::vector<glm::vec3> positions;    // normalized by extent
+    std::vector<glm::vec3> normals;      // vertex attributes
+    std::vector<glm::vec3> colors;
+    std::vector<uint32_t> wedgeOffsets;  // position -> its vertices in wedges
+    std::vector<uint32_t> wedges;
+    std::vector<uint8_t> locked;
+    std::vector<Quadric> quadrics;
+    std::vector<uint32_t> indices;       // current triangles
+    std::vector<uint32_t> triangleSubmesh;
+    float maxPositionError = 0.0f;
+
+    // Per pass scratch
+    std::vector<uint32_t> corners;                     // position of every index of `indices`
+    std::vector<uint32_t> triangleOffsets, triangles; // position -> adjacent triangles
+    std::vector<uint32_t> collapseTarget;
+    std::vector<uint32_t> vertexTarget;
+    std::vector<uint32_t> passStamp;
+    uint32_t pass = 0;
+    float costSlack = COST_SLACK;
+    std::vector<Collapse> collapses, scratch;
+};
+
+Simplifier::Simplifier(const Mesh& mesh, float extent) : extent(extent) {
+    size_t positionCount = 0;
+    positionOf = weldPositions(mesh.vertices, positionCount);
+    size_t vertexCount = mesh.vertices.size();
+
+    positions.resize(positionCount);
+    normals.resize(vertexCount);
+    colors.resize(vertexCount);
+    wedgeOffsets.assign(positionCount + 1, 0);
+    float scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+    for (size_t v = 0; v < vertexCount; v++) {
+        positions[positionOf[v]] = mesh.vertices[v].position * scale;
+        normals[v] = mesh.vertices[v].normal;
+        colors[v] = mesh.vertices[v].color;
+        wedgeOffsets[positionOf[v] + 1]++;
+    }
+    for (size_t p = 0; p < positionCount; p++) {
+        wedgeOffsets[p + 1] += wedgeOffsets[p];
+    }
+    wedges.resize(vertexCount);
+    std::vector<uint32_t> fill(wedgeOffsets.begin(), wedgeOffsets.end() - 1);
+    for (size_t v = 0; v < vertexCount; v++) {
+        wedges[fill[positionOf[v]]++] = (uint32_t)v;
+    }
+
+    for (uint32_t s = 0; s < mesh.submeshes.size(); s++) {
+        const Submesh& submesh = mesh.submeshes[s];
+        size_t indexCount = submesh.indexCount - submesh.indexCount % 3;
+        indices.insert(indices.end(), mesh.indices.begin() + submesh.indexOffset,
+                       mesh.indices.begin() + submesh.indexOffset + indexCount);
+        triangleSubmesh.insert(triangleSubmesh.end(), indexCount / 3, s);
+    }
+
+    // Area-weighted plane quadrics of the original surface
+    quadrics.assign(positionCount, Quadric());
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        uint32_t a = positionOf[indices[i]], b = positionOf[indices[i + 1]], c = positionOf[indices[i + 2]];
+        glm::vec3 n = glm::cross(positions[b] - positions[a], positions[c] - positions[a]);
+        float area = glm::length(n);
+        if (area == 0.0f) {
+            continue;
+        }
+        n /= area;
+        float d = -glm::dot(n, positions[a]);
+        addPlane(quadrics[a], n, d, area);
+        addPlane(quadrics[b], n, d, area);
+        addPlane(quadrics[c], n, d, area);
+    }
+
+    // Lock both ends of every edge that is not matched by exactly one opposite half-edge:
+    // open borders and non-manifold fans
+    locked.assign(positionCount, 0);
+    buildAdjacency();
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        for (int k = 0; k < 3; k++) {
+            uint32_t a = corners[i + k], b = corners[i + (k + 1) % 3];
+            if (a == b) continue;
+            int forward = 0, backward = 0;
+            for (uint32_t t = triangleOffsets[a]; t < triangleOffsets[a + 1]; t++) {
+                const uint32_t* triangle = &corners[triangles[t] * 3];
+                for (int j = 0; j < 3; j++) {
+                    uint32_t p = triangle[j], q = triangle[(j + 1) % 3];
+                    forward += p == a && q == b;
+                    backward += p == b && q == a;
+                }
+            }
+            if (forward != 1 || backward != 1) {
+                locked[a] = 1;
+                locked[b] = 1;
+            }
+        }
+    }
+
+    collapseTarget.resize(positionCount);
+    for (size_t p = 0; p < positionCount; p++) {
+        collapseTarget[p] = (uint32_t)p;
+    }
+    vertexTarget.resize(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) {
+        vertexTarget[v] = (uint32_t)v;
+    }
+    passStamp.assign(positionCount, 0);
+}
+
+// Corner positions and position -> triangles adjacency of the current surface. Later lookups
+// then skip the vertex -> position indirection, which is a cache miss apiece on big meshes.
+void Simplifier::buildAdjacency() {
+    size_t positionCount = positions.size();
+    corners.resize(indices.size());
+    for (size_t i = 0; i < indices.size(); i++) {
+        corners[i] = positionOf[indices[i]];
+    }
+    triangleOffsets.assign(positionCount + 1, 0);
+    for (uint32_t position : corners) {
+        triangleOffsets[position + 1]++;
+    }
+    for (size_t p = 0; p < positionCount; p++) {
+        triangleOffsets[p + 1] += triangleOffsets[p];
+    }
+    triangles.resize(indices.size());
+    std::vector<uint32_t> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++) {
+        triangles[fill[corners[i]]++] = (uint32_t)(i / 3);
+    }
+}
+
+// Largest attribute distance from any wedge of `from` to its closest wedge of `to`;
+// fills the closest wedge for each wedge of `from` when asked
+float Simplifier::attributeDistance(uint32_t from, uint32_t to, uint32_t* nearest) const {
+    float worst = 0.0f;
+    for (uint32_t i = wedgeOffsets[from]; i < wedgeOffsets[from + 1]; i++) {
+        uint32_t w = wedges[i];
+        float best = std::numeric_limits<float>::max();
+        uint32_t bestWedge = wedges[wedgeOffsets[to]];
+        for (uint32_t j = wedgeOffsets[to]; j < wedgeOffsets[to + 1]; j++) {
+            uint32_t x = wedges[j];
+            glm::vec3 dn = normals[w] - normals[x];
+            glm::vec3 dc = colors[w] - colors[x];
+            float distance = glm::dot(dn, dn) + glm::dot(dc, dc);
+            if (distance < best) {
+                best = distance;
+                bestWedge = x;
+            }
+        }
+        if (nearest) {
+            nearest[i - wedgeOffsets[from]] = bestWedge;
+        }
+        worst = std::max(worst, best);
+    }
+    return worst;
+}
+
+// Would moving `from` onto `to` fold over one of the triangles that survive the collapse?
+// Corners are resolved through this pass's collapses, so the test sees the current surface.
+bool Simplifier::flips(uint32_t from, uint32_t to) const {
+    for (uint32_t t = triangleOffsets[from]; t < triangleOffsets[from + 1]; t++) {
+        const uint32_t* triangle = &corners[triangles[t] * 3];
+        uint32_t moved[3];
+        int self = -1;
+        for (int k = 0; k < 3; k++) {
+            moved[k] = collapseTarget[triangle[k]];
+            if (moved[k] == from) self = k;
+        }
+        if (self < 0 || moved[0] == to || moved[1] == to || moved[2] == to ||
+            moved[0] == moved[1] || moved[1] == moved[2] || moved[0] == moved[2]) {
+            continue; // Degenerates away with this collapse or an earlier one of the pass
+        }
+
+        const glm::vec3& a = positions[moved[(self + 1) % 3]];
+        const glm::vec3& b = positions[moved[(self + 2) % 3]];
+        glm::vec3 before = glm::cross(a - positions[from], b - positions[from]);
+        glm::vec3 after = glm::cross(a - positions[to], b - positions[to]);
+        if (glm::dot(before, after) <= FLIP_COSINE * glm::length(before) * glm::length(after)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// One greedy pass (after meshoptimizer's simplifier): cost every edge, then collapse the cheapest
+// ones, each position at most once per pass, up to the number needed to reach the target.
+// Returns the number of collapses done and the number it aimed for in `goal`.
+size_t Simplifier::collapsePass(size_t targetTriangles, size_t& goal) {
+    size_t triangleTotal = indices.size() / 3;
+    pass++;
+    buildAdjacency();
+
+    // Each interior edge shows up once as a -> b with a < b; the cheaper unlocked direction is kept.
+    // Costs are evaluated in parallel into one slot per half-edge, then compacted.
+    const float none = -1.0f;
+    scratch.resize(indices.size());
+    const size_t batch = 16384;
+    parallelFor((triangleTotal + batch - 1) / batch, [&](size_t block) {
+        size_t end = std::min(triangleTotal, (block + 1) * batch) * 3;
+        for (size_t i = block * batch * 3; i < end; i += 3) {
+            for (int k = 0; k < 3; k++) {
+                Collapse& best = scratch[i + k];
+                best = { 0, 0, none, 0.0f };
+                uint32_t a = corners[i + k], b = corners[i + (k + 1) % 3];
+                if (a >= b || (locked[a] && locked[b])) continue;
+
+                glm::vec3 edge = positions[a] - positions[b];
+                float edgeLengthSquared = glm::dot(edge, edge);
+                for (int direction = 0; direction < 2; direction++) {
+                    uint32_t from = direction ? b : a, to = direction ? a : b;
+                    if (locked[from]) continue;
+                    float positionError = quadricError(quadrics[from], positions[to]);
+                    float cost = positionError + ATTRIBUTE_WEIGHT * attributeDistance(from, to, nullptr) * edgeLengthSquared;
+                    if (best.cost == none || cost < best.cost) {
+                        best = { from, to, cost, positionError };
+                    }
+                }
+            }
+        }
+    });
+    collapses.clear();
+    for (const Collapse& c : scratch) {
+        if (c.cost != none) collapses.push_back(c);
+    }
+    goal = std::max<size_t>(1, (triangleTotal - targetTriangles) / 2);
+    if (collapses.empty()) {
+        return 0;
+    }
+    sortCollapses(collapses, scratch);
+
+    // Each collapse removes about two triangles. Collapses far costlier than the ones the goal
+    // would need (about half of the candidates get skipped) are left for a later pass, where
+    // cheaper ones may have opened up; when that leaves a pass with next to nothing to do, the
+    // margin widens.
+    size_t rank = goal * 2;
+    float costLimit = rank < collapses.size() ? collapses[rank].cost * costSlack : std::numeric_limits<float>::max();
+
+    std::vector<uint32_t> collapsed;
+    bool limited = false;
+    for (const Collapse& c : collapses) {
+        if (collapsed.size() >= goal) break;
+        if (c.cost > costLimit) {
+            limited = true;
+            break;
+        }
+        if (passStamp[c.from] == pass || passStamp[c.to] == pass) continue;
+        if (flips(c.from, c.to)) continue;
+
+        collapseTarget[c.from] = c.to;
+        addQuadric(quadrics[c.to], quadrics[c.from]);
+        maxPositionError = std::max(maxPositionError, c.positionError);
+        passStamp[c.from] = pass;
+        passStamp[c.to] = pass;
+        collapsed.push_back(c.from);
+    }
+    costSlack = limited && collapsed.size() * 8 < goal ? costSlack * 4.0f : COST_SLACK;
+    if (collapsed.empty()) {
+        return 0;
+    }
+
+    // Move the attribute vertices of every removed position onto the closest ones of its target
+    std::vector<uint32_t> nearest;
+    for (uint32_t from : collapsed) {
+        nearest.resize(wedgeOffsets[from + 1] - wedgeOffsets[from]);
+        attributeDistance(from, collapseTarget[from], nearest.data());
+        for (uint32_t i = wedgeOffsets[from]; i < wedgeOffsets[from + 1]; i++) {
+            vertexTarget[wedges[i]] = nearest[i - wedgeOffsets[from]];
+        }
+    }
+
+    // Rewrite the triangles, dropping the ones that collapsed to a line or point
+    size_t write = 0;
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        uint32_t a = vertexTarget[indices[i]], b = vertexTarget[indices[i + 1]], c = vertexTarget[indices[i + 2]];
+        uint32_t pa = positionOf[a], pb = positionOf[b], pc = positionOf[c];
+        if (pa == pb || pb == pc || pa == pc) continue;
+        triangleSubmesh[write / 3] = triangleSubmesh[i / 3];
+        indices[write++] = a;
+        indices[write++] = b;
+        indices[write++] = c;
+    }
+    indices.resize(write);
+    triangleSubmesh.resize(write / 3);
+
+    for (uint32_t from : collapsed) {
+        collapseTarget[from] = from;
+        for (uint32_t i = wedgeOffsets[from]; i < wedgeOffsets[from + 1]; i++) {
+            vertexTarget[wedges[i]] = wedges[i];
+        }
+    }
+    return collapsed.size();
+}
+
+void Simplifier::simplify(size_t targetTriangles) {
+    size_t stopAt = targetTriangles + (size_t)(targetTriangles * TARGET_TOLERANCE);
+    int stalled = 0;
+    while (triangleCount() > stopAt && stalled < STALLED_PASSES) {
+        size_t goal = 0;
+        size_t done = collapsePass(targetTriangles, goal);
+        stalled = done * 8 < goal ? stalled + 1 : 0;
+    }
+}
+
+void Simplifier::appendIndices(uint32_t submesh, std::vector<uint32_t>& out) const {
+    for (size_t t = 0; t < triangleSubmesh.size(); t++) {
+        if (triangleSubmesh[t] == submesh) {
+            out.insert(out.end(), indices.begin() + t * 3, indices.begin() + t * 3 + 3);
+        }
+    }
+}
+
+// Axis-aligned box of the vertex positions
+static void positionBounds(const Mesh& mesh, glm::vec3& lo, glm::vec3& hi) {
+    lo = hi = glm::vec3(0.0f);
+    if (!mesh.vertices.empty()) {
+        lo = hi = mesh.vertices[0].position;
+    }
+    for (const Vertex& vertex : mesh.vertices) {
+        lo = glm::min(lo, vertex.position);
+        hi = glm::max(hi, vertex.position);
+    }
+}
+
+LodChain buildLodChain(Mesh& mesh) {
+    LodChain chain;
+    size_t submeshCount = mesh.submeshes.size();
+
+    glm::vec3 lo, hi;
+    positionBounds(mesh, lo, hi);
+    chain.center = (lo + hi) * 0.5f;
+    chain.radius = glm::length(hi - lo) * 0.5f;
+    glm::vec3 size = hi - lo;
+    float extent = std::max(size.x, std::max(size.y, size.z));
+
+    // Level 0 is the mesh as it is; each further level continues from the previous one, so
+    // quadrics and errors accumulate along the chain. Levels are appended level-major.
+    chain.levels.push_back({ 0, (uint32_t)(mesh.indices.size() / 3), 0.0f });
+    chain.submeshes = mesh.submeshes;
+
+    Simplifier simplifier(mesh, extent);
+    size_t fullTriangles = simplifier.triangleCount();
+    std::vector<std::vector<uint32_t>> levelIndices(submeshCount);
+    for (uint32_t level = 1; level < LOD_LEVEL_COUNT; level++) {
+        simplifier.simplify((size_t)(fullTriangles * LOD_RATIOS[level - 1]));
+        // Locked borders and seams can stop the collapses short; a level barely smaller than the
+        // one before would nearly repeat it, and the levels after it would get little further
+        if (simplifier.triangleCount() > chain.levels.back().triangleCount * LOD_MAX_LEVEL_RATIO) {
+            break;
+        }
+
+        // Submeshes of a level are cache optimized in parallel
+        parallelFor(submeshCount, [&](size_t s) {
+            std::vector<uint32_t> source;
+            simplifier.appendIndices((uint32_t)s, source);
+            levelIndices[s].resize(source.size());
+            if (!source.empty()) {
+                optimizeVertexCache(levelIndices[s].data(), source.data(), source.size(), mesh.vertices.size());
+            }
+        });
+
+        MeshLod lod = { (uint32_t)chain.submeshes.size(), (uint32_t)simplifier.triangleCount(), simplifier.error() };
+        for (size_t s = 0; s < submeshCount; s++) {
+            chain.submeshes.push_back({ (uint32_t)mesh.indices.size(), (uint32_t)levelIndices[s].size(),
+                                        mesh.submeshes[s].materialId });
+            mesh.indices.insert(mesh.indices.end(), levelIndices[s].begin(), levelIndices[s].end());
+        }
+        chain.levels.push_back(lod);
+    }
+    return chain;
+}
+
+OccluderMesh buildOccluderMesh(const Mesh& mesh, size_t targetTriangles) {
+    glm::vec3 lo, hi;
+    positionBounds(mesh, lo, hi);
+    glm::vec3 size = hi - lo;
+    Simplifier simplifier(mesh, std::max(size.x, std::max(size.y, size.z)));
+    simplifier.simplify(targetTriangles);
+
+    std::vector<uint32_t> indices;
+    for (uint32_t s = 0; s < mesh.submeshes.size(); s++) {
+        simplifier.appendIndices(s, indices);
+    }
+
+    // Attribute seams do not matter to depth, so vertices sharing a position become one
+    OccluderMesh occluder;
+    occluder.boxMin = lo;
+    occluder.boxMax = hi;
+    std::vector<uint32_t> remap(mesh.vertices.size(), UINT32_MAX);
+    occluder.indices.reserve(indices.size());
+    for (uint32_t vertex : indices) {
+        uint32_t& slot = remap[simplifier.positionIndex(vertex)];
+        if (slot == UINT32_MAX) {
+            slot = (uint32_t)occluder.positions.size();
+            occluder.positions.push_back(mesh.vertices[vertex].position);
+        }
+        occluder.indices.push_back(slot);
+    }
+    return occluder;
+}
+
+float lodPixelsPerUnit(const glm::mat4& modelView, const glm::vec3& center, float radius, float viewportHeight,
+                       float fovY) {
+    // Largest axis scale of the model-view transform bounds how far a model-space unit can reach
+    float scale = std::max(glm::length(glm::vec3(modelView[0])),
+                           std::max(glm::length(glm::vec3(modelView[1])), glm::length(glm::vec3(modelView[2]))));
+    float distance = glm::length(glm::vec3(modelView * glm::vec4(center, 1.0f))) - radius * scale;
+    if (distance <= 0.0f) {
+        return std::numeric_limits<float>::max(); // Camera inside the bounds: always full detail
+    }
+    return scale * viewportHeight / (2.0f * std::tan(fovY * 0.5f) * distance);
+}
+
+uint32_t selectLod(const MeshLod* levels, uint32_t levelCount, float pixelsPerUnit, float maxPixelError) {
+    uint32_t selected = 0;
+    for (uint32_t level = 1; level < levelCount; level++) {
+        if (levels[level].error * pixelsPerUnit > maxPixelError) break;
+        selected = level;
+    }
+    return selected;
+}
+
+void printLodReport(const std::string& name, const MeshLod* levels, uint32_t levelCount, double milliseconds) {
+    std::cout << "LOD chain for " << name << " (" << levelCount << " levels, " << milliseconds << " ms)" << std::endl;
+    for (uint32_t level = 0; level < levelCount; level++) {
+        double ratio = levels[0].triangleCount > 0 ? 100.0 * levels[level].triangleCount / levels[0].triangleCount : 0.0;
+        std::cout << "  LOD" << level << ": " << levels[level].triangleCount << " triangles (" << ratio
+                  << "%), error " << levels[level].error << std::endl;
+    }
+}
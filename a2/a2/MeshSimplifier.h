@@ -0,0 +1,64 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Mesh.h"
+
+// Triangle counts of the LOD chain as fractions of the full mesh (level 0 is the full mesh)
+const float LOD_RATIOS[] = { 0.5f, 0.25f, 0.1f, 0.02f };
+const uint32_t LOD_LEVEL_COUNT = 1 + sizeof(LOD_RATIOS) / sizeof(LOD_RATIOS[0]);
+// Most of the previous level's triangles a level may keep; the chain ends at one that keeps more
+const float LOD_MAX_LEVEL_RATIO = 0.9f;
+
+// Largest projected geometric error, in pixels, a level may show before a finer one is picked
+const float LOD_PIXEL_ERROR = 1.0f;
+
+// One level of detail: submesh ranges of the shared index buffer plus how far it deviates
+struct MeshLod {
+    uint32_t submeshOffset; // first of this level's ranges in LodChain::submeshes (one per submesh)
+    uint32_t triangleCount;
+    float error;            // model-space geometric error (0 for level 0)
+};
+
+// Levels from finest to coarsest, at most LOD_LEVEL_COUNT of them. Every level has one range per submesh of the mesh, in the
+// same order and with the same materials; simplified submeshes can end up empty.
+struct LodChain {
+    std::vector<MeshLod> levels;
+    std::vector<Submesh> submeshes;
+    glm::vec3 center = glm::vec3(0.0f); // bounding sphere, for the projected error
+    float radius = 0.0f;
+};
+
+// Simplify the whole mesh with quadric edge collapses whose cost also weighs the normal and color
+// seams a collapse crosses; material boundaries are such seams too, so submeshes stay stitched.
+// Open borders and non-manifold edges are locked. Levels after the first are appended to
+// mesh.indices and cache optimized; level 0 keeps the existing submesh ranges. The chain ends
+// early once simplification stops removing a useful share of the triangles.
+LodChain buildLodChain(Mesh& mesh);
+
+// Triangle budget of the occluder generated for CPU occlusion culling
+const size_t OCCLUDER_TRIANGLES = 256;
+
+// Position-only triangle list, welded by position, standing in for a model when it is rasterized
+// into the CPU occlusion buffer
+struct OccluderMesh {
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+    glm::vec3 boxMin = glm::vec3(0.0f), boxMax = glm::vec3(0.0f); // full-detail model, for testing it as an occludee
+};
+
+// Simplify the mesh down to about targetTriangles with the LOD simplifier. Locked borders can keep
+// it above the target; the result follows the surface within the simplifier's error.
+OccluderMesh buildOccluderMesh(const Mesh& mesh, size_t targetTriangles = OCCLUDER_TRIANGLES);
+
+// Screen pixels one model-space unit covers at the point of the bounding sphere nearest to the camera
+float lodPixelsPerUnit(const glm::mat4& modelView, const glm::vec3& center, float radius, float viewportHeight,
+                       float fovY);
+
+// Coarsest level whose error stays within maxPixelError on screen
+uint32_t selectLod(const MeshLod* levels, uint32_t levelCount, float pixelsPerUnit,
+                   float maxPixelError = LOD_PIXEL_ERROR);
+
+void printLodReport(const std::string& name, const MeshLod* levels, uint32_t levelCount, double milliseconds);
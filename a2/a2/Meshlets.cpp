@@ -0,0 +1,223 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include "Meshlets.h"
+#include "Parallel.h"
+
+static_assert(sizeof(Meshlet) == 18 * sizeof(float), "Meshlet is stored verbatim in the mesh cache");
+
+// Greedy scan of one submesh: keep adding triangles in index order until the next one would
+// exceed either limit. The distinct-vertex check is a scan of at most MESHLET_MAX_VERTICES
+// entries, so the whole pass stays linear in the triangle count.
+static void splitSubmesh(const Mesh& mesh, uint32_t submeshIndex, std::vector<Meshlet>& meshlets) {
+    const Submesh& submesh = mesh.submeshes[submeshIndex];
+    uint32_t indexCount = submesh.indexCount - submesh.indexCount % 3;
+    const uint32_t* indices = mesh.indices.data() + submesh.indexOffset;
+
+    uint32_t used[MESHLET_MAX_VERTICES];
+    Meshlet current = {};
+    current.indexOffset = submesh.indexOffset;
+    current.submesh = submeshIndex;
+
+    for (uint32_t i = 0; i < indexCount; i += 3) {
+        uint32_t added[3];
+        uint32_t addedCount = 0;
+        for (uint32_t k = 0; k < 3; k++) {
+            uint32_t index = indices[i + k];
+            bool seen = std::find(used, used + current.vertexCount, index) != used + current.vertexCount ||
+                        std::find(added, added + addedCount, index) != added + addedCount;
+            if (!seen) {
+                added[addedCount++] = index;
+            }
+        }
+
+        if (current.vertexCount + addedCount > MESHLET_MAX_VERTICES || current.indexCount / 3 == MESHLET_MAX_TRIANGLES) {
+            meshlets.push_back(current);
+            current.indexOffset += current.indexCount;
+            current.indexCount = 0;
+            current.vertexCount = 0;
+            // Against an empty meshlet the distinct vertices are exactly the triangle's own
+            addedCount = 0;
+            for (uint32_t k = 0; k < 3; k++) {
+                uint32_t index = indices[i + k];
+                if (std::find(added, added + addedCount, index) == added + addedCount) {
+                    added[addedCount++] = index;
+                }
+            }
+        }
+
+        std::copy(added, added + addedCount, used + current.vertexCount);
+        current.vertexCount += addedCount;
+        current.indexCount += 3;
+    }
+    if (current.indexCount > 0) {
+        meshlets.push_back(current);
+    }
+}
+
+// Bounding sphere, AABB and normal cone of one meshlet
+static void computeBounds(const Mesh& mesh, Meshlet& meshlet) {
+    const uint32_t* indices = mesh.indices.data() + meshlet.indexOffset;
+
+    glm::vec3 lo(INFINITY), hi(-INFINITY);
+    for (uint32_t i = 0; i < meshlet.indexCount; i++) {
+        const glm::vec3& p = mesh.vertices[indices[i]].position;
+        lo = glm::min(lo, p);
+        hi = glm::max(hi, p);
+    }
+    meshlet.aabbMin = lo;
+    meshlet.aabbMax = hi;
+
+    // Sphere around the box center: a little looser than the minimal sphere but one pass
+    meshlet.center = (lo + hi) * 0.5f;
+    float radiusSquared = 0.0f;
+    for (uint32_t i = 0; i < meshlet.indexCount; i++) {
+        glm::vec3 d = mesh.vertices[indices[i]].position - meshlet.center;
+        radiusSquared = std::max(radiusSquared, glm::dot(d, d));
+    }
+    meshlet.radius = std::sqrt(radiusSquared);
+
+    // Geometric (winding) normals, not the shading normals: they decide what the GPU culls
+    glm::vec3 normals[MESHLET_MAX_TRIANGLES];
+    uint32_t normalCount = 0;
+    glm::vec3 axis(0.0f);
+    for (uint32_t i = 0; i < meshlet.indexCount; i += 3) {
+        const glm::vec3& a = mesh.vertices[indices[i]].position;
+        const glm::vec3& b = mesh.vertices[indices[i + 1]].position;
+        const glm::vec3& c = mesh.vertices[indices[i + 2]].position;
+        glm::vec3 n = glm::cross(b - a, c - a);
+        float length = glm::length(n);
+        if (length == 0.0f) {
+            continue; // Degenerate triangles are never rasterized
+        }
+        normals[normalCount++] = n / length;
+        axis += n / length;
+    }
+
+    meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+    meshlet.coneCutoff = 1.0f;
+    float axisLength = glm::length(axis);
+    if (normalCount == 0 || axisLength == 0.0f) {
+        return;
+    }
+    axis /= axisLength;
+
+    float minDot = 1.0f;
+    for (uint32_t i = 0; i < normalCount; i++) {
+        minDot = std::min(minDot, glm::dot(normals[i], axis));
+    }
+    meshlet.coneAxis = axis;
+    // Normals spreading over a hemisphere or more leave no direction from which all faces are back faces
+    if (minDot > 0.1f) {
+        meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+    }
+}
+
+std::vector<Meshlet> buildMeshlets(const Mesh& mesh) {
+    // Submeshes split independently; the bounds pass then balances well over all meshlets
+    std::vector<std::vector<Meshlet>> perSubmesh(mesh.submeshes.size());
+    parallelFor(mesh.submeshes.size(), [&](size_t s) { splitSubmesh(mesh, (uint32_t)s, perSubmesh[s]); });
+
+    std::vector<Meshlet> meshlets;
+    size_t total = 0;
+    for (const auto& list : perSubmesh) {
+        total += list.size();
+    }
+    meshlets.reserve(total);
+    for (const auto& list : perSubmesh) {
+        meshlets.insert(meshlets.end(), list.begin(), list.end());
+    }
+
+    const size_t batch = 256;
+    parallelFor((meshlets.size() + batch - 1) / batch, [&](size_t b) {
+        size_t end = std::min(meshlets.size(), (b + 1) * batch);
+        for (size_t m = b * batch; m < end; m++) {
+            computeBounds(mesh, meshlets[m]);
+        }
+    });
+    return meshlets;
+}
+
+Frustum extractFrustum(const glm::mat4& clipFromModel) {
+    // Rows of the matrix (glm is column-major)
+    glm::vec4 row[4];
+    for (int r = 0; r < 4; r++) {
+        row[r] = glm::vec4(clipFromModel[0][r], clipFromModel[1][r], clipFromModel[2][r], clipFromModel[3][r]);
+    }
+
+    Frustum frustum;
+    frustum.planes[0] = row[3] + row[0]; // left
+    frustum.planes[1] = row[3] - row[0]; // right
+    frustum.planes[2] = row[3] + row[1]; // bottom
+    frustum.planes[3] = row[3] - row[1]; // top
+    frustum.planes[4] = row[3] + row[2]; // near
+    frustum.planes[5] = row[3] - row[2]; // far
+    for (glm::vec4& plane : frustum.planes) {
+        plane /= glm::length(glm::vec3(plane));
+    }
+    return frustum;
+}
+
+MeshletVisibility classifyMeshlet(const Meshlet& meshlet, const Frustum& frustum, const glm::vec3& cameraPosition,
+                                  bool cullBackfaces) {
+    for (const glm::vec4& plane : frustum.planes) {
+        if (glm::dot(glm::vec3(plane), meshlet.center) + plane.w < -meshlet.radius) {
+            return MeshletVisibility::OutsideFrustum;
+        }
+    }
+
+    // Every triangle faces away when the whole sphere lies inside the cone's back side
+    if (cullBackfaces) {
+        glm::vec3 toCluster = meshlet.center - cameraPosition;
+        if (glm::dot(toCluster, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(toCluster) + meshlet.radius) {
+            return MeshletVisibility::Backfacing;
+        }
+    }
+    return MeshletVisibility::Visible;
+}
+
+void cullMeshlets(const Meshlet* meshlets, size_t count, const Frustum& frustum, const glm::vec3& cameraPosition,
+                  bool cullBackfaces, std::vector<DrawRange>& ranges, MeshletCullStats* stats) {
+    size_t firstRange = ranges.size();
+    for (size_t m = 0; m < count; m++) {
+        const Meshlet& meshlet = meshlets[m];
+        MeshletVisibility visibility = classifyMeshlet(meshlet, frustum, cameraPosition, cullBackfaces);
+        if (stats) {
+            stats->visible += visibility == MeshletVisibility::Visible;
+            stats->outsideFrustum += visibility == MeshletVisibility::OutsideFrustum;
+            stats->backfacing += visibility == MeshletVisibility::Backfacing;
+        }
+        if (visibility != MeshletVisibility::Visible) {
+            continue;
+        }
+        if (stats) {
+            stats->visibleTriangles += meshlet.indexCount / 3;
+        }
+
+        if (ranges.size() > firstRange && ranges.back().indexOffset + ranges.back().indexCount == meshlet.indexOffset) {
+            ranges.back().indexCount += meshlet.indexCount;
+        }
+        else {
+            ranges.push_back({ meshlet.indexOffset, meshlet.indexCount });
+        }
+    }
+}
+
+void printMeshletReport(const std::string& name, const std::vector<Meshlet>& meshlets, size_t triangleCount) {
+    size_t vertices = 0;
+    size_t cullable = 0;
+    for (const Meshlet& meshlet : meshlets) {
+        vertices += meshlet.vertexCount;
+        cullable += meshlet.coneCutoff < 1.0f;
+    }
+
+    std::cout << "Meshlet report for " << name << " (" << MESHLET_MAX_VERTICES << " vertices / "
+              << MESHLET_MAX_TRIANGLES << " triangles max)" << std::endl;
+    std::cout << "  " << meshlets.size() << " meshlets, " << meshlets.size() * sizeof(Meshlet) / 1024.0
+              << " KiB side table" << std::endl;
+    if (!meshlets.empty()) {
+        std::cout << "  " << (double)triangleCount / meshlets.size() << " triangles and "
+                  << (double)vertices / meshlets.size() << " vertices per meshlet, "
+                  << 100.0 * cullable / meshlets.size() << "% with a usable normal cone" << std::endl;
+    }
+}
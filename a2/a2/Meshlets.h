@@ -0,0 +1,70 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Mesh.h"
+
+// Cluster size limits (the usual mesh shader sizes, so the side table stays useful later)
+const uint32_t MESHLET_MAX_VERTICES = 64;
+const uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+// A cluster of consecutive triangles of one submesh. Meshlets never reorder the index buffer:
+// each one is a contiguous index range, so visible neighbours merge into a single draw range.
+// All bounds are in model space.
+struct Meshlet {
+    uint32_t indexOffset; // into the mesh index buffer
+    uint32_t indexCount;  // 3 * triangles
+    uint32_t submesh;     // owning submesh; meshlets are stored in submesh order
+    uint32_t vertexCount; // distinct vertices
+    glm::vec3 center;     // bounding sphere
+    float radius;
+    glm::vec3 aabbMin;
+    glm::vec3 aabbMax;
+    glm::vec3 coneAxis;   // average facing direction of the triangles
+    float coneCutoff;     // sine of the widest axis-to-normal angle, 1 when the cone cannot cull
+};
+
+// Split every submesh (in parallel) into meshlets of at most MESHLET_MAX_VERTICES / _TRIANGLES,
+// walking the existing triangle order so build time is linear
+std::vector<Meshlet> buildMeshlets(const Mesh& mesh);
+
+// Frustum planes (xyz = inward normal, w = distance), normalized, in the space the matrix maps from
+struct Frustum {
+    glm::vec4 planes[6];
+};
+
+// Gribb-Hartmann plane extraction: pass projection * view * model to get model-space planes
+Frustum extractFrustum(const glm::mat4& clipFromModel);
+
+enum class MeshletVisibility {
+    Visible,
+    OutsideFrustum,
+    Backfacing,
+};
+
+// Conservative per-meshlet test. The backface cone test is only valid when back faces are culled
+// by the GPU too; it is exact in model space since facing is preserved by affine transforms.
+MeshletVisibility classifyMeshlet(const Meshlet& meshlet, const Frustum& frustum, const glm::vec3& cameraPosition,
+                                  bool cullBackfaces);
+
+// Contiguous index range drawn with one count/offset pair of glMultiDrawElements
+struct DrawRange {
+    uint32_t indexOffset;
+    uint32_t indexCount;
+};
+
+struct MeshletCullStats {
+    size_t visible = 0;
+    size_t outsideFrustum = 0;
+    size_t backfacing = 0;
+    size_t visibleTriangles = 0;
+};
+
+// Classify `count` meshlets and append the index ranges of the visible ones to `ranges`,
+// merging meshlets that are neighbours in the index buffer. Adds to `stats` when given.
+void cullMeshlets(const Meshlet* meshlets, size_t count, const Frustum& frustum, const glm::vec3& cameraPosition,
+                  bool cullBackfaces, std::vector<DrawRange>& ranges, MeshletCullStats* stats = nullptr);
+
+void printMeshletReport(const std::string& name, const std::vector<Meshlet>& meshlets, size_t triangleCount);
@@ -0,0 +1,485 @@
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <string>
+#include "BlockArray.h"
+#include "MappedFile.h"
+#include "MeshNormals.h"
+#include "ModelLoader.h"
+#include "Profiler.h"
+#include "tiny_obj_loader.h"
+
+// Build the vertex of one face corner from the parsed OBJ attributes; corners without a vn
+// take generatedNormal
+static Vertex makeVertex(const tinyobj::attrib_t& attrib, const tinyobj::index_t& idx, const glm::vec3& generatedNormal) {
+    Vertex vertex;
+
+    // Position
+    vertex.position = {
+        attrib.vertices[3 * idx.vertex_index + 0],
+        attrib.vertices[3 * idx.vertex_index + 1],
+        attrib.vertices[3 * idx.vertex_index + 2]
+    };
+
+    // Normal
+    if (idx.normal_index >= 0) {
+        vertex.normal = {
+            attrib.normals[3 * idx.normal_index + 0],
+            attrib.normals[3 * idx.normal_index + 1],
+            attrib.normals[3 * idx.normal_index + 2]
+        };
+    }
+    else {
+        vertex.normal = generatedNormal;
+    }
+
+    // Color (use a default color if not specified)
+    if (idx.texcoord_index >= 0 && attrib.texcoords.size() > 0) {
+        // Use texture coordinate to generate color
+        vertex.color = {
+            attrib.texcoords[2 * idx.texcoord_index + 0],
+            attrib.texcoords[2 * idx.texcoord_index + 1],
+            0.5f  // Default blue component
+        };
+    }
+    else {
+        // Default color (white)
+        vertex.color = { 1.0f, 1.0f, 1.0f };
+    }
+
+    return vertex;
+}
+
+static Material makeMaterial(const tinyobj::material_t& source) {
+    Material material = {};
+    std::snprintf(material.name, sizeof(material.name), "%s", source.name.c_str());
+    material.diffuse = { source.diffuse[0], source.diffuse[1], source.diffuse[2] };
+    material.specular = { source.specular[0], source.specular[1], source.specular[2] };
+    material.emission = { source.emission[0], source.emission[1], source.emission[2] };
+    material.shininess = source.shininess;
+    material.dissolve = source.dissolve;
+    return material;
+}
+
+std::string modelDirectory(const std::string& path) {
+    size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+// Reads material libraries from the model's directory and notes the name of each one tried, so
+// the mesh cache can tell when one of them changes
+class LibraryRecorder : public tinyobj::MaterialReader {
+public:
+    LibraryRecorder(const std::string& modelPath, std::vector<std::string>& names) : reader(modelDirectory(modelPath)), names(names) {}
+
+    bool operator()(const std::string& name, std::vector<tinyobj::material_t>* materials, std::map<std::string, int>* materialMap,
+                    std::string* warn, std::string* err) override {
+        if (std::find(names.begin(), names.end(), name) == names.end()) {
+            names.push_back(name);
+        }
+        return reader(name, materials, materialMap, warn, err);
+    }
+
+private:
+    tinyobj::MaterialFileReader reader;
+    std::vector<std::string>& names;
+};
+
+static bool parseObj(const std::string& path, tinyobj::attrib_t& attrib, std::vector<tinyobj::shape_t>& shapes,
+                     std::vector<tinyobj::material_t>& materials, std::vector<std::string>& materialLibraries) {
+    std::string warn, err;
+
+    // Parse the memory-mapped text on all cores; the result matches tinyobj::LoadObj exactly
+    MappedFile file;
+    if (!file.open(path)) {
+        std::cerr << "Failed to load: Cannot open file [" << path << "]" << std::endl;
+        return false;
+    }
+
+    LibraryRecorder materialReader(path, materialLibraries);
+    bool loaded = tinyobj::LoadObjParallel(&attrib, &shapes, &materials, &warn, &err,
+                                           (const char*)file.data(), file.size(), &materialReader);
+    if (!warn.empty()) {
+        std::cerr << "Warning loading " << path << ": " << warn << std::endl;
+    }
+    if (!loaded) {
+        std::cerr << "Failed to load: " << err << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static_assert(sizeof(tinyobj::real_t) == sizeof(float), "attrib.vertices is read as glm::vec3");
+
+// Normals for every face corner of the shapes, in shape and index order, or nothing when each
+// corner has its own vn. Files without any "s" line smooth as one group up to the crease angle;
+// otherwise the smoothing groups decide and "s off" faces are flat.
+static std::vector<glm::vec3> generateObjNormals(const std::string& path, const tinyobj::attrib_t& attrib,
+                                                 const std::vector<tinyobj::shape_t>& shapes) {
+    size_t missing = 0;
+    size_t triangleCount = 0;
+    bool triangulated = true;
+    bool anyGroup = false;
+    for (const auto& shape : shapes) {
+        for (const tinyobj::index_t& idx : shape.mesh.indices) {
+            missing += idx.normal_index < 0;
+        }
+        for (size_t f = 0; f < shape.mesh.num_face_vertices.size(); f++) {
+            triangulated &= shape.mesh.num_face_vertices[f] == 3;
+            anyGroup |= f < shape.mesh.smoothing_group_ids.size() && shape.mesh.smoothing_group_ids[f] != 0;
+        }
+        triangleCount += shape.mesh.num_face_vertices.size();
+    }
+    if (missing == 0 || !triangulated || attrib.vertices.empty()) {
+        return std::vector<glm::vec3>();
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<uint32_t> cornerPositions;
+    std::vector<uint32_t> groups;
+    cornerPositions.reserve(triangleCount * 3);
+    groups.reserve(anyGroup ? triangleCount : 0);
+    for (const auto& shape : shapes) {
+        for (const tinyobj::index_t& idx : shape.mesh.indices) {
+            cornerPositions.push_back((uint32_t)idx.vertex_index);
+        }
+        for (size_t f = 0; anyGroup && f < shape.mesh.num_face_vertices.size(); f++) {
+            groups.push_back(f < shape.mesh.smoothing_group_ids.size() ? shape.mesh.smoothing_group_ids[f] : 0);
+        }
+    }
+
+    std::vector<glm::vec3> normals(cornerPositions.size());
+    generateCornerNormals((const glm::vec3*)attrib.vertices.data(), attrib.vertices.size() / 3, cornerPositions.data(),
+                          triangleCount, anyGroup ? groups.data() : nullptr, NORMAL_CREASE_ANGLE, normals.data());
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Generated normals for " << missing << " corners of " << path << " (" << milliseconds << " ms)"
+              << std::endl;
+    return normals;
+}
+
+std::vector<Vertex> loadModel(const std::string& path) {
+    PROFILE_ZONE("loadModel");
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::vector<std::string> materialLibraries;
+    if (!parseObj(path, attrib, shapes, materials, materialLibraries)) {
+        return std::vector<Vertex>();
+    }
+
+    std::vector<glm::vec3> normals = generateObjNormals(path, attrib, shapes);
+    const glm::vec3 noNormal(0.0f);
+    size_t corner = 0;
+
+    std::vector<Vertex> vertices;
+
+    // Loop over shapes
+    for (const auto& shape : shapes) {
+        // Loop over faces
+        size_t index_offset = 0;
+        for (size_t f = 0; f < shape.mesh.num_face_vertices.size(); f++) {
+            int fv = shape.mesh.num_face_vertices[f];
+
+            // Loop over vertices in the face
+            for (size_t v = 0; v < fv; v++, corner++) {
+                vertices.push_back(makeVertex(attrib, shape.mesh.indices[index_offset + v],
+                                              normals.empty() ? noNormal : normals[corner]));
+            }
+            index_offset += fv;
+        }
+    }
+
+    std::cout << "Successfully loaded: " << path << std::endl;
+    std::cout << "Loaded " << vertices.size() << " vertices" << std::endl;
+
+    return vertices;
+}
+
+Mesh loadIndexedModel(const std::string& path) {
+    PROFILE_ZONE("loadIndexedModel");
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::vector<std::string> materialLibraries;
+    if (!parseObj(path, attrib, shapes, materials, materialLibraries)) {
+        return Mesh();
+    }
+
+    size_t cornerCount = 0;
+    for (const auto& shape : shapes) {
+        cornerCount += shape.mesh.indices.size();
+    }
+
+    // Unique vertices are bounded by the number of distinct position/normal/texcoord triples,
+    // which the attribute with the most entries approximates well
+    size_t expectedVertices = std::max(attrib.vertices.size(), attrib.normals.size()) / 3;
+
+    std::vector<glm::vec3> normals = generateObjNormals(path, attrib, shapes);
+    const glm::vec3 noNormal(0.0f);
+    size_t corner = 0;
+
+    Mesh mesh;
+    mesh.indices.reserve(cornerCount);
+    VertexWelder welder(mesh, expectedVertices);
+
+    for (const auto& shape : shapes) {
+        size_t index_offset = 0;
+        for (size_t f = 0; f < shape.mesh.num_face_vertices.size(); f++) {
+            // Start a new submesh whenever the material changes (one per usemtl run, grouped below)
+            int materialId = shape.mesh.material_ids.empty() ? -1 : shape.mesh.material_ids[f];
+            if (mesh.submeshes.empty() || mesh.submeshes.back().materialId != materialId) {
+                mesh.submeshes.push_back({ (uint32_t)mesh.indices.size(), 0, materialId });
+            }
+
+            size_t fv = shape.mesh.num_face_vertices[f];
+            for (size_t v = 0; v < fv; v++, corner++) {
+                welder.emit(makeVertex(attrib, shape.mesh.indices[index_offset + v],
+                                       normals.empty() ? noNormal : normals[corner]));
+            }
+            mesh.submeshes.back().indexCount += (uint32_t)fv;
+            index_offset += fv;
+        }
+    }
+    mesh.vertices.shrink_to_fit();
+
+    for (const auto& material : materials) {
+        mesh.materials.push_back(makeMaterial(material));
+    }
+    mesh.materialLibraries = std::move(materialLibraries);
+    groupSubmeshesByMaterial(mesh);
+
+    std::cout << "Successfully loaded: " << path << std::endl;
+    printWeldReport(path, cornerCount, mesh);
+
+    return mesh;
+}
+
+// Parser state shared by the tinyobj callbacks of loadModelStreaming
+struct StreamingLoad {
+    BlockArray<glm::vec3> positions;
+    BlockArray<glm::vec3> normals;
+    BlockArray<glm::vec2> texcoords;
+    std::vector<tinyobj::material_t> materials;
+    int materialId = -1;
+    size_t skippedFaces = 0;
+
+    Mesh* mesh = nullptr;
+    VertexWelder* welder = nullptr;
+};
+
+// Raw OBJ index (1-based, negative = relative, 0 = absent) to a 0-based index, -1 when absent
+static inline int resolveIndex(int raw, size_t count) {
+    if (raw > 0) return raw - 1;
+    if (raw < 0) return (int)count + raw;
+    return -1;
+}
+
+// Same attribute rules as makeVertex, reading from the streamed arenas
+static Vertex makeStreamedVertex(const StreamingLoad& load, const tinyobj::index_t& idx) {
+    Vertex vertex;
+    vertex.position = load.positions[idx.vertex_index];
+
+    if (idx.normal_index >= 0 && (size_t)idx.normal_index < load.normals.size()) {
+        vertex.normal = load.normals[idx.normal_index];
+    }
+    else {
+        vertex.normal = { 0.0f, 0.0f, 0.0f };
+    }
+
+    if (idx.texcoord_index >= 0 && (size_t)idx.texcoord_index < load.texcoords.size()) {
+        glm::vec2 uv = load.texcoords[idx.texcoord_index];
+        vertex.color = { uv.x, uv.y, 0.5f };
+    }
+    else {
+        vertex.color = { 1.0f, 1.0f, 1.0f };
+    }
+    return vertex;
+}
+
+static void streamVertex(void* user, tinyobj::real_t x, tinyobj::real_t y, tinyobj::real_t z, tinyobj::real_t) {
+    ((StreamingLoad*)user)->positions.push_back(glm::vec3(x, y, z));
+}
+
+static void streamNormal(void* user, tinyobj::real_t x, tinyobj::real_t y, tinyobj::real_t z) {
+    ((StreamingLoad*)user)->normals.push_back(glm::vec3(x, y, z));
+}
+
+static void streamTexcoord(void* user, tinyobj::real_t x, tinyobj::real_t y, tinyobj::real_t) {
+    ((StreamingLoad*)user)->texcoords.push_back(glm::vec2(x, y));
+}
+
+static void streamUsemtl(void* user, const char*, int materialId) {
+    ((StreamingLoad*)user)->materialId = materialId;
+}
+
+static void streamMtllib(void* user, const tinyobj::material_t* materials, int count) {
+    ((StreamingLoad*)user)->materials.assign(materials, materials + count);
+}
+
+// Triangulate and emit one face as soon as it is parsed. Quads and n-gons are split exactly
+// like tinyobj::LoadObj does, so the result matches loadIndexedModel.
+static void streamFace(void* user, tinyobj::index_t* corners, int count) {
+    StreamingLoad& load = *(StreamingLoad*)user;
+    Mesh& mesh = *load.mesh;
+
+    if (count < 3) {
+        load.skippedFaces++;
+        return;
+    }
+    for (int k = 0; k < count; k++) {
+        tinyobj::index_t& idx = corners[k];
+        idx.vertex_index = resolveIndex(idx.vertex_index, load.positions.size());
+        idx.normal_index = resolveIndex(idx.normal_index, load.normals.size());
+        idx.texcoord_index = resolveIndex(idx.texcoord_index, load.texcoords.size());
+        if (idx.vertex_index < 0 || (size_t)idx.vertex_index >= load.positions.size()) {
+            load.skippedFaces++;
+            return;
+        }
+    }
+
+    if (mesh.submeshes.empty() || mesh.submeshes.back().materialId != load.materialId) {
+        mesh.submeshes.push_back({ (uint32_t)mesh.indices.size(), 0, load.materialId });
+    }
+    size_t firstIndex = mesh.indices.size();
+
+    if (count == 3) {
+        for (int k = 0; k < 3; k++) {
+            load.welder->emit(makeStreamedVertex(load, corners[k]));
+        }
+    }
+    else if (count == 4) {
+        // Split along the shorter diagonal (same arithmetic as tinyobj's exportGroupsToShape)
+        const glm::vec3& p0 = load.positions[corners[0].vertex_index];
+        const glm::vec3& p1 = load.positions[corners[1].vertex_index];
+        const glm::vec3& p2 = load.positions[corners[2].vertex_index];
+        const glm::vec3& p3 = load.positions[corners[3].vertex_index];
+
+        tinyobj::real_t e02x = p2.x - p0.x;
+        tinyobj::real_t e02y = p2.y - p0.y;
+        tinyobj::real_t e02z = p2.z - p0.z;
+        tinyobj::real_t e13x = p3.x - p1.x;
+        tinyobj::real_t e13y = p3.y - p1.y;
+        tinyobj::real_t e13z = p3.z - p1.z;
+
+        tinyobj::real_t sqr02 = e02x * e02x + e02y * e02y + e02z * e02z;
+        tinyobj::real_t sqr13 = e13x * e13x + e13y * e13y + e13z * e13z;
+
+        static const int split02[6] = { 0, 1, 2, 0, 2, 3 };
+        static const int split13[6] = { 0, 1, 3, 1, 2, 3 };
+        const int* order = sqr02 < sqr13 ? split02 : split13;
+        for (int k = 0; k < 6; k++) {
+            load.welder->emit(makeStreamedVertex(load, corners[order[k]]));
+        }
+    }
+    else {
+        // Run tinyobj's ear clipper on a local copy of the polygon; its output indexes the corners
+        std::vector<tinyobj::real_t> polygon(3 * (size_t)count);
+        tinyobj::PrimGroup group;
+        group.faceGroup.resize(1);
+        for (int k = 0; k < count; k++) {
+            const glm::vec3& p = load.positions[corners[k].vertex_index];
+            polygon[3 * k + 0] = p.x;
+            polygon[3 * k + 1] = p.y;
+            polygon[3 * k + 2] = p.z;
+            group.faceGroup[0].vertex_indices.push_back(tinyobj::vertex_index_t(k, -1, -1));
+        }
+
+        tinyobj::shape_t triangles;
+        tinyobj::exportGroupsToShape(&triangles, group, std::vector<tinyobj::tag_t>(), 0, "", true, polygon, nullptr);
+        for (const tinyobj::index_t& idx : triangles.mesh.indices) {
+            load.welder->emit(makeStreamedVertex(load, corners[idx.vertex_index]));
+        }
+    }
+
+    mesh.submeshes.back().indexCount += (uint32_t)(mesh.indices.size() - firstIndex);
+    if (mesh.submeshes.back().indexCount == 0) {
+        mesh.submeshes.pop_back();
+    }
+}
+
+Mesh loadModelStreaming(const std::string& path) {
+    PROFILE_ZONE("loadModelStreaming");
+    MappedFile file;
+    if (!file.open(path)) {
+        std::cerr << "Failed to load: Cannot open file [" << path << "]" << std::endl;
+        return Mesh();
+    }
+
+    Mesh mesh;
+    VertexWelder welder(mesh);
+    StreamingLoad load;
+    load.mesh = &mesh;
+    load.welder = &welder;
+
+    tinyobj::callback_t callbacks;
+    callbacks.vertex_cb = streamVertex;
+    callbacks.normal_cb = streamNormal;
+    callbacks.texcoord_cb = streamTexcoord;
+    callbacks.index_cb = streamFace;
+    callbacks.usemtl_cb = streamUsemtl;
+    callbacks.mtllib_cb = streamMtllib;
+
+    // Feed the mapped text to tinyobj without copying it into a string
+    tinyobj::MemoryStreamBuf buffer((const char*)file.data(), file.size());
+    std::istream stream(&buffer);
+    LibraryRecorder materialReader(path, mesh.materialLibraries);
+    std::string warn, err;
+    bool loaded = tinyobj::LoadObjWithCallback(stream, callbacks, &load, &materialReader, &warn, &err);
+    if (!warn.empty()) {
+        std::cerr << "Warning loading " << path << ": " << warn << std::endl;
+    }
+    if (!loaded) {
+        std::cerr << "Failed to load: " << err << std::endl;
+        return Mesh();
+    }
+    if (load.skippedFaces > 0) {
+        std::cerr << "Skipped " << load.skippedFaces << " degenerate or invalid faces" << std::endl;
+    }
+
+    size_t arenaBytes = load.positions.bytes() + load.normals.bytes() + load.texcoords.bytes();
+    load.positions.clear();
+    load.normals.clear();
+    load.texcoords.clear();
+    mesh.vertices.shrink_to_fit();
+
+    // Smoothing groups are not reported by the callbacks, so missing normals come from one group
+    generateMissingNormals(mesh);
+
+    for (const auto& material : load.materials) {
+        mesh.materials.push_back(makeMaterial(material));
+    }
+    groupSubmeshesByMaterial(mesh);
+
+    std::cout << "Successfully streamed: " << path << std::endl;
+    std::cout << "  attribute arenas " << arenaBytes / 1024.0 << " KiB, mesh "
+              << (mesh.vertexBytes() + mesh.indices.size() * sizeof(uint32_t)) / 1024.0 << " KiB" << std::endl;
+    printWeldReport(path, mesh.indices.size(), mesh);
+
+    return mesh;
+}
+
+void parseObjAttributeNumbers(const std::vector<std::string>& lines, bool legacy, std::vector<float>& out) {
+    for (const std::string& line : lines) {
+        const char* token = line.c_str();
+        token += strcspn(token, " \t");
+        int count = (line.size() > 1 && line[1] == 't') ? 2 : 3;
+
+        for (int i = 0; i < count; i++) {
+            if (legacy) {
+                token += strspn(token, " \t");
+                const char* end = token + strcspn(token, " \t\r");
+                double value = 0.0;
+                tinyobj::tryParseDoubleLegacy(token, end, &value);
+                out.push_back((float)value);
+                token = end;
+            }
+            else {
+                out.push_back(tinyobj::parseReal(&token));
+            }
+        }
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Mesh.h"
+
+// Directory of path with its trailing separator, or empty for a bare file name. Material
+// libraries named by an OBJ file are looked up here, not in the working directory.
+std::string modelDirectory(const std::string& path);
+
+// Load an OBJ file as an unindexed triangle soup (one Vertex per face corner), drawn with glDrawArrays
+std::vector<Vertex> loadModel(const std::string& path);
+
+// Load an OBJ file with identical face corners welded into an indexed mesh, drawn with glDrawElements
+Mesh loadIndexedModel(const std::string& path);
+
+// Same output as loadIndexedModel, but built straight from tinyobj's callback API as faces are parsed.
+// Only the raw v/vn/vt attributes are kept (in block arenas), so attrib_t/shape_t are never
+// materialized and peak memory stays close to the size of the final mesh. Parsing is single-threaded.
+Mesh loadModelStreaming(const std::string& path);
+
+// Sources larger than this are cooked with loadModelStreaming to bound peak memory
+const size_t STREAMING_LOAD_THRESHOLD = 256u * 1024u * 1024u;
+
+// Parse the numbers of OBJ attribute lines ("v", "vn", "vt") exactly like the loader and append them
+// to out. legacy selects tinyobj's original digit-by-digit parser with strspn/strcspn token scanning
+// instead of the from_chars path. Only used by the float parsing benchmark.
+void parseObjAttributeNumbers(const std::vector<std::string>& lines, bool legacy, std::vector<float>& out);
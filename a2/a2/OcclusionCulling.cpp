@@ -0,0 +1,342 @@
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include "MappedFile.h"
+#include "OcclusionCulling.h"
+#include "Parallel.h"
+
+// Pixels are rasterized 4 at a time with SSE2, which every x86-64 CPU has
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OCCLUSION_SSE 1
+#include <emmintrin.h>
+#endif
+
+static_assert(OCCLUSION_WIDTH % 4 == 0, "rows are rasterized in groups of 4 pixels");
+
+// Instances per occludee test work item
+static const size_t OCCLUSION_TEST_CHUNK = 4096;
+
+OcclusionBuffer::OcclusionBuffer() {
+    for (int level = 0; ; level++) {
+        levels.emplace_back((size_t)levelWidth(level) * levelHeight(level), 1.0f);
+        if (levelWidth(level) == 1 && levelHeight(level) == 1) {
+            break;
+        }
+    }
+}
+
+// Transform the occluder and set up its triangles past the near plane. Window
+// coordinates are computed once per vertex; w = 0 marks a vertex closer than the near plane.
+static size_t setupTriangles(const OccluderMesh& mesh, const glm::mat4& clipFromModel, std::vector<glm::vec4>& window,
+                             std::vector<ScreenTriangle>& out) {
+    window.resize(mesh.positions.size());
+    for (size_t v = 0; v < mesh.positions.size(); v++) {
+        glm::vec4 p = clipFromModel * glm::vec4(mesh.positions[v], 1.0f);
+        if (p.w <= 0.0f || p.z < -p.w) {
+            window[v] = glm::vec4(0.0f);
+            continue;
+        }
+        float w = 1.0f / p.w;
+        window[v] = glm::vec4((p.x * w * 0.5f + 0.5f) * OCCLUSION_WIDTH, (p.y * w * 0.5f + 0.5f) * OCCLUSION_HEIGHT,
+                              p.z * w * 0.5f + 0.5f, 1.0f);
+    }
+
+    out.clear();
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        const glm::vec4& wa = window[mesh.indices[i]];
+        const glm::vec4& wb = window[mesh.indices[i + 1]];
+        const glm::vec4& wc = window[mesh.indices[i + 2]];
+        if (wa.w == 0.0f || wb.w == 0.0f || wc.w == 0.0f) {
+            continue;
+        }
+        glm::vec3 a(wa), b(wb), c(wc);
+        // Both sides are drawn: generated occluders are seldom closed, and a back face seen
+        // through a gap is still surface of the model. Clockwise triangles are turned around.
+        float area = (b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y);
+        if (area == 0.0f) {
+            continue;
+        }
+        if (area < 0.0f) {
+            std::swap(b, c);
+            area = -area;
+        }
+
+        // Pixels whose centres lie in the bounding box; triangles between centres are dropped here.
+        // Clamping first keeps far off-screen vertices from overflowing and lets truncation round.
+        glm::vec2 lo = glm::max(glm::min(glm::vec2(a), glm::min(glm::vec2(b), glm::vec2(c))), glm::vec2(-1.0f));
+        glm::vec2 hi = glm::min(glm::max(glm::vec2(a), glm::max(glm::vec2(b), glm::vec2(c))),
+                                glm::vec2((float)OCCLUSION_WIDTH + 1.0f, (float)OCCLUSION_HEIGHT + 1.0f));
+        if (hi.x < 0.5f || hi.y < 0.5f) {
+            continue;
+        }
+        ScreenTriangle triangle;
+        triangle.minX = std::max(0, (int)(lo.x + 0.5f));
+        triangle.maxX = std::min(OCCLUSION_WIDTH - 1, (int)(hi.x + 0.5f) - 1);
+        triangle.minY = std::max(0, (int)(lo.y + 0.5f));
+        triangle.maxY = std::min(OCCLUSION_HEIGHT - 1, (int)(hi.y + 0.5f) - 1);
+        if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) {
+            continue;
+        }
+
+        // Edge from p to q, positive on the left, which is the inside of a counter-clockwise triangle
+        const glm::vec3* corners[3] = { &a, &b, &c };
+        for (int k = 0; k < 3; k++) {
+            const glm::vec3& p = *corners[k];
+            const glm::vec3& q = *corners[(k + 1) % 3];
+            triangle.edges[k] = glm::vec3(p.y - q.y, q.x - p.x, p.x * q.y - p.y * q.x);
+        }
+        float dzdx = ((b.z - a.z) * (c.y - a.y) - (c.z - a.z) * (b.y - a.y)) / area;
+        float dzdy = ((c.z - a.z) * (b.x - a.x) - (b.z - a.z) * (c.x - a.x)) / area;
+        triangle.depth = glm::vec3(dzdx, dzdy, a.z - dzdx * a.x - dzdy * a.y);
+        out.push_back(triangle);
+    }
+    return out.size();
+}
+
+// Keep the nearest depth of the triangle's covered pixel centres within rows [firstRow, lastRow)
+static void rasterizeTriangle(const ScreenTriangle& triangle, int firstRow, int lastRow, float* depth) {
+    int minY = std::max(triangle.minY, firstRow);
+    int maxY = std::min(triangle.maxY, lastRow - 1);
+    int minX = triangle.minX & ~3;
+    const glm::vec3* e = triangle.edges;
+    const glm::vec3& z = triangle.depth;
+
+#ifdef OCCLUSION_SSE
+    __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    __m128 e0x = _mm_set1_ps(e[0].x), e1x = _mm_set1_ps(e[1].x), e2x = _mm_set1_ps(e[2].x), zx = _mm_set1_ps(z.x);
+    __m128 zero = _mm_setzero_ps();
+    for (int y = minY; y <= maxY; y++) {
+        float py = (float)y + 0.5f;
+        __m128 e0y = _mm_set1_ps(e[0].y * py + e[0].z);
+        __m128 e1y = _mm_set1_ps(e[1].y * py + e[1].z);
+        __m128 e2y = _mm_set1_ps(e[2].y * py + e[2].z);
+        __m128 zy = _mm_set1_ps(z.y * py + z.z);
+        float* row = depth + (size_t)y * OCCLUSION_WIDTH;
+        for (int x = minX; x <= triangle.maxX; x += 4) {
+            __m128 px = _mm_add_ps(_mm_set1_ps((float)x), offsets);
+            __m128 inside = _mm_and_ps(_mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(e0x, px), e0y), zero),
+                                       _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(e1x, px), e1y), zero));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(e2x, px), e2y), zero));
+            __m128 current = _mm_loadu_ps(row + x);
+            __m128 nearer = _mm_min_ps(current, _mm_add_ps(_mm_mul_ps(zx, px), zy));
+            _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, current)));
+        }
+    }
+#else
+    for (int y = minY; y <= maxY; y++) {
+        float py = (float)y + 0.5f;
+        float* row = depth + (size_t)y * OCCLUSION_WIDTH;
+        for (int x = minX; x <= triangle.maxX; x++) {
+            float px = (float)x + 0.5f;
+            if (e[0].x * px + (e[0].y * py + e[0].z) >= 0.0f && e[1].x * px + (e[1].y * py + e[1].z) >= 0.0f &&
+                e[2].x * px + (e[2].y * py + e[2].z) >= 0.0f) {
+                row[x] = std::min(row[x], z.x * px + (z.y * py + z.z));
+            }
+        }
+    }
+#endif
+}
+
+void OcclusionBuffer::render(const OccluderMesh& mesh, const glm::mat4& projection, const glm::mat4* viewFromModel,
+                             size_t count, unsigned int threads) {
+    this->projection = projection;
+    if (windowPositions.size() < count) {
+        windowPositions.resize(count);
+        triangles.resize(count);
+    }
+    triangleCounts.resize(count);
+    workerPool().parallelFor(count, [&](size_t i) {
+        triangleCounts[i] = setupTriangles(mesh, projection * viewFromModel[i], windowPositions[i], triangles[i]);
+    }, threads);
+    rasterized = 0;
+    for (size_t triangleCount : triangleCounts) {
+        rasterized += triangleCount;
+    }
+
+    // Each band clears its rows and draws every triangle overlapping them
+    float* depth = levels[0].data();
+    int bands = (OCCLUSION_HEIGHT + OCCLUSION_BAND_ROWS - 1) / OCCLUSION_BAND_ROWS;
+    workerPool().parallelFor((size_t)bands, [&](size_t band) {
+        int firstRow = (int)band * OCCLUSION_BAND_ROWS;
+        int lastRow = std::min(OCCLUSION_HEIGHT, firstRow + OCCLUSION_BAND_ROWS);
+        std::fill(depth + (size_t)firstRow * OCCLUSION_WIDTH, depth + (size_t)lastRow * OCCLUSION_WIDTH, 1.0f);
+        for (size_t i = 0; i < count; i++) {
+            for (const ScreenTriangle& triangle : triangles[i]) {
+                if (triangle.maxY >= firstRow && triangle.minY < lastRow) {
+                    rasterizeTriangle(triangle, firstRow, lastRow, depth);
+                }
+            }
+        }
+    }, threads);
+}
+
+void OcclusionBuffer::buildPyramid() {
+    for (int level = 1; level < levelCount(); level++) {
+        const float* below = levels[level - 1].data();
+        int belowWidth = levelWidth(level - 1), belowHeight = levelHeight(level - 1);
+        float* out = levels[level].data();
+        int width = levelWidth(level), height = levelHeight(level);
+        for (int y = 0; y < height; y++) {
+            // A side that is already 1 texel wide is not halved any further
+            int y0 = std::min(2 * y, belowHeight - 1), y1 = std::min(2 * y + 1, belowHeight - 1);
+            for (int x = 0; x < width; x++) {
+                int x0 = std::min(2 * x, belowWidth - 1), x1 = std::min(2 * x + 1, belowWidth - 1);
+                out[y * width + x] = std::max(std::max(below[y0 * belowWidth + x0], below[y0 * belowWidth + x1]),
+                                              std::max(below[y1 * belowWidth + x0], below[y1 * belowWidth + x1]));
+            }
+        }
+    }
+}
+
+bool OcclusionBuffer::occluded(const glm::mat4& viewFromBox, const glm::vec3& boxMin, const glm::vec3& boxMax) const {
+    // Corners are the first one plus any of the three edge vectors. Depth grows with view distance,
+    // so the nearest corner is the nearest point of the box.
+    glm::mat4 clipFromBox = projection * viewFromBox;
+    glm::vec4 origin = clipFromBox * glm::vec4(boxMin, 1.0f);
+    glm::vec4 size = glm::vec4(boxMax - boxMin, 0.0f);
+    glm::vec4 axes[3] = { clipFromBox[0] * size.x, clipFromBox[1] * size.y, clipFromBox[2] * size.z };
+    glm::vec2 lo(FLT_MAX), hi(-FLT_MAX);
+    float nearestDepth = 1.0f;
+    for (int corner = 0; corner < 8; corner++) {
+        glm::vec4 clip = origin;
+        for (int axis = 0; axis < 3; axis++) {
+            if (corner & (1 << axis)) clip += axes[axis];
+        }
+        if (clip.w <= 0.0f || clip.z < -clip.w) {
+            return false;
+        }
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        lo = glm::min(lo, glm::vec2(ndc));
+        hi = glm::max(hi, glm::vec2(ndc));
+        nearestDepth = std::min(nearestDepth, ndc.z * 0.5f + 0.5f);
+    }
+    if (lo.x > 1.0f || lo.y > 1.0f || hi.x < -1.0f || hi.y < -1.0f) {
+        return false;
+    }
+    int x0 = std::max(0, (int)std::floor((lo.x * 0.5f + 0.5f) * OCCLUSION_WIDTH));
+    int x1 = std::min(OCCLUSION_WIDTH - 1, (int)std::floor((hi.x * 0.5f + 0.5f) * OCCLUSION_WIDTH));
+    int y0 = std::max(0, (int)std::floor((lo.y * 0.5f + 0.5f) * OCCLUSION_HEIGHT));
+    int y1 = std::min(OCCLUSION_HEIGHT - 1, (int)std::floor((hi.y * 0.5f + 0.5f) * OCCLUSION_HEIGHT));
+
+    int level = 0;
+    while ((x1 >> level) - (x0 >> level) >= OCCLUSION_TEST_TEXELS ||
+           (y1 >> level) - (y0 >> level) >= OCCLUSION_TEST_TEXELS) {
+        level++;
+    }
+    int width = levelWidth(level), height = levelHeight(level);
+    const float* texels = levels[level].data();
+    float farthest = 0.0f;
+    for (int y = std::min(y0 >> level, height - 1); y <= std::min(y1 >> level, height - 1); y++) {
+        for (int x = std::min(x0 >> level, width - 1); x <= std::min(x1 >> level, width - 1); x++) {
+            farthest = std::max(farthest, texels[y * width + x]);
+        }
+    }
+    return nearestDepth > farthest;
+}
+
+bool OcclusionBuffer::dumpLevels(const std::string& prefix) const {
+    // Linear view distance of a window depth, from the projection's depth terms
+    auto distance = [&](float depth) {
+        float ndc = depth * 2.0f - 1.0f;
+        return projection[3][2] / (ndc + projection[2][2]);
+    };
+
+    for (int level = 0; level < levelCount(); level++) {
+        int width = levelWidth(level), height = levelHeight(level);
+        const std::vector<float>& texels = levels[level];
+        std::ostringstream name;
+        name << prefix << level;
+
+        // PFM: little-endian floats (negative scale), rows bottom to top like the buffer
+        std::ostringstream header;
+        header << "Pf\n" << width << " " << height << "\n-1.0\n";
+        std::string pfmHeader = header.str();
+        std::vector<unsigned char> pfm(pfmHeader.begin(), pfmHeader.end());
+        pfm.resize(pfmHeader.size() + texels.size() * sizeof(float));
+        std::memcpy(pfm.data() + pfmHeader.size(), texels.data(), texels.size() * sizeof(float));
+
+        float nearest = FLT_MAX, farthest = 0.0f;
+        for (float depth : texels) {
+            if (depth < 1.0f) {
+                nearest = std::min(nearest, distance(depth));
+                farthest = std::max(farthest, distance(depth));
+            }
+        }
+        float range = farthest > nearest ? farthest - nearest : 1.0f;
+
+        // PGM: 8-bit, rows top to bottom
+        header.str("");
+        header << "P5\n" << width << " " << height << "\n255\n";
+        std::string pgmHeader = header.str();
+        std::vector<unsigned char> pgm(pgmHeader.begin(), pgmHeader.end());
+        for (int y = height - 1; y >= 0; y--) {
+            for (int x = 0; x < width; x++) {
+                float depth = texels[(size_t)y * width + x];
+                pgm.push_back(depth >= 1.0f ? 255 : (unsigned char)(254.0f * (distance(depth) - nearest) / range));
+            }
+        }
+
+        if (!writeFileAtomically(name.str() + ".pfm", pfm) || !writeFileAtomically(name.str() + ".pgm", pgm)) {
+            std::cerr << "Failed to write occlusion dump " << name.str() << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+static float maxAxisScale(const glm::mat4& transform) {
+    return std::max(glm::length(glm::vec3(transform[0])),
+                    std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+}
+
+void OcclusionBuffer::selectOccluders(const InstanceBounds& bounds, const VisibleInstances& visible,
+                                      const glm::mat4& viewFromModel, size_t maxCount, std::vector<uint32_t>& occluders) {
+    // Projected size goes with radius over distance
+    float scale = maxAxisScale(viewFromModel);
+    std::vector<std::pair<float, uint32_t>>& sizes = occluderSizes;
+    sizes.resize(visible.count);
+    for (size_t i = 0; i < visible.count; i++) {
+        uint32_t index = visible.indices[i];
+        glm::vec3 center = glm::vec3(viewFromModel * glm::vec4(bounds.x[index], bounds.y[index], bounds.z[index], 1.0f));
+        sizes[i] = { bounds.radius[index] * scale / std::max(glm::length(center), 1e-6f), index };
+    }
+
+    size_t count = std::min(maxCount, sizes.size());
+    std::partial_sort(sizes.begin(), sizes.begin() + count, sizes.end(),
+                      [](const std::pair<float, uint32_t>& a, const std::pair<float, uint32_t>& b) { return a.first > b.first; });
+    occluders.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        occluders[i] = sizes[i].second;
+    }
+}
+
+size_t OcclusionBuffer::cullOccludedInstances(const InstanceSet& instances, const glm::vec3& boxMin, const glm::vec3& boxMax,
+                                              const glm::mat4& viewFromModel, VisibleInstances& visible, unsigned int threads) {
+    // Chunks compact in place, then move down over the gaps left before them
+    uint32_t* indices = visible.indices.data();
+    size_t chunks = (visible.count + OCCLUSION_TEST_CHUNK - 1) / OCCLUSION_TEST_CHUNK;
+    std::vector<size_t>& kept = chunkKept;
+    kept.resize(chunks);
+    workerPool().parallelFor(chunks, [&](size_t chunk) {
+        size_t first = chunk * OCCLUSION_TEST_CHUNK;
+        size_t last = std::min(visible.count, first + OCCLUSION_TEST_CHUNK);
+        size_t out = first;
+        for (size_t i = first; i < last; i++) {
+            glm::mat4 viewFromBox = viewFromModel * unpackInstanceTransform(instances.data()[indices[i]]);
+            if (!occluded(viewFromBox, boxMin, boxMax)) {
+                indices[out++] = indices[i];
+            }
+        }
+        kept[chunk] = out - first;
+    }, threads);
+
+    size_t count = 0;
+    for (size_t chunk = 0; chunk < chunks; chunk++) {
+        std::memmove(indices + count, indices + chunk * OCCLUSION_TEST_CHUNK, kept[chunk] * sizeof(uint32_t));
+        count += kept[chunk];
+    }
+    visible.count = count;
+    return count;
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "InstanceCulling.h"
+#include "MeshSimplifier.h"
+
+// Resolution of the CPU depth buffer (powers of two, width a multiple of 4)
+const int OCCLUSION_WIDTH = 256;
+const int OCCLUSION_HEIGHT = 128;
+// Rows per rasterizer work item; bands never share a pixel, so they need no locking
+const int OCCLUSION_BAND_ROWS = 16;
+// Texels an occludee's screen rectangle may span per side at the pyramid level it is tested on.
+// A 2x2 lookup reads texels up to twice the rectangle's size, mostly sky around a long low car.
+const int OCCLUSION_TEST_TEXELS = 4;
+// Instances rasterized as occluders per frame, the largest on screen first
+const size_t MAX_OCCLUDERS = 32;
+
+// Occluder triangle after setup: edge functions and depth as planes over pixel coordinates
+struct ScreenTriangle {
+    glm::vec3 edges[3]; // e(x, y) = edge.x * x + edge.y * y + edge.z, >= 0 inside
+    glm::vec3 depth;    // [0, 1] window depth, same form
+    int minX, maxX, minY, maxY;
+};
+
+// Low-resolution depth buffer of the biggest occluders and its max pyramid. Level 0 is the depth
+// buffer; every further level holds the farthest depth of 2x2 texels of the one below, so an
+// occludee whose nearest depth lies behind a texel's value is hidden behind all of it.
+// Rows run bottom to top, as in GL window coordinates.
+class OcclusionBuffer {
+public:
+    OcclusionBuffer();
+
+    // Clear to the far plane and draw the mesh once per transform (projection * viewFromModel[i]).
+    // Triangles crossing the near plane are skipped rather than clipped, which only ever lets more
+    // through. Setup runs per occluder and rasterizing per band of rows, each on up to `threads`
+    // threads (0 = one per hardware thread).
+    void render(const OccluderMesh& mesh, const glm::mat4& projection, const glm::mat4* viewFromModel, size_t count,
+                unsigned int threads = 0);
+    void buildPyramid();
+
+    // Whether a box is certainly hidden: its nearest corner lies behind every texel under its
+    // screen rectangle, read from the first level where that spans at most OCCLUSION_TEST_TEXELS
+    // per side. Boxes crossing the near plane or off screen are never hidden.
+    bool occluded(const glm::mat4& viewFromBox, const glm::vec3& boxMin, const glm::vec3& boxMax) const;
+
+    // The visible instances whose spheres cover the most of the screen, largest first
+    void selectOccluders(const InstanceBounds& bounds, const VisibleInstances& visible, const glm::mat4& viewFromModel,
+                         size_t maxCount, std::vector<uint32_t>& occluders);
+
+    // Drop the visible instances whose model box, placed by each instance's transform, this buffer
+    // hides. The list stays ascending; returns how many remain.
+    size_t cullOccludedInstances(const InstanceSet& instances, const glm::vec3& boxMin, const glm::vec3& boxMax,
+                                 const glm::mat4& viewFromModel, VisibleInstances& visible, unsigned int threads = 0);
+
+    size_t triangleCount() const { return rasterized; }
+    int levelCount() const { return (int)levels.size(); }
+    int levelWidth(int level) const { return std::max(1, OCCLUSION_WIDTH >> level); }
+    int levelHeight(int level) const { return std::max(1, OCCLUSION_HEIGHT >> level); }
+    const float* levelData(int level) const { return levels[level].data(); }
+
+    // Write every level as <prefix><level>.pfm (exact floats) and .pgm (linear depth stretched
+    // to the covered range, far plane white) for inspection without a GPU
+    bool dumpLevels(const std::string& prefix) const;
+
+private:
+    glm::mat4 projection = glm::mat4(1.0f);
+    std::vector<std::vector<float>> levels;
+    std::vector<std::vector<glm::vec4>> windowPositions;   // per occluder
+    std::vector<std::vector<ScreenTriangle>> triangles;    // per occluder
+    size_t rasterized = 0;
+
+    // Per-frame scratch, kept to reuse its memory
+    std::vector<size_t> triangleCounts;                    // per occluder
+    std::vector<std::pair<float, uint32_t>> occluderSizes; // per visible instance
+    std::vector<size_t> chunkKept;                         // per chunk of occlusion tests
+};
@@ -0,0 +1,93 @@
+#include "Parallel.h"
+
+WorkerPool::WorkerPool() {
+    unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+    helpers.reserve(threads - 1);
+    for (unsigned int t = 1; t < threads; t++) {
+        helpers.emplace_back(&WorkerPool::helperLoop, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    posted.notify_all();
+    for (std::thread& helper : helpers) {
+        helper.join();
+    }
+}
+
+void WorkerPool::work(Job& job) {
+    for (size_t i = job.next.fetch_add(1); i < job.count; i = job.next.fetch_add(1)) {
+        job.invoke(job.task, i);
+    }
+}
+
+void WorkerPool::helperLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        posted.wait(lock, [this]() { return stopping || !jobs.empty(); });
+        if (stopping) {
+            return;
+        }
+        // The newest job first: a task waiting on a nested job holds up its own
+        Job* job = jobs.back();
+        job->working++;
+        if (--job->openSlots == 0) {
+            jobs.pop_back();
+        }
+        lock.unlock();
+        work(*job);
+        lock.lock();
+        if (--job->working == 0) {
+            finished.notify_all();
+        }
+    }
+}
+
+void WorkerPool::run(size_t count, unsigned int threads, void (*invoke)(const void*, size_t), const void* task) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    size_t workers = std::min((size_t)threads, count);
+    Job job;
+    job.invoke = invoke;
+    job.task = task;
+    job.count = count;
+    // Helpers change openSlots under the mutex once the job is posted, so decide from a copy
+    size_t slots = std::min(workers > 0 ? workers - 1 : 0, helpers.size());
+    job.openSlots = slots;
+    if (slots == 0) {
+        for (size_t i = 0; i < count; i++) {
+            invoke(task, i);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(&job);
+    }
+    if (slots == 1) {
+        posted.notify_one();
+    }
+    else {
+        posted.notify_all();
+    }
+    work(job);
+
+    // Every item is claimed; close the job to latecomers and wait for the helpers still on one
+    std::unique_lock<std::mutex> lock(mutex);
+    std::vector<Job*>::iterator listed = std::find(jobs.begin(), jobs.end(), &job);
+    if (listed != jobs.end()) {
+        jobs.erase(listed);
+    }
+    finished.wait(lock, [&job]() { return job.working == 0; });
+}
+
+WorkerPool& workerPool() {
+    static WorkerPool pool;
+    return pool;
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Run task(i) for every i in [0, count) on up to `threads` threads (0 = one per hardware thread).
+// Items are handed out one at a time from a shared counter, so uneven items balance themselves.
+// The calling thread takes part; with one worker everything runs inline in index order.
+// Threads are started and joined per call, which is fine for one-off work such as cooking a
+// mesh; work repeated every frame goes through workerPool() instead.
+template <typename Task>
+void parallelFor(size_t count, const Task& task, unsigned int threads = 0) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    size_t workers = std::min((size_t)threads, count);
+    if (workers <= 1) {
+        for (size_t i = 0; i < count; i++) {
+            task(i);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+            task(i);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(workers - 1);
+    for (size_t t = 1; t < workers; t++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+}
+
+// Helper threads started once and kept asleep between jobs, so per-frame work pays for a wakeup
+// instead of thread creation. parallelFor hands items out exactly like the free function and
+// the calling thread takes part; helpers busy with another caller's job simply do not join, so
+// a caller never waits for a job other than its own. Jobs may be posted from several threads at
+// once and from inside a task.
+class WorkerPool {
+public:
+    // One helper per hardware thread besides the caller
+    WorkerPool();
+    ~WorkerPool();
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    template <typename Task>
+    void parallelFor(size_t count, const Task& task, unsigned int threads = 0) {
+        run(count, threads, [](const void* context, size_t i) { (*(const Task*)context)(i); }, &task);
+    }
+
+    size_t helperCount() const { return helpers.size(); }
+
+private:
+    struct Job {
+        void (*invoke)(const void*, size_t) = nullptr;
+        const void* task = nullptr;
+        size_t count = 0;
+        std::atomic<size_t> next{ 0 };
+        size_t openSlots = 0; // helpers that may still join
+        size_t working = 0;   // helpers inside work(), guarded by the pool's mutex
+    };
+
+    void run(size_t count, unsigned int threads, void (*invoke)(const void*, size_t), const void* task);
+    void helperLoop();
+    static void work(Job& job);
+
+    std::mutex mutex;
+    std::condition_variable posted;   // a job was posted, or the pool is stopping
+    std::condition_variable finished; // a helper left a job
+    std::vector<Job*> jobs;           // jobs with open slots, newest last
+    std::vector<std::thread> helpers;
+    bool stopping = false;
+};
+
+// The pool shared by per-frame work, started on first use
+WorkerPool& workerPool();
@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include "PngWriter.h"
+
+// Largest payload of one stored deflate block
+static const size_t STORED_BLOCK_BYTES = 65535;
+
+static uint32_t crcTable[256];
+
+static uint32_t crc32(uint32_t crc, const unsigned char* data, size_t size) {
+    if (crcTable[1] == 0) {
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++) {
+                c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            crcTable[n] = c;
+        }
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = crcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static void putBigEndian(std::vector<unsigned char>& out, uint32_t value) {
+    out.push_back((unsigned char)(value >> 24));
+    out.push_back((unsigned char)(value >> 16));
+    out.push_back((unsigned char)(value >> 8));
+    out.push_back((unsigned char)value);
+}
+
+// Length, type, data, then the CRC of type and data
+static void putChunk(std::vector<unsigned char>& out, const char* type, const std::vector<unsigned char>& data) {
+    putBigEndian(out, (uint32_t)data.size());
+    size_t typeStart = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    putBigEndian(out, crc32(0, &out[typeStart], out.size() - typeStart));
+}
+
+bool writePng(const std::string& path, const unsigned char* rgb, int width, int height, bool rowsBottomUp) {
+    // Scanlines, each led by filter type 0 (none)
+    size_t rowBytes = (size_t)width * 3;
+    std::vector<unsigned char> scanlines;
+    scanlines.reserve((rowBytes + 1) * height);
+    for (int y = 0; y < height; y++) {
+        const unsigned char* row = rgb + rowBytes * (rowsBottomUp ? height - 1 - y : y);
+        scanlines.push_back(0);
+        scanlines.insert(scanlines.end(), row, row + rowBytes);
+    }
+
+    // zlib stream: header, stored blocks, Adler-32 of the uncompressed data
+    std::vector<unsigned char> zlib = { 0x78, 0x01 };
+    uint32_t adlerA = 1, adlerB = 0;
+    for (size_t offset = 0; offset < scanlines.size() || offset == 0; offset += STORED_BLOCK_BYTES) {
+        size_t size = std::min(STORED_BLOCK_BYTES, scanlines.size() - offset);
+        zlib.push_back(offset + size == scanlines.size() ? 1 : 0); // BFINAL, BTYPE = stored
+        zlib.push_back((unsigned char)size);
+        zlib.push_back((unsigned char)(size >> 8));
+        zlib.push_back((unsigned char)~size);
+        zlib.push_back((unsigned char)(~size >> 8));
+        zlib.insert(zlib.end(), scanlines.begin() + offset, scanlines.begin() + offset + size);
+        for (size_t i = offset; i < offset + size; i++) {
+            adlerA = (adlerA + scanlines[i]) % 65521;
+            adlerB = (adlerB + adlerA) % 65521;
+        }
+    }
+    putBigEndian(zlib, adlerB << 16 | adlerA);
+
+    std::vector<unsigned char> header;
+    putBigEndian(header, (uint32_t)width);
+    putBigEndian(header, (uint32_t)height);
+    header.insert(header.end(), { 8, 2, 0, 0, 0 }); // 8 bits per channel, RGB, no interlace
+
+    std::vector<unsigned char> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    putChunk(png, "IHDR", header);
+    putChunk(png, "IDAT", zlib);
+    putChunk(png, "IEND", std::vector<unsigned char>());
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.write((const char*)png.data(), png.size())) {
+        std::cerr << "Failed to write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,7 @@
+#pragma once
+#include <string>
+
+// Write 8-bit RGB pixels as a PNG. The image data is stored uncompressed (deflate "stored"
+// blocks), which any PNG reader accepts and needs no zlib; regression dumps are small enough.
+// Rows are read bottom to top when rowsBottomUp is set, as glReadPixels returns them.
+bool writePng(const std::string& path, const unsigned char* rgb, int width, int height, bool rowsBottomUp = false);
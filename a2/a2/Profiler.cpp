@@ -0,0 +1,266 @@
+#include "Profiler.h"
+#if A2_PROFILE
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+static_assert((PROFILE_RING_EVENTS & (PROFILE_RING_EVENTS - 1)) == 0, "PROFILE_RING_EVENTS must be a power of two");
+
+struct ProfileEvent {
+    const char* name;
+    uint64_t start;
+    uint64_t end;
+};
+
+// The zones of one thread. Only the owning thread writes; head is published after the event,
+// so a reader never sees a half-written one. A ring outlives its thread and is handed to the
+// next new thread, so pools of short-lived workers reuse a few rings instead of piling them up.
+struct ProfileRing {
+    std::vector<ProfileEvent> events = std::vector<ProfileEvent>(PROFILE_RING_EVENTS);
+    std::atomic<uint64_t> head{ 0 };
+    std::string name;
+    uint32_t lane = 0;
+    bool inUse = false;
+};
+
+struct ProfilerState {
+    std::mutex mutex; // rings and their names; taken when a thread starts or ends, never per zone
+    std::vector<std::unique_ptr<ProfileRing>> rings;
+
+    // Timestamps count from here; steady_clock over the same span calibrates them
+    uint64_t originTicks = profilerTimestamp();
+    std::chrono::steady_clock::time_point originTime = std::chrono::steady_clock::now();
+
+    // GPU zones, in GL timestamp nanoseconds; gpuOriginNs was read when the CPU was at gpuOriginTicks
+    ProfileRing gpuRing;
+    int64_t gpuOriginNs = 0;
+    uint64_t gpuOriginTicks = 0;
+
+    // Frame marks, from the render loop's thread only
+    uint64_t lastFrame = 0;
+    std::vector<uint64_t> frameTicks = std::vector<uint64_t>(PROFILE_FRAME_WINDOW);
+    size_t frameCount = 0;
+};
+
+static ProfilerState& profilerState() {
+    static ProfilerState state;
+    return state;
+}
+
+// Fix the origin before main, ahead of any zone
+static ProfilerState& profilerOrigin = profilerState();
+
+static ProfileRing* acquireRing() {
+    ProfilerState& state = profilerState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    for (std::unique_ptr<ProfileRing>& ring : state.rings) {
+        if (!ring->inUse) {
+            // The name goes on reuse, not on release, so a finished thread keeps it until then
+            ring->inUse = true;
+            ring->name.clear();
+            return ring.get();
+        }
+    }
+    state.rings.push_back(std::make_unique<ProfileRing>());
+    ProfileRing* ring = state.rings.back().get();
+    ring->lane = (uint32_t)state.rings.size() - 1;
+    ring->inUse = true;
+    return ring;
+}
+
+// Gives the thread's ring back when the thread ends
+struct RingOwner {
+    ProfileRing* ring = nullptr;
+    ~RingOwner() {
+        if (ring) {
+            std::lock_guard<std::mutex> lock(profilerState().mutex);
+            ring->inUse = false;
+        }
+    }
+};
+static thread_local RingOwner ringOwner;
+
+void profilerRecord(const char* name, uint64_t start, uint64_t end) {
+    ProfileRing* ring = ringOwner.ring;
+    if (!ring) {
+        ring = ringOwner.ring = acquireRing();
+    }
+    uint64_t index = ring->head.load(std::memory_order_relaxed);
+    ring->events[index & (PROFILE_RING_EVENTS - 1)] = { name, start, end };
+    ring->head.store(index + 1, std::memory_order_release);
+}
+
+void profilerFrame() {
+    ProfilerState& state = profilerState();
+    uint64_t now = profilerTimestamp();
+    if (state.lastFrame != 0) {
+        state.frameTicks[state.frameCount++ % PROFILE_FRAME_WINDOW] = now - state.lastFrame;
+    }
+    state.lastFrame = now;
+}
+
+void profilerCalibrateGpu(int64_t gpuNs) {
+    ProfilerState& state = profilerState();
+    state.gpuOriginTicks = profilerTimestamp();
+    state.gpuOriginNs = gpuNs;
+}
+
+void profilerRecordGpu(const char* name, uint64_t startNs, uint64_t endNs) {
+    ProfileRing& ring = profilerState().gpuRing;
+    uint64_t index = ring.head.load(std::memory_order_relaxed);
+    ring.events[index & (PROFILE_RING_EVENTS - 1)] = { name, startNs, endNs };
+    ring.head.store(index + 1, std::memory_order_release);
+}
+
+void profilerNameThread(const char* name) {
+    if (!ringOwner.ring) {
+        ringOwner.ring = acquireRing();
+    }
+    std::lock_guard<std::mutex> lock(profilerState().mutex);
+    ringOwner.ring->name = name;
+}
+
+static double microsecondsPerTick() {
+    ProfilerState& state = profilerState();
+    uint64_t ticks = profilerTimestamp() - state.originTicks;
+    double microseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - state.originTime).count();
+    return ticks > 0 ? microseconds / ticks : 0.0;
+}
+
+// The events a ring still holds, oldest first
+static std::vector<ProfileEvent> ringEvents(const ProfileRing& ring) {
+    uint64_t head = ring.head.load(std::memory_order_acquire);
+    uint64_t count = std::min<uint64_t>(head, PROFILE_RING_EVENTS);
+    std::vector<ProfileEvent> events;
+    events.reserve((size_t)count);
+    for (uint64_t i = head - count; i < head; i++) {
+        events.push_back(ring.events[i & (PROFILE_RING_EVENTS - 1)]);
+    }
+    return events;
+}
+
+static void writeJsonString(std::ostream& out, const std::string& text) {
+    out << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out << '\\';
+        }
+        out << c;
+    }
+    out << '"';
+}
+
+bool profilerWriteTrace(const std::string& path) {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Failed to write trace " << path << std::endl;
+        return false;
+    }
+    ProfilerState& state = profilerState();
+    double scale = microsecondsPerTick();
+    std::lock_guard<std::mutex> lock(state.mutex);
+
+    out << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    size_t written = 0;
+    for (const std::unique_ptr<ProfileRing>& ring : state.rings) {
+        std::string name = ring->name.empty() ? "thread " + std::to_string(ring->lane) : ring->name;
+        out << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring->lane
+            << ",\"args\":{\"name\":";
+        writeJsonString(out, name);
+        out << "}}";
+        first = false;
+
+        for (const ProfileEvent& event : ringEvents(*ring)) {
+            out << ",\n{\"name\":";
+            writeJsonString(out, event.name);
+            out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << ring->lane
+                << ",\"ts\":" << (double)(int64_t)(event.start - state.originTicks) * scale
+                << ",\"dur\":" << (double)(event.end - event.start) * scale << "}";
+            written++;
+        }
+    }
+
+    // The GPU lane comes after the threads; its zones are offset from the calibration point
+    std::vector<ProfileEvent> gpuEvents = ringEvents(state.gpuRing);
+    if (!gpuEvents.empty()) {
+        size_t lane = state.rings.size();
+        out << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << lane
+            << ",\"args\":{\"name\":\"GPU\"}}";
+        double gpuOriginUs = (double)(int64_t)(state.gpuOriginTicks - state.originTicks) * scale;
+        for (const ProfileEvent& event : gpuEvents) {
+            out << ",\n{\"name\":";
+            writeJsonString(out, event.name);
+            out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << lane
+                << ",\"ts\":" << gpuOriginUs + (double)((int64_t)event.start - state.gpuOriginNs) / 1000.0
+                << ",\"dur\":" << (double)(event.end - event.start) / 1000.0 << "}";
+            written++;
+        }
+    }
+    out << "\n]}\n";
+    if (!out) {
+        std::cerr << "Failed to write trace " << path << std::endl;
+        return false;
+    }
+    std::cout << "Wrote " << written << " zones from " << state.rings.size() << " threads" << (gpuEvents.empty() ? "" : " and the GPU")
+              << " to " << path << std::endl;
+    return true;
+}
+
+void profilerPrintSummary() {
+    ProfilerState& state = profilerState();
+    double scale = microsecondsPerTick();
+
+    size_t frames = std::min(state.frameCount, PROFILE_FRAME_WINDOW);
+    if (frames > 0) {
+        std::vector<uint64_t> sorted(state.frameTicks.begin(), state.frameTicks.begin() + frames);
+        std::sort(sorted.begin(), sorted.end());
+        auto percentileMs = [&](double p) { return sorted[std::min(frames - 1, (size_t)(p * frames))] * scale / 1000.0; };
+        std::cout << "Frame time over the last " << frames << " frames: p50 " << percentileMs(0.50) << " ms, p95 "
+                  << percentileMs(0.95) << " ms, p99 " << percentileMs(0.99) << " ms, worst " << sorted.back() * scale / 1000.0
+                  << " ms" << std::endl;
+    }
+
+    struct ZoneTotals {
+        size_t count = 0;
+        double totalUs = 0.0;
+        double worstUs = 0.0;
+    };
+    std::map<std::string, ZoneTotals> zones;
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        for (const std::unique_ptr<ProfileRing>& ring : state.rings) {
+            for (const ProfileEvent& event : ringEvents(*ring)) {
+                ZoneTotals& totals = zones[event.name];
+                double us = (event.end - event.start) * scale;
+                totals.count++;
+                totals.totalUs += us;
+                totals.worstUs = std::max(totals.worstUs, us);
+            }
+        }
+        for (const ProfileEvent& event : ringEvents(state.gpuRing)) {
+            ZoneTotals& totals = zones[std::string("GPU ") + event.name];
+            double us = (event.end - event.start) / 1000.0;
+            totals.count++;
+            totals.totalUs += us;
+            totals.worstUs = std::max(totals.worstUs, us);
+        }
+    }
+    std::vector<std::pair<std::string, ZoneTotals>> byTotal(zones.begin(), zones.end());
+    std::sort(byTotal.begin(), byTotal.end(), [](const std::pair<std::string, ZoneTotals>& a, const std::pair<std::string, ZoneTotals>& b) {
+        return a.second.totalUs > b.second.totalUs;
+    });
+    for (const std::pair<std::string, ZoneTotals>& zone : byTotal) {
+        std::cout << "  " << zone.first << ": " << zone.second.count << " zones, avg " << zone.second.totalUs / zone.second.count
+                  << " us, worst " << zone.second.worstUs << " us, total " << zone.second.totalUs / 1000.0 << " ms" << std::endl;
+    }
+}
+
+#endif
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+// Scoped CPU zones: PROFILE_ZONE("name") times the rest of the enclosing scope. Each thread
+// appends finished zones to its own ring of the last PROFILE_RING_EVENTS zones, so recording
+// takes no lock; PROFILE_FRAME() marks the end of a frame for the frame time percentiles.
+// Build with A2_PROFILE=0 and every macro expands to nothing.
+#ifndef A2_PROFILE
+#define A2_PROFILE 1
+#endif
+
+// Zones kept per thread; older ones are overwritten
+const size_t PROFILE_RING_EVENTS = 1 << 16;
+// Frames the percentile summary covers, the most recent ones
+const size_t PROFILE_FRAME_WINDOW = 1024;
+
+#if A2_PROFILE
+
+// Raw timestamp: the time stamp counter where there is one, else steady_clock ticks. Both are
+// converted to microseconds by measuring them against steady_clock over the run.
+inline uint64_t profilerTimestamp() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+// Append a finished zone to the calling thread's ring. name must outlive the profiler (a literal).
+void profilerRecord(const char* name, uint64_t start, uint64_t end);
+// End a frame: its time since the previous mark goes into the percentile window
+void profilerFrame();
+// Label the calling thread's lane in the trace
+void profilerNameThread(const char* name);
+
+// GPU zones (see GpuTimer.h), timed in nanoseconds of the GL timestamp clock. Calibrating pairs a
+// reading of that clock with a CPU timestamp taken now, which places GPU zones on the CPU
+// timeline in a lane of their own. Record from the thread that owns the GL context.
+void profilerCalibrateGpu(int64_t gpuNs);
+void profilerRecordGpu(const char* name, uint64_t startNs, uint64_t endNs);
+
+// Write every ring as Chrome trace JSON (chrome://tracing, Perfetto). Call once the threads
+// being profiled are idle.
+bool profilerWriteTrace(const std::string& path);
+// Frame time p50/p95/p99 over the last PROFILE_FRAME_WINDOW frames, and each zone's count and
+// average over what the rings still hold
+void profilerPrintSummary();
+
+class ProfileZone {
+public:
+    explicit ProfileZone(const char* zoneName) : name(zoneName), start(profilerTimestamp()) {}
+    ~ProfileZone() { profilerRecord(name, start, profilerTimestamp()); }
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    const char* name;
+    uint64_t start;
+};
+
+#define PROFILE_JOIN2(a, b) a##b
+#define PROFILE_JOIN(a, b) PROFILE_JOIN2(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_JOIN(profileZone, __LINE__)(name)
+#define PROFILE_FRAME() profilerFrame()
+#define PROFILE_THREAD(name) profilerNameThread(name)
+
+#else
+
+#define PROFILE_ZONE(name)
+#define PROFILE_FRAME()
+#define PROFILE_THREAD(name)
+
+#endif
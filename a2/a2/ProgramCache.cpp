@@ -0,0 +1,112 @@
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include "MappedFile.h"
+#include "ProgramCache.h"
+
+namespace fs = std::filesystem;
+
+// On-disk entry header, followed by the binary itself
+struct ProgramCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint32_t binaryFormat;
+    uint32_t binarySize;
+};
+
+static const char PROGRAM_CACHE_MAGIC[4] = { 'A', '2', 'P', 'B' };
+
+// 64-bit FNV-1a over a string and its terminator, so ("ab", "c") and ("a", "bc") differ
+static uint64_t hashString(uint64_t hash, const char* text) {
+    for (const char* c = text ? text : ""; ; c++) {
+        hash = (hash ^ (uint8_t)*c) * 0x100000001B3ull;
+        if (*c == '\0') {
+            return hash;
+        }
+    }
+}
+
+bool programBinariesSupported() {
+    if (!GLEW_ARB_get_program_binary && !GLEW_VERSION_4_1) {
+        return false;
+    }
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+uint64_t programCacheKey(const std::string& vertexSource, const std::string& fragmentSource) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    hash = hashString(hash, vertexSource.c_str());
+    hash = hashString(hash, fragmentSource.c_str());
+    hash = hashString(hash, (const char*)glGetString(GL_VENDOR));
+    hash = hashString(hash, (const char*)glGetString(GL_RENDERER));
+    hash = hashString(hash, (const char*)glGetString(GL_VERSION));
+    return hash;
+}
+
+std::string programCachePath(const std::string& directory, uint64_t key) {
+    std::ostringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << key << ".progbin";
+    return (fs::path(directory) / name.str()).string();
+}
+
+ProgramBinaryLoad loadProgramBinary(const std::string& path, uint64_t key, GLuint program) {
+    MappedFile file;
+    if (!file.open(path) || file.size() < sizeof(ProgramCacheHeader)) {
+        return ProgramBinaryLoad::Missing;
+    }
+
+    ProgramCacheHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    bool valid = std::memcmp(header.magic, PROGRAM_CACHE_MAGIC, sizeof(header.magic)) == 0 &&
+                 header.version == PROGRAM_CACHE_VERSION && header.key == key &&
+                 file.size() == sizeof(header) + header.binarySize;
+
+    GLint linked = 0;
+    if (valid) {
+        glProgramBinary(program, (GLenum)header.binaryFormat, file.data() + sizeof(header), (GLsizei)header.binarySize);
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    }
+    if (linked) {
+        return ProgramBinaryLoad::Loaded;
+    }
+
+    // Drivers may refuse their own binaries after an update; the entry is rewritten after the rebuild
+    file.close();
+    std::error_code ec;
+    fs::remove(path, ec);
+    return ProgramBinaryLoad::Rejected;
+}
+
+bool storeProgramBinary(const std::string& path, uint64_t key, GLuint program) {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return false;
+    }
+
+    std::vector<unsigned char> entry(sizeof(ProgramCacheHeader) + (size_t)length);
+    GLenum format = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &format, entry.data() + sizeof(ProgramCacheHeader));
+    if (written <= 0) {
+        return false;
+    }
+    entry.resize(sizeof(ProgramCacheHeader) + (size_t)written);
+
+    ProgramCacheHeader header = {};
+    std::memcpy(header.magic, PROGRAM_CACHE_MAGIC, sizeof(header.magic));
+    header.version = PROGRAM_CACHE_VERSION;
+    header.key = key;
+    header.binaryFormat = (uint32_t)format;
+    header.binarySize = (uint32_t)written;
+    std::memcpy(entry.data(), &header, sizeof(header));
+
+    std::error_code ec;
+    fs::create_directories(fs::path(path).parent_path(), ec);
+    return writeFileAtomically(path, entry);
+}
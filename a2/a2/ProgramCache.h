@@ -0,0 +1,29 @@
+#pragma once
+#include <GL/glew.h>
+#include <cstdint>
+#include <string>
+
+// Bump whenever the entry layout changes so old entries are ignored
+const uint32_t PROGRAM_CACHE_VERSION = 1;
+
+// Directory linked program binaries are kept in, relative to the working directory
+const char* const PROGRAM_CACHE_DIRECTORY = "shadercache";
+
+enum class ProgramBinaryLoad {
+    Missing,  // no entry for this key
+    Rejected, // the driver refused the binary; the entry was removed
+    Loaded,
+};
+
+// Whether the context can hand out program binaries and take them back
+bool programBinariesSupported();
+
+// Key of a program: its final sources (defines included) and the GL_VENDOR, GL_RENDERER and
+// GL_VERSION strings, so a driver update or another GPU never sees a foreign binary
+uint64_t programCacheKey(const std::string& vertexSource, const std::string& fragmentSource);
+std::string programCachePath(const std::string& directory, uint64_t key);
+
+// Replace program with the cached binary; link status tells whether the driver accepted it
+ProgramBinaryLoad loadProgramBinary(const std::string& path, uint64_t key, GLuint program);
+// Save a linked program, which needs GL_PROGRAM_BINARY_RETRIEVABLE_HINT set before linking
+bool storeProgramBinary(const std::string& path, uint64_t key, GLuint program);
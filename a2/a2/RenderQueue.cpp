@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <chrono>
+#include "Profiler.h"
+#include "RenderQueue.h"
+
+static const uint32_t DRAW_LIST_INDEX_MASK = (1u << DRAW_LIST_INDEX_BITS) - 1;
+
+uint64_t makeSortKey(uint32_t pass, uint32_t program, uint32_t material, uint32_t vertexArray, uint32_t depth) {
+    uint64_t key = pass & ((1u << SORT_KEY_PASS_BITS) - 1);
+    key = key << SORT_KEY_PROGRAM_BITS | (program & ((1u << SORT_KEY_PROGRAM_BITS) - 1));
+    key = key << SORT_KEY_MATERIAL_BITS | (material & ((1u << SORT_KEY_MATERIAL_BITS) - 1));
+    key = key << SORT_KEY_VERTEX_ARRAY_BITS | (vertexArray & ((1u << SORT_KEY_VERTEX_ARRAY_BITS) - 1));
+    key = key << SORT_KEY_DEPTH_BITS | (depth & ((1u << SORT_KEY_DEPTH_BITS) - 1));
+    return key;
+}
+
+uint32_t depthBucket(float distance, float nearPlane, float farPlane) {
+    float t = std::min(std::max((distance - nearPlane) / (farPlane - nearPlane), 0.0f), 1.0f);
+    return (uint32_t)(t * (float)((1u << SORT_KEY_DEPTH_BITS) - 1) + 0.5f);
+}
+
+void DrawList::clear() {
+    items.clear();
+    commands.clear();
+    ranges.clear();
+}
+
+void DrawList::push(uint64_t key, DrawCommand command) {
+    command.rangeCount = (uint32_t)ranges.size() - command.firstRange;
+    items.push_back({ key, id << DRAW_LIST_INDEX_BITS | (uint32_t)commands.size() });
+    commands.push_back(command);
+}
+
+void RenderQueue::reset(size_t listCount) {
+    if (lists.size() < listCount) {
+        lists.resize(listCount);
+    }
+    for (size_t i = 0; i < listCount; i++) {
+        lists[i].clear();
+        lists[i].id = (uint32_t)i;
+    }
+    used = listCount;
+}
+
+// Bits per radix pass: 256-entry histograms keep the scatter's write streams few enough to stay cached
+static const int RADIX_BITS = 8;
+static const uint32_t RADIX_SIZE = 1u << RADIX_BITS;
+static const int MAX_RADIX_PASSES = (64 + RADIX_BITS - 1) / RADIX_BITS;
+
+double RenderQueue::sort() {
+    PROFILE_ZONE("sort draws");
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    size_t count = 0;
+    for (size_t i = 0; i < used; i++) {
+        count += lists[i].items.size();
+    }
+    items.resize(count);
+    scratch.resize(count);
+
+    // Gather, noting which key bits differ at all: fields every draw shares (one pass, one
+    // program) cost no pass
+    uint64_t allSet = ~0ull, anySet = 0;
+    size_t filled = 0;
+    for (size_t i = 0; i < used; i++) {
+        for (const DrawItem& item : lists[i].items) {
+            items[filled++] = item;
+            allSet &= item.key;
+            anySet |= item.key;
+        }
+    }
+
+    // Each pass sorts the RADIX_BITS bits from the lowest varying bit not sorted yet
+    int shifts[MAX_RADIX_PASSES];
+    int passes = 0;
+    for (uint64_t varying = allSet ^ anySet; varying != 0 && count > 1; passes++) {
+        int shift = 0;
+        while (!(varying >> shift & 1)) {
+            shift++;
+        }
+        shifts[passes] = shift;
+        varying = shift + RADIX_BITS >= 64 ? 0 : varying & (~0ull << (shift + RADIX_BITS));
+    }
+
+    histograms.assign((size_t)passes * RADIX_SIZE, 0);
+    for (size_t i = 0; i < count; i++) {
+        for (int p = 0; p < passes; p++) {
+            histograms[p * RADIX_SIZE + ((items[i].key >> shifts[p]) & (RADIX_SIZE - 1))]++;
+        }
+    }
+
+    DrawItem* source = items.data();
+    DrawItem* target = scratch.data();
+    for (int p = 0; p < passes; p++) {
+        uint32_t* offsets = &histograms[p * RADIX_SIZE];
+        uint32_t sum = 0;
+        for (uint32_t digit = 0; digit < RADIX_SIZE; digit++) {
+            uint32_t bucket = offsets[digit];
+            offsets[digit] = sum;
+            sum += bucket;
+        }
+        for (size_t i = 0; i < count; i++) {
+            target[offsets[(source[i].key >> shifts[p]) & (RADIX_SIZE - 1)]++] = source[i];
+        }
+        std::swap(source, target);
+    }
+    if (source != items.data()) {
+        items.swap(scratch);
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+const DrawCommand& RenderQueue::command(uint32_t reference) const {
+    return lists[reference >> DRAW_LIST_INDEX_BITS].commands[reference & DRAW_LIST_INDEX_MASK];
+}
+
+const DrawRange* RenderQueue::ranges(uint32_t reference) const {
+    const DrawList& list = lists[reference >> DRAW_LIST_INDEX_BITS];
+    return list.ranges.data() + list.commands[reference & DRAW_LIST_INDEX_MASK].firstRange;
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Meshlets.h"
+
+// Sort key fields, most significant first. Items sort by pass, then program, material, vertex
+// array and depth, so each state changes as rarely as possible and opaque draws go front to back.
+const uint32_t SORT_KEY_PASS_BITS = 4;
+const uint32_t SORT_KEY_PROGRAM_BITS = 8;
+const uint32_t SORT_KEY_MATERIAL_BITS = 12;
+const uint32_t SORT_KEY_VERTEX_ARRAY_BITS = 8;
+const uint32_t SORT_KEY_DEPTH_BITS = 16;
+
+const uint32_t RENDER_PASS_OPAQUE = 0;
+
+// A list holds at most this many commands; the rest of a command reference names the list
+const uint32_t DRAW_LIST_INDEX_BITS = 24;
+
+// Pack the fields of a draw into its key. program and vertexArray are small slots chosen by the
+// caller (not GL names); each field is masked to its width.
+uint64_t makeSortKey(uint32_t pass, uint32_t program, uint32_t material, uint32_t vertexArray, uint32_t depth);
+
+// View distance quantized over [nearPlane, farPlane] into the key's depth field
+uint32_t depthBucket(float distance, float nearPlane, float farPlane);
+
+// What to draw. With instanceCount > 0 each range is drawn instanced over instances
+// [firstInstance, firstInstance + instanceCount) of the instance buffer; otherwise all ranges go
+// out in one glMultiDrawElements.
+struct DrawCommand {
+    uint32_t firstRange; // into the owning list's ranges
+    uint32_t rangeCount;
+    uint32_t firstInstance;
+    uint32_t instanceCount;
+    uint32_t vertexArray; // GL name
+    uint16_t program;     // index into the programs handed to the submitter
+    uint16_t material;    // materialIndex uniform
+    uint8_t indexSize;    // 2 or 4 bytes
+};
+
+struct DrawItem {
+    uint64_t key;
+    uint32_t command; // list << DRAW_LIST_INDEX_BITS | index in the list
+};
+
+// Draws recorded by one producer. Each thread fills its own list, so filling takes no locks.
+struct DrawList {
+    std::vector<DrawItem> items;
+    std::vector<DrawCommand> commands;
+    std::vector<DrawRange> ranges;
+    uint32_t id = 0;
+
+    void clear();
+    // Queue a command whose ranges were appended to `ranges` since firstRange
+    void push(uint64_t key, DrawCommand command);
+};
+
+// Per-frame draw queue: producers fill lists, sort() radix-sorts every item by key and submit
+// walks sorted() in order. Buffers are kept across frames, so steady-state frames do not allocate.
+class RenderQueue {
+public:
+    // Start a frame with `listCount` empty lists (at most 1 << (32 - DRAW_LIST_INDEX_BITS))
+    void reset(size_t listCount);
+    DrawList& list(size_t index) { return lists[index]; }
+    size_t listCount() const { return used; }
+
+    // Gather all lists' items and sort them by key: LSD radix over only the key bits that differ
+    // between items, so fields every draw shares cost nothing. Items with equal keys keep list
+    // order. Returns the time taken in ms.
+    double sort();
+
+    const std::vector<DrawItem>& sorted() const { return items; }
+    // The command a sorted item refers to, and its first range
+    const DrawCommand& command(uint32_t reference) const;
+    const DrawRange* ranges(uint32_t reference) const;
+
+private:
+    std::vector<DrawList> lists;
+    size_t used = 0;
+    std::vector<DrawItem> items, scratch;
+    std::vector<uint32_t> histograms;
+};
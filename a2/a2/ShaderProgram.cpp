@@ -0,0 +1,343 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <glm/gtc/type_ptr.hpp>
+#include "Profiler.h"
+#include "ProgramCache.h"
+#include "ShaderProgram.h"
+
+static_assert(uniformId("model") == 0xB08B665Au, "uniformId must stay FNV-1a so hashes are stable");
+
+// Strip the "[0]" GL appends to array uniforms, so arrays are looked up by their plain name
+static uint32_t reflectedId(const char* name) {
+    std::string plain(name);
+    size_t bracket = plain.find('[');
+    if (bracket != std::string::npos) {
+        plain.resize(bracket);
+    }
+    return uniformId(plain.c_str());
+}
+
+// Bytes of the cached value of one uniform of this type
+static size_t uniformValueSize(GLenum type) {
+    switch (type) {
+    case GL_FLOAT_VEC3: return 3 * sizeof(float);
+    case GL_FLOAT_MAT3: return 9 * sizeof(float);
+    case GL_FLOAT_MAT4: return 16 * sizeof(float);
+    default: return sizeof(int32_t); // int, bool, float, samplers; other types are never cached
+    }
+}
+
+// glUniform1i also sets bools and samplers
+static bool acceptsInt(GLenum type) {
+    return type == GL_INT || type == GL_BOOL || type == GL_SAMPLER_2D || type == GL_SAMPLER_3D || type == GL_SAMPLER_CUBE ||
+           type == GL_SAMPLER_2D_SHADOW;
+}
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Defines have to follow #version, which must stay the first line
+static std::string withDefines(const char* source, const std::string& defines) {
+    std::string text(source);
+    if (defines.empty()) {
+        return text;
+    }
+    size_t insertAt = 0;
+    if (text.compare(0, 8, "#version") == 0) {
+        size_t newline = text.find('\n');
+        insertAt = newline == std::string::npos ? text.size() : newline + 1;
+    }
+    std::string block = defines;
+    if (block.back() != '\n') {
+        block += '\n';
+    }
+    return text.insert(insertAt, block);
+}
+
+static bool compileStage(GLuint shader, const char* source, const char* stage, const std::string& label) {
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+
+    GLint success = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        GLint length = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+        std::vector<char> infoLog(std::max(length, 1));
+        glGetShaderInfoLog(shader, (GLsizei)infoLog.size(), NULL, infoLog.data());
+        std::cerr << "ERROR::SHADER::" << stage << "::COMPILATION_FAILED (" << label << ")\n" << infoLog.data() << std::endl;
+    }
+    return success != 0;
+}
+
+ShaderProgram::~ShaderProgram() {
+    release();
+}
+
+void ShaderProgram::release() {
+    if (program != 0) {
+        glDeleteProgram(program);
+        program = 0;
+    }
+    uniforms.clear();
+    attributes.clear();
+    values.clear();
+}
+
+bool ShaderProgram::build(const char* vertexSource, const char* fragmentSource, const std::string& programLabel,
+                          const std::string& defines) {
+    PROFILE_ZONE("ShaderProgram::build");
+    release();
+    label = programLabel;
+    uniformStats = UniformStats();
+    programBuildStats = ProgramBuildStats();
+    std::string vertex = withDefines(vertexSource, defines);
+    std::string fragment = withDefines(fragmentSource, defines);
+
+    bool cached = !binaryCacheDirectory.empty() && programBinariesSupported();
+    uint64_t key = 0;
+    std::string cachePath;
+    programBuildStats.cacheUsed = cached;
+    if (cached) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        key = programCacheKey(vertex, fragment);
+        cachePath = programCachePath(binaryCacheDirectory, key);
+        program = glCreateProgram();
+        ProgramBinaryLoad load = loadProgramBinary(cachePath, key, program);
+        programBuildStats.cacheMs = millisecondsSince(start);
+        if (load == ProgramBinaryLoad::Loaded) {
+            programBuildStats.cacheHit = true;
+            reflect();
+            return true;
+        }
+        programBuildStats.cacheRejected = load == ProgramBinaryLoad::Rejected;
+        glDeleteProgram(program);
+        program = 0;
+    }
+
+    if (!compileAndLink(vertex, fragment, cached)) {
+        return false;
+    }
+    if (cached) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if (!storeProgramBinary(cachePath, key, program)) {
+            std::cerr << "Failed to write program binary cache: " << cachePath << std::endl;
+        }
+        programBuildStats.cacheMs += millisecondsSince(start);
+    }
+    reflect();
+    return true;
+}
+
+bool ShaderProgram::compileAndLink(const std::string& vertexSource, const std::string& fragmentSource, bool retrievable) {
+    PROFILE_ZONE("compile and link");
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    bool compiled = compileStage(vertexShader, vertexSource.c_str(), "VERTEX", label);
+    compiled = compileStage(fragmentShader, fragmentSource.c_str(), "FRAGMENT", label) && compiled;
+    programBuildStats.compileMs = millisecondsSince(start);
+    if (!compiled) {
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+        return false;
+    }
+
+    start = std::chrono::steady_clock::now();
+    program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    if (retrievable) {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glLinkProgram(program);
+
+    // Shaders are only flagged for deletion while attached; they go with the program
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    // Drivers may compile lazily, so the status query is part of the measured link
+    GLint success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    programBuildStats.linkMs = millisecondsSince(start);
+    if (!success) {
+        GLint length = 0;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+        std::vector<char> infoLog(std::max(length, 1));
+        glGetProgramInfoLog(program, (GLsizei)infoLog.size(), NULL, infoLog.data());
+        std::cerr << "ERROR::SHADER::PROGRAM::LINKING_FAILED (" << label << ")\n" << infoLog.data() << std::endl;
+        release();
+        return false;
+    }
+    return true;
+}
+
+void ShaderProgram::reflect() {
+    GLint uniformCount = 0, attributeCount = 0, maxNameLength = 0, maxAttributeLength = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+    glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &attributeCount);
+    glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxAttributeLength);
+    std::vector<char> name(std::max(std::max(maxNameLength, maxAttributeLength), 1) + 1);
+
+    size_t capacity = 8;
+    while (capacity < 2 * (size_t)uniformCount) {
+        capacity <<= 1;
+    }
+    uniforms.assign(capacity, Uniform{ 0, -1, 0, 0, false });
+
+    // Members of uniform blocks have no location; one query finds them all
+    std::vector<GLuint> indices(uniformCount);
+    std::vector<GLint> blocks(uniformCount, -1);
+    for (GLint i = 0; i < uniformCount; i++) {
+        indices[i] = (GLuint)i;
+    }
+    if (uniformCount > 0) {
+        glGetActiveUniformsiv(program, uniformCount, indices.data(), GL_UNIFORM_BLOCK_INDEX, blocks.data());
+    }
+
+    for (GLint i = 0; i < uniformCount; i++) {
+        if (blocks[i] >= 0) {
+            continue;
+        }
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(program, (GLuint)i, (GLsizei)name.size(), NULL, &size, &type, name.data());
+        GLint location = glGetUniformLocation(program, name.data());
+        uniformStats.locationQueries++;
+        if (location < 0) {
+            continue;
+        }
+
+        uint32_t id = reflectedId(name.data());
+        size_t slot = id & (capacity - 1);
+        while (uniforms[slot].location >= 0 && uniforms[slot].name != id) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        if (uniforms[slot].location >= 0) {
+            std::cerr << "Uniform name hash collision in " << label << ": " << name.data() << std::endl;
+            continue;
+        }
+        uniforms[slot] = { id, location, type, (uint32_t)values.size(), false };
+        values.resize(values.size() + uniformValueSize(type));
+    }
+
+    for (GLint i = 0; i < attributeCount; i++) {
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveAttrib(program, (GLuint)i, (GLsizei)name.size(), NULL, &size, &type, name.data());
+        attributes.push_back({ reflectedId(name.data()), glGetAttribLocation(program, name.data()) });
+        uniformStats.locationQueries++;
+    }
+}
+
+const ShaderProgram::Uniform* ShaderProgram::findUniform(uint32_t name) const {
+    if (uniforms.empty()) {
+        return nullptr;
+    }
+    size_t mask = uniforms.size() - 1;
+    for (size_t slot = name & mask; uniforms[slot].location >= 0; slot = (slot + 1) & mask) {
+        if (uniforms[slot].name == name) {
+            return &uniforms[slot];
+        }
+    }
+    return nullptr;
+}
+
+GLint ShaderProgram::uniformLocation(uint32_t name) const {
+    const Uniform* uniform = findUniform(name);
+    return uniform ? uniform->location : -1;
+}
+
+GLint ShaderProgram::attributeLocation(uint32_t name) const {
+    for (const Attribute& attribute : attributes) {
+        if (attribute.name == name) {
+            return attribute.location;
+        }
+    }
+    return -1;
+}
+
+void ShaderProgram::bindUniformBlock(const char* blockName, GLuint binding) {
+    GLuint index = glGetUniformBlockIndex(program, blockName);
+    if (index == GL_INVALID_INDEX) {
+        std::cerr << "No uniform block " << blockName << " in " << label << std::endl;
+        return;
+    }
+    glUniformBlockBinding(program, index, binding);
+}
+
+ShaderProgram::Uniform* ShaderProgram::changed(uint32_t name, GLenum type, const void* value, size_t bytes) {
+    Uniform* uniform = const_cast<Uniform*>(findUniform(name));
+    if (!uniform || !(uniform->type == type || (type == GL_INT && acceptsInt(uniform->type)))) {
+        uniformStats.unknown++;
+        return nullptr;
+    }
+
+    unsigned char* cached = values.data() + uniform->valueOffset;
+    if (uniform->valid && std::memcmp(cached, value, bytes) == 0) {
+        uniformStats.skipped++;
+        return nullptr;
+    }
+    std::memcpy(cached, value, bytes);
+    uniform->valid = true;
+    uniformStats.uploads++;
+    return uniform;
+}
+
+void ShaderProgram::set(uint32_t name, int value) {
+    int32_t v = value;
+    if (Uniform* uniform = changed(name, GL_INT, &v, sizeof(v))) {
+        glUniform1i(uniform->location, v);
+    }
+}
+
+void ShaderProgram::set(uint32_t name, float value) {
+    if (Uniform* uniform = changed(name, GL_FLOAT, &value, sizeof(value))) {
+        glUniform1f(uniform->location, value);
+    }
+}
+
+void ShaderProgram::set(uint32_t name, const glm::vec3& value) {
+    if (Uniform* uniform = changed(name, GL_FLOAT_VEC3, glm::value_ptr(value), sizeof(value))) {
+        glUniform3fv(uniform->location, 1, glm::value_ptr(value));
+    }
+}
+
+void ShaderProgram::set(uint32_t name, const glm::mat3& value) {
+    if (Uniform* uniform = changed(name, GL_FLOAT_MAT3, glm::value_ptr(value), sizeof(value))) {
+        glUniformMatrix3fv(uniform->location, 1, GL_FALSE, glm::value_ptr(value));
+    }
+}
+
+void ShaderProgram::set(uint32_t name, const glm::mat4& value) {
+    if (Uniform* uniform = changed(name, GL_FLOAT_MAT4, glm::value_ptr(value), sizeof(value))) {
+        glUniformMatrix4fv(uniform->location, 1, GL_FALSE, glm::value_ptr(value));
+    }
+}
+
+void ShaderProgram::printStats(size_t frames) const {
+    double perFrame = frames > 0 ? 1.0 / frames : 0.0;
+    std::cout << "Uniforms of " << label << " over " << frames << " frames: " << uniformStats.uploads << " uploads ("
+              << uniformStats.uploads * perFrame << " per frame), " << uniformStats.skipped << " unchanged sets skipped, "
+              << uniformStats.unknown << " unknown, " << uniformStats.locationQueries << " location queries (link time only)"
+              << std::endl;
+}
+
+void ShaderProgram::printBuildStats() const {
+    const ProgramBuildStats& stats = programBuildStats;
+    std::cout << "Program " << label << ": ";
+    if (stats.cacheHit) {
+        std::cout << "binary cache hit, " << stats.cacheMs << " ms";
+    }
+    else {
+        std::cout << "compile " << stats.compileMs << " ms, link " << stats.linkMs << " ms";
+        if (stats.cacheUsed) {
+            std::cout << ", binary cache " << (stats.cacheRejected ? "rejected" : "miss") << " " << stats.cacheMs << " ms";
+        }
+    }
+    std::cout << std::endl;
+}
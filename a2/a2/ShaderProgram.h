@@ -0,0 +1,97 @@
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 32-bit FNV-1a of a uniform or attribute name. constexpr, so literal names hash at compile time:
+// program.set(uniformId("model"), model)
+constexpr uint32_t uniformId(const char* name, uint32_t hash = 2166136261u) {
+    return *name ? uniformId(name + 1, (hash ^ (uint8_t)*name) * 16777619u) : hash;
+}
+
+// Uniform traffic of a program since it was linked
+struct UniformStats {
+    size_t uploads = 0;       // glUniform* calls issued
+    size_t skipped = 0;       // sets dropped because the value was already current
+    size_t unknown = 0;       // sets of names the program lacks (optimized out, misspelled) or of the wrong type
+    size_t locationQueries = 0; // glGetUniformLocation / glGetAttribLocation calls, all made at link time
+};
+
+// Where the time of the last build() went
+struct ProgramBuildStats {
+    double compileMs = 0.0;
+    double linkMs = 0.0;
+    double cacheMs = 0.0;     // key hash, entry read and glProgramBinary, or the entry write on a miss
+    bool cacheUsed = false;   // a cache directory is set and the context supports program binaries
+    bool cacheHit = false;
+    bool cacheRejected = false; // an entry existed but the driver refused it
+};
+
+// A linked vertex + fragment program. Active uniforms and attributes are reflected once after
+// linking into a flat hash table keyed by uniformId, and each uniform keeps a copy of its last
+// value so setting an unchanged value costs no GL call. set() expects the program to be in use.
+class ShaderProgram {
+public:
+    ShaderProgram() = default;
+    ShaderProgram(const ShaderProgram&) = delete;
+    ShaderProgram& operator=(const ShaderProgram&) = delete;
+    ~ShaderProgram();
+
+    // Compile and link; compile and link logs are printed under `label` on failure. `defines` is
+    // a block of #define lines inserted after the #version line of both stages.
+    bool build(const char* vertexSource, const char* fragmentSource, const std::string& label,
+               const std::string& defines = "");
+    // Keep linked binaries in `directory` (see ProgramCache.h) and try them before compiling
+    void enableBinaryCache(const std::string& directory) { binaryCacheDirectory = directory; }
+    void release();
+
+    GLuint id() const { return program; }
+    void use() const { glUseProgram(program); }
+
+    bool hasUniform(uint32_t name) const { return findUniform(name) != nullptr; }
+    GLint uniformLocation(uint32_t name) const;
+    GLint attributeLocation(uint32_t name) const;
+    void bindUniformBlock(const char* blockName, GLuint binding);
+
+    void set(uint32_t name, int value);
+    void set(uint32_t name, float value);
+    void set(uint32_t name, const glm::vec3& value);
+    void set(uint32_t name, const glm::mat3& value);
+    void set(uint32_t name, const glm::mat4& value);
+
+    const UniformStats& stats() const { return uniformStats; }
+    void printStats(size_t frames) const;
+    const ProgramBuildStats& buildStats() const { return programBuildStats; }
+    void printBuildStats() const;
+
+private:
+    struct Uniform {
+        uint32_t name;
+        GLint location;
+        GLenum type;
+        uint32_t valueOffset; // into values, sized for the GL type (element 0 of arrays)
+        bool valid;           // false until the first upload
+    };
+    struct Attribute {
+        uint32_t name;
+        GLint location;
+    };
+
+    bool compileAndLink(const std::string& vertexSource, const std::string& fragmentSource, bool retrievable);
+    void reflect();
+    const Uniform* findUniform(uint32_t name) const;
+    // Copies value into the cache and says whether glUniform* has to run
+    Uniform* changed(uint32_t name, GLenum type, const void* value, size_t bytes);
+
+    GLuint program = 0;
+    std::string label;
+    std::string binaryCacheDirectory;
+    std::vector<Uniform> uniforms;       // open addressing, power-of-two size, location -1 marks empty
+    std::vector<Attribute> attributes;
+    std::vector<unsigned char> values;
+    UniformStats uniformStats;
+    ProgramBuildStats programBuildStats;
+};
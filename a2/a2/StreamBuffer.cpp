@@ -0,0 +1,191 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include "Profiler.h"
+#include "StreamBuffer.h"
+
+// Longest single glClientWaitSync while stalled, and how many of them a region gets before its
+// frame is dropped, so a hung GPU or lost context cannot hang the frame forever
+static const GLuint64 STREAM_WAIT_TIMEOUT_NS = 1000000000ull;
+static const int STREAM_WAIT_MAX_RETRIES = 5;
+
+StreamBuffer::~StreamBuffer() {
+    release();
+}
+
+bool StreamBuffer::create(size_t bytes) {
+    release();
+
+    // Uniform blocks may only be bound at multiples of this, so every region starts at one
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    uniformOffsetAlignment = std::max<size_t>(alignment, 16);
+    regionBytes = (std::max<size_t>(bytes, 1) + uniformOffsetAlignment - 1) / uniformOffsetAlignment * uniformOffsetAlignment;
+    GLsizeiptr totalBytes = (GLsizeiptr)(regionBytes * STREAM_FRAME_COUNT);
+
+    // GL_COPY_WRITE_BUFFER leaves the bindings the renderer tracks alone
+    glGenBuffers(1, &id);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, id);
+    persistentMapping = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+    if (persistentMapping) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_COPY_WRITE_BUFFER, totalBytes, nullptr, flags);
+        mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, totalBytes, flags);
+    }
+    else {
+        glBufferData(GL_COPY_WRITE_BUFFER, totalBytes, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    if (persistentMapping && !mapped) {
+        std::cerr << "Failed to map the stream buffer (" << totalBytes << " bytes)" << std::endl;
+        release();
+        return false;
+    }
+    region = STREAM_FRAME_COUNT - 1;
+    used = 0;
+    inFrame = false;
+    return true;
+}
+
+void StreamBuffer::release() {
+    for (GLsync& fence : fences) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    if (id != 0) {
+        if (mapped) {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, id);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &id);
+    }
+    id = 0;
+    mapped = nullptr;
+    regionBytes = 0;
+    used = 0;
+    inFrame = false;
+}
+
+// True once the GPU is done with the region. A region still busy after every retry keeps its
+// fence for the next attempt; a failed wait deletes it, as waiting on it again would only fail again.
+bool StreamBuffer::waitForRegion(int index) {
+    GLsync& fence = fences[index];
+    if (!fence) {
+        return true;
+    }
+    GLenum status = glClientWaitSync(fence, 0, 0);
+    if (status == GL_TIMEOUT_EXPIRED) {
+        PROFILE_ZONE("stream buffer fence wait");
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int retry = 0; retry < STREAM_WAIT_MAX_RETRIES && status == GL_TIMEOUT_EXPIRED; retry++) {
+            status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, STREAM_WAIT_TIMEOUT_NS);
+        }
+        stats.stalls++;
+        stats.stallMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    if (status == GL_TIMEOUT_EXPIRED) {
+        std::cerr << "Stream buffer region " << index << " still in use after " << STREAM_WAIT_MAX_RETRIES
+                  << " s; dropping the frame" << std::endl;
+        return false;
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+    if (status == GL_WAIT_FAILED) {
+        std::cerr << "Stream buffer fence wait failed; dropping the frame" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+StreamFrame StreamBuffer::beginFrame(size_t frameBytes) {
+    StreamFrame result = StreamFrame::Ready;
+    inFrame = false;
+    if (frameBytes > regionBytes) {
+        for (int i = 0; i < STREAM_FRAME_COUNT; i++) {
+            if (!waitForRegion(i)) {
+                stats.dropped++;
+                return StreamFrame::Dropped;
+            }
+        }
+        // Grow geometrically so a fleet growing a little each frame does not reallocate each frame
+        if (!create(std::max(frameBytes, regionBytes * 2))) {
+            stats.dropped++;
+            return StreamFrame::Dropped;
+        }
+        stats.regrows++;
+        result = StreamFrame::Reallocated;
+    }
+
+    // The region only advances once it is free, so a dropped frame's successor retries it
+    int next = (region + 1) % STREAM_FRAME_COUNT;
+    if (!waitForRegion(next)) {
+        stats.dropped++;
+        return StreamFrame::Dropped;
+    }
+    region = next;
+    used = 0;
+    inFrame = true;
+
+    // The fence already guarantees the GPU is done with the region, so the map need not sync
+    if (!persistentMapping) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, id);
+        mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, (GLintptr)(region * regionBytes), (GLsizeiptr)regionBytes,
+                                                  GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    return result;
+}
+
+StreamAllocation StreamBuffer::allocate(size_t bytes, size_t alignment) {
+    StreamAllocation allocation;
+    if (!inFrame) {
+        return allocation;
+    }
+    size_t start = (used + alignment - 1) & ~(alignment - 1);
+    if (!mapped || start + bytes > regionBytes) {
+        stats.overflows++;
+        return allocation;
+    }
+    used = start + bytes;
+    allocation.offset = (GLintptr)(region * regionBytes + start);
+    allocation.data = persistentMapping ? mapped + allocation.offset : mapped + start;
+    return allocation;
+}
+
+void StreamBuffer::flush() {
+    // Persistent coherent writes reach the GPU without a call
+    if (!persistentMapping && mapped) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, id);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        mapped = nullptr;
+    }
+}
+
+void StreamBuffer::endFrame() {
+    if (!inFrame) {
+        return;
+    }
+    inFrame = false;
+    flush();
+    if (fences[region]) {
+        glDeleteSync(fences[region]);
+    }
+    fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    stats.frames++;
+    stats.bytes += used;
+    stats.peakBytes = std::max(stats.peakBytes, used);
+}
+
+void StreamBuffer::printStats() const {
+    double perFrame = stats.frames > 0 ? 1.0 / stats.frames : 0.0;
+    std::cout << "Stream buffer over " << stats.frames << " frames (" << (persistentMapping ? "persistent" : "mapped per frame")
+              << ", " << STREAM_FRAME_COUNT << " x " << regionBytes / 1024.0 << " KiB): " << stats.bytes * perFrame / 1024.0
+              << " KiB streamed per frame, peak " << stats.peakBytes / 1024.0 << " KiB, " << stats.stalls << " stalls ("
+              << stats.stallMs << " ms waiting), " << stats.overflows << " overflows, " << stats.regrows << " regrows, " << stats.dropped << " frames dropped"
+              << std::endl;
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+
+// Frames the buffer is split into: the CPU fills one region while the GPU may still be reading
+// the previous two
+const int STREAM_FRAME_COUNT = 3;
+
+// Stream buffer counters, summed over the frames since the last reset
+struct StreamStats {
+    size_t frames = 0;
+    size_t bytes = 0;       // allocated, alignment padding included
+    size_t peakBytes = 0;   // most allocated in one frame
+    size_t stalls = 0;      // frames whose region the GPU was still reading
+    double stallMs = 0.0;   // time spent waiting for those regions
+    size_t overflows = 0;   // allocations that did not fit their region
+    size_t regrows = 0;     // reallocations to fit a larger frame
+    size_t dropped = 0;     // frames given up on because their region never came free
+};
+
+enum class StreamFrame {
+    Ready,
+    Reallocated, // the buffer is a new object; vertex arrays pointing at the old one must be re-pointed
+    Dropped,     // the region could not be reclaimed (GPU hung, context lost); draw nothing this frame
+};
+
+// Where an allocation landed: write it through data, draw from buffer() at offset
+struct StreamAllocation {
+    void* data = nullptr;
+    GLintptr offset = 0;
+};
+
+// One buffer for all per-frame dynamic data (uniform blocks, instance attributes), split into
+// STREAM_FRAME_COUNT regions used round-robin. Each frame bump-allocates from its region and
+// fences it after its last draw; a region is only written again once its fence has signalled, so
+// the CPU never overwrites what the GPU is still reading and nothing is re-specified per frame.
+//
+// With GL 4.4 or ARB_buffer_storage the buffer is created immutable and mapped once, persistent
+// and coherent. Otherwise each frame maps its region unsynchronized (the fences already order
+// it) and flush() unmaps it before drawing.
+class StreamBuffer {
+public:
+    StreamBuffer() = default;
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+    ~StreamBuffer();
+
+    // Allocate STREAM_FRAME_COUNT regions of at least regionBytes
+    bool create(size_t regionBytes);
+    void release();
+
+    // Start a frame in the next region, waiting for the GPU to finish reading it first. If the
+    // frame needs more than a region, every region is drained and the buffer reallocated larger.
+    // A dropped frame allocates nothing, and the next one waits for the same region again.
+    StreamFrame beginFrame(size_t frameBytes = 0);
+    // Space for `bytes` in this frame's region, its offset a multiple of alignment (a power of
+    // two, at most uniformAlignment()). data is null when the region is full.
+    StreamAllocation allocate(size_t bytes, size_t alignment = 16);
+    // Make this frame's writes visible to GL; call before drawing from them
+    void flush();
+    // Fence this frame's region; call after the last draw that reads it (a no-op for a dropped frame)
+    void endFrame();
+
+    GLuint buffer() const { return id; }
+    size_t regionSize() const { return regionBytes; }
+    size_t uniformAlignment() const { return uniformOffsetAlignment; }
+    bool persistent() const { return persistentMapping; }
+
+    void printStats() const;
+    StreamStats stats;
+
+private:
+    bool waitForRegion(int index);
+
+    GLuint id = 0;
+    unsigned char* mapped = nullptr; // the whole buffer when persistent, else this frame's region while mapped
+    size_t regionBytes = 0;
+    size_t used = 0;
+    int region = STREAM_FRAME_COUNT - 1;
+    bool inFrame = false; // between a beginFrame that was not dropped and its endFrame
+    GLsync fences[STREAM_FRAME_COUNT] = {};
+    bool persistentMapping = false;
+    size_t uniformOffsetAlignment = 256;
+};
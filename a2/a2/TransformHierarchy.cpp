@@ -0,0 +1,375 @@
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include "Parallel.h"
+#include "TransformHierarchy.h"
+
+// SSE2 is part of every x86-64 target
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRANSFORM_SSE 1
+#include <emmintrin.h>
+#endif
+
+static const glm::mat4 IDENTITY_WORLD = glm::mat4(1.0f);
+static const glm::mat3 IDENTITY_NORMAL = glm::mat3(1.0f);
+
+TransformHandle TransformHierarchy::add(TransformHandle parent, const glm::vec3& translation, const glm::quat& rotation,
+                                        const glm::vec3& scale) {
+    uint32_t index = (uint32_t)parents.size();
+    uint32_t parentIndex = parent == NO_TRANSFORM_PARENT ? NO_TRANSFORM_PARENT : slots[parent];
+    uint32_t depth = parent == NO_TRANSFORM_PARENT ? 0 : depths[parentIndex] + 1;
+    // Adding breadth-first, each parent's children after those of the parents stored before it,
+    // keeps the storage sorted; anything else is re-sorted on the next update
+    if (index > 0 && (depth < depths.back() || (depth == depths.back() && parentIndex < parents.back()))) {
+        unsorted = true;
+    }
+
+    glm::quat unit = glm::normalize(rotation);
+    tx.push_back(translation.x);
+    ty.push_back(translation.y);
+    tz.push_back(translation.z);
+    qx.push_back(unit.x);
+    qy.push_back(unit.y);
+    qz.push_back(unit.z);
+    qw.push_back(unit.w);
+    sx.push_back(scale.x);
+    sy.push_back(scale.y);
+    sz.push_back(scale.z);
+    parents.push_back(parentIndex);
+    depths.push_back(depth);
+    changed.push_back(0);
+    worlds.push_back(glm::mat4(1.0f));
+    normals.push_back(glm::mat3(1.0f));
+
+    TransformHandle handle = (TransformHandle)slots.size();
+    slots.push_back(index);
+    handles.push_back(handle);
+    markChanged(index);
+    layoutChanged = true;
+    return handle;
+}
+
+void TransformHierarchy::clear() {
+    for (std::vector<float>* component : { &tx, &ty, &tz, &qx, &qy, &qz, &qw, &sx, &sy, &sz }) {
+        component->clear();
+    }
+    parents.clear();
+    depths.clear();
+    changed.clear();
+    worlds.clear();
+    normals.clear();
+    slots.clear();
+    handles.clear();
+    levelOffsets.clear();
+    unsorted = false;
+    layoutChanged = false;
+    pendingChanges = false;
+    editedBegin = UINT32_MAX;
+    editedEnd = 0;
+}
+
+void TransformHierarchy::reserve(size_t count) {
+    for (std::vector<float>* component : { &tx, &ty, &tz, &qx, &qy, &qz, &qw, &sx, &sy, &sz }) {
+        component->reserve(count);
+    }
+    parents.reserve(count);
+    depths.reserve(count);
+    changed.reserve(count);
+    worlds.reserve(count);
+    normals.reserve(count);
+    slots.reserve(count);
+    handles.reserve(count);
+}
+
+glm::vec3 TransformHierarchy::translation(TransformHandle node) const {
+    uint32_t i = slots[node];
+    return glm::vec3(tx[i], ty[i], tz[i]);
+}
+
+glm::quat TransformHierarchy::rotation(TransformHandle node) const {
+    uint32_t i = slots[node];
+    return glm::quat(qw[i], qx[i], qy[i], qz[i]);
+}
+
+glm::vec3 TransformHierarchy::scale(TransformHandle node) const {
+    uint32_t i = slots[node];
+    return glm::vec3(sx[i], sy[i], sz[i]);
+}
+
+void TransformHierarchy::markChanged(uint32_t index) {
+    changed[index] = 1;
+    editedBegin = std::min(editedBegin, index);
+    editedEnd = std::max(editedEnd, index + 1);
+    pendingChanges = true;
+}
+
+void TransformHierarchy::setTranslation(TransformHandle node, const glm::vec3& translation) {
+    uint32_t i = slots[node];
+    tx[i] = translation.x;
+    ty[i] = translation.y;
+    tz[i] = translation.z;
+    markChanged(i);
+}
+
+void TransformHierarchy::setRotation(TransformHandle node, const glm::quat& rotation) {
+    uint32_t i = slots[node];
+    glm::quat unit = glm::normalize(rotation);
+    qx[i] = unit.x;
+    qy[i] = unit.y;
+    qz[i] = unit.z;
+    qw[i] = unit.w;
+    markChanged(i);
+}
+
+void TransformHierarchy::setScale(TransformHandle node, const glm::vec3& scale) {
+    uint32_t i = slots[node];
+    sx[i] = scale.x;
+    sy[i] = scale.y;
+    sz[i] = scale.z;
+    markChanged(i);
+}
+
+void TransformHierarchy::translateLocal(TransformHandle node, const glm::vec3& offset) {
+    setTranslation(node, translation(node) + rotation(node) * (scale(node) * offset));
+}
+
+void TransformHierarchy::rotateLocal(TransformHandle node, float radians, const glm::vec3& axis) {
+    setRotation(node, rotation(node) * glm::angleAxis(radians, glm::normalize(axis)));
+}
+
+void TransformHierarchy::scaleLocal(TransformHandle node, const glm::vec3& factors) {
+    setScale(node, scale(node) * factors);
+}
+
+template <typename T>
+static void permute(std::vector<T>& values, const std::vector<uint32_t>& order) {
+    std::vector<T> sorted(values.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        sorted[i] = values[order[i]];
+    }
+    values.swap(sorted);
+}
+
+// Sort by depth and, within a depth, by parent, so every parent is stored before its children,
+// each depth is one contiguous range and the children of any range of parents are one range too
+void TransformHierarchy::sortByDepth() {
+    size_t count = parents.size();
+    uint32_t maxDepth = 0;
+    for (uint32_t depth : depths) {
+        maxDepth = std::max(maxDepth, depth);
+    }
+    std::vector<uint32_t> starts(maxDepth + 2, 0);
+    for (uint32_t depth : depths) {
+        starts[depth + 1]++;
+    }
+    for (uint32_t d = 0; d <= maxDepth; d++) {
+        starts[d + 1] += starts[d];
+    }
+    std::vector<uint32_t> order(count), newIndex(count);
+    std::vector<uint32_t> next(starts.begin(), starts.end() - 1);
+    for (uint32_t i = 0; i < count; i++) {
+        order[next[depths[i]]++] = i;
+    }
+    // Each depth is ordered by where the one before it was placed
+    for (uint32_t d = 0; d <= maxDepth; d++) {
+        if (d > 0) {
+            std::stable_sort(order.begin() + starts[d], order.begin() + starts[d + 1], [&](uint32_t a, uint32_t b) {
+                return newIndex[parents[a]] < newIndex[parents[b]];
+            });
+        }
+        for (uint32_t k = starts[d]; k < starts[d + 1]; k++) {
+            newIndex[order[k]] = k;
+        }
+    }
+
+    for (std::vector<float>* component : { &tx, &ty, &tz, &qx, &qy, &qz, &qw, &sx, &sy, &sz }) {
+        permute(*component, order);
+    }
+    permute(parents, order);
+    permute(depths, order);
+    permute(changed, order);
+    permute(worlds, order);
+    permute(normals, order);
+    permute(handles, order);
+    for (uint32_t i = 0; i < count; i++) {
+        if (parents[i] != NO_TRANSFORM_PARENT) {
+            parents[i] = newIndex[parents[i]];
+        }
+        slots[handles[i]] = i;
+    }
+    editedBegin = 0;
+    editedEnd = (uint32_t)count;
+    unsorted = false;
+}
+
+// Scalar composition of one node, for the tail of a range and targets without SSE
+static void composeNode(const glm::vec3& t, const glm::quat& q, const glm::vec3& s, const glm::mat4& parentWorld,
+                        const glm::mat3& parentNormal, glm::mat4& world, glm::mat3& normal) {
+    glm::mat3 r = glm::mat3_cast(q);
+    glm::mat4 local(glm::vec4(r[0] * s.x, 0.0f), glm::vec4(r[1] * s.y, 0.0f), glm::vec4(r[2] * s.z, 0.0f),
+                    glm::vec4(t, 1.0f));
+    world = parentWorld * local;
+    normal = parentNormal * glm::mat3(r[0] / s.x, r[1] / s.y, r[2] / s.z);
+}
+
+#ifdef TRANSFORM_SSE
+// Three floats in and out without touching the fourth, which belongs to the next column or matrix
+static inline __m128 load3(const float* p) {
+    return _mm_movelh_ps(_mm_loadl_pi(_mm_setzero_ps(), (const __m64*)p), _mm_load_ss(p + 2));
+}
+
+static inline void store3(float* p, __m128 v) {
+    _mm_storel_pi((__m64*)p, v);
+    _mm_store_ss(p + 2, _mm_movehl_ps(v, v));
+}
+#endif
+
+// Compose the nodes in [begin, end), all of one depth, whose own or parent's flag is set; their
+// flags are set in turn for the next depth. Returns how many were composed.
+static size_t composeRange(size_t begin, size_t end, const float* tx, const float* ty, const float* tz, const float* qx,
+                           const float* qy, const float* qz, const float* qw, const float* sx, const float* sy,
+                           const float* sz, const uint32_t* parents, uint8_t* changed, glm::mat4* worlds,
+                           glm::mat3* normals) {
+    size_t composed = 0;
+    auto stale = [&](size_t i) {
+        return changed[i] || (parents[i] != NO_TRANSFORM_PARENT && changed[parents[i]]);
+    };
+    size_t i = begin;
+
+#ifdef TRANSFORM_SSE
+    // Four nodes per step: the quaternions expand to scaled rotation columns (world) and inverse-
+    // scaled ones (normals) lane-parallel, then each stale lane is multiplied into its parent
+    alignas(16) float local[3][3][4], inverse[3][3][4];
+    const __m128 one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f);
+    for (; i + 4 <= end; i += 4) {
+        bool any = false;
+        for (size_t l = 0; l < 4; l++) {
+            any = any || stale(i + l);
+        }
+        if (!any) {
+            continue;
+        }
+
+        __m128 x = _mm_loadu_ps(qx + i), y = _mm_loadu_ps(qy + i), z = _mm_loadu_ps(qz + i), w = _mm_loadu_ps(qw + i);
+        __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+        __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+        __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+        __m128 r[3][3] = {
+            { _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), _mm_mul_ps(two, _mm_add_ps(xy, wz)),
+              _mm_mul_ps(two, _mm_sub_ps(xz, wy)) },
+            { _mm_mul_ps(two, _mm_sub_ps(xy, wz)), _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))),
+              _mm_mul_ps(two, _mm_add_ps(yz, wx)) },
+            { _mm_mul_ps(two, _mm_add_ps(xz, wy)), _mm_mul_ps(two, _mm_sub_ps(yz, wx)),
+              _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))) },
+        };
+        __m128 s[3] = { _mm_loadu_ps(sx + i), _mm_loadu_ps(sy + i), _mm_loadu_ps(sz + i) };
+        for (int c = 0; c < 3; c++) {
+            __m128 reciprocal = _mm_div_ps(one, s[c]);
+            for (int row = 0; row < 3; row++) {
+                _mm_store_ps(local[c][row], _mm_mul_ps(r[c][row], s[c]));
+                _mm_store_ps(inverse[c][row], _mm_mul_ps(r[c][row], reciprocal));
+            }
+        }
+
+        for (size_t l = 0; l < 4; l++) {
+            size_t n = i + l;
+            if (!stale(n)) {
+                continue;
+            }
+            uint32_t parent = parents[n];
+            const float* pw = &(parent == NO_TRANSFORM_PARENT ? IDENTITY_WORLD : worlds[parent])[0][0];
+            const float* pn = &(parent == NO_TRANSFORM_PARENT ? IDENTITY_NORMAL : normals[parent])[0][0];
+            __m128 p0 = _mm_loadu_ps(pw), p1 = _mm_loadu_ps(pw + 4), p2 = _mm_loadu_ps(pw + 8), p3 = _mm_loadu_ps(pw + 12);
+            __m128 n0 = load3(pn), n1 = load3(pn + 3), n2 = load3(pn + 6);
+
+            float* outWorld = &worlds[n][0][0];
+            float* outNormal = &normals[n][0][0];
+            for (int c = 0; c < 3; c++) {
+                __m128 column = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p0, _mm_set1_ps(local[c][0][l])),
+                                                      _mm_mul_ps(p1, _mm_set1_ps(local[c][1][l]))),
+                                           _mm_mul_ps(p2, _mm_set1_ps(local[c][2][l])));
+                _mm_storeu_ps(outWorld + 4 * c, column);
+                __m128 normalColumn = _mm_add_ps(_mm_add_ps(_mm_mul_ps(n0, _mm_set1_ps(inverse[c][0][l])),
+                                                            _mm_mul_ps(n1, _mm_set1_ps(inverse[c][1][l]))),
+                                                 _mm_mul_ps(n2, _mm_set1_ps(inverse[c][2][l])));
+                store3(outNormal + 3 * c, normalColumn);
+            }
+            __m128 position = _mm_add_ps(_mm_add_ps(_mm_mul_ps(p0, _mm_set1_ps(tx[n])), _mm_mul_ps(p1, _mm_set1_ps(ty[n]))),
+                                         _mm_add_ps(_mm_mul_ps(p2, _mm_set1_ps(tz[n])), p3));
+            _mm_storeu_ps(outWorld + 12, position);
+            changed[n] = 1;
+            composed++;
+        }
+    }
+#endif
+
+    for (; i < end; i++) {
+        if (!stale(i)) {
+            continue;
+        }
+        uint32_t parent = parents[i];
+        composeNode(glm::vec3(tx[i], ty[i], tz[i]), glm::quat(qw[i], qx[i], qy[i], qz[i]), glm::vec3(sx[i], sy[i], sz[i]),
+                    parent == NO_TRANSFORM_PARENT ? IDENTITY_WORLD : worlds[parent],
+                    parent == NO_TRANSFORM_PARENT ? IDENTITY_NORMAL : normals[parent], worlds[i], normals[i]);
+        changed[i] = 1;
+        composed++;
+    }
+    return composed;
+}
+
+size_t TransformHierarchy::update(unsigned int threads) {
+    if (!pendingChanges) {
+        return 0;
+    }
+    if (unsorted) {
+        sortByDepth();
+    }
+    if (layoutChanged) {
+        levelOffsets.assign(1, 0);
+        for (size_t i = 0; i < depths.size(); i++) {
+            while (levelOffsets.size() <= depths[i]) {
+                levelOffsets.push_back((uint32_t)i);
+            }
+        }
+        levelOffsets.push_back((uint32_t)depths.size());
+        layoutChanged = false;
+    }
+
+    // Depth by depth, since a node reads its parent's result and flag; within a depth, chunks are
+    // independent. Only edited nodes and children of the previous depth's scanned range can be
+    // stale, and both are ranges, so untouched parts of the tree are not even scanned.
+    std::atomic<size_t> composed(0);
+    size_t parentBegin = 0, parentEnd = 0;
+    for (size_t d = 0; d + 1 < levelOffsets.size(); d++) {
+        size_t begin = levelOffsets[d], end = levelOffsets[d + 1];
+        size_t first = end, last = begin;
+        if (parentBegin < parentEnd) {
+            first = std::lower_bound(parents.begin() + begin, parents.begin() + end, (uint32_t)parentBegin) - parents.begin();
+            last = std::lower_bound(parents.begin() + first, parents.begin() + end, (uint32_t)parentEnd) - parents.begin();
+        }
+        if (editedBegin < end && editedEnd > begin) {
+            first = std::min(first, std::max(begin, (size_t)editedBegin));
+            last = std::max(last, std::min(end, (size_t)editedEnd));
+        }
+        last = std::max(first, last);
+
+        size_t chunks = (last - first + TRANSFORM_CHUNK - 1) / TRANSFORM_CHUNK;
+        workerPool().parallelFor(chunks, [&](size_t chunk) {
+            size_t chunkBegin = first + chunk * TRANSFORM_CHUNK;
+            size_t chunkEnd = std::min(last, chunkBegin + TRANSFORM_CHUNK);
+            composed += composeRange(chunkBegin, chunkEnd, tx.data(), ty.data(), tz.data(), qx.data(), qy.data(),
+                                     qz.data(), qw.data(), sx.data(), sy.data(), sz.data(), parents.data(),
+                                     changed.data(), worlds.data(), normals.data());
+        }, threads);
+
+        // The parents' flags are not read again
+        std::memset(changed.data() + parentBegin, 0, parentEnd - parentBegin);
+        parentBegin = first;
+        parentEnd = last;
+    }
+    std::memset(changed.data() + parentBegin, 0, parentEnd - parentBegin);
+    editedBegin = UINT32_MAX;
+    editedEnd = 0;
+    pendingChanges = false;
+    return composed;
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Stable name of a transform node: the order it was added in
+typedef uint32_t TransformHandle;
+const TransformHandle NO_TRANSFORM_PARENT = 0xFFFFFFFFu;
+
+// Nodes of one depth composed per work item in update()
+const size_t TRANSFORM_CHUNK = 4096;
+
+// Parent/child transforms kept as local translation, rotation and scale, so repeated edits never
+// accumulate drift in a matrix. Components are stored SoA and sorted by depth (roots, then their
+// children, ...), which lets update() compose one depth at a time, four nodes per SIMD step,
+// spread over threads. Only nodes whose local transform or an ancestor's changed are recomposed.
+//
+// Each node's world matrix is parentWorld * translate * rotate * scale; its normal matrix, the
+// inverse transpose of the world's upper 3x3, is built the same way as parentNormal * rotate /
+// scale, so no inverse is taken. Scales must not be zero.
+class TransformHierarchy {
+public:
+    TransformHandle add(TransformHandle parent = NO_TRANSFORM_PARENT, const glm::vec3& translation = glm::vec3(0.0f),
+                        const glm::quat& rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
+                        const glm::vec3& scale = glm::vec3(1.0f));
+    void clear();
+    void reserve(size_t count);
+
+    glm::vec3 translation(TransformHandle node) const;
+    glm::quat rotation(TransformHandle node) const;
+    glm::vec3 scale(TransformHandle node) const;
+    void setTranslation(TransformHandle node, const glm::vec3& translation);
+    void setRotation(TransformHandle node, const glm::quat& rotation);
+    void setScale(TransformHandle node, const glm::vec3& scale);
+
+    // Move along, turn about and stretch the node's own axes, as post-multiplying its matrix would
+    void translateLocal(TransformHandle node, const glm::vec3& offset);
+    void rotateLocal(TransformHandle node, float radians, const glm::vec3& axis);
+    void scaleLocal(TransformHandle node, const glm::vec3& factors);
+
+    // Recompose the world and normal matrices of every changed node and its descendants on up to
+    // `threads` threads (0 = one per hardware thread). Returns how many nodes were recomposed.
+    size_t update(unsigned int threads = 0);
+
+    size_t size() const { return parents.size(); }
+    const glm::mat4& world(TransformHandle node) const { return worlds[slots[node]]; }
+    const glm::mat3& normalMatrix(TransformHandle node) const { return normals[slots[node]]; }
+
+    // All matrices in storage (depth) order, as of the last update, for handing to the renderer
+    const glm::mat4* worldMatrices() const { return worlds.data(); }
+    const glm::mat3* normalMatrices() const { return normals.data(); }
+    size_t indexOf(TransformHandle node) const { return slots[node]; }
+
+private:
+    void markChanged(uint32_t index);
+    void sortByDepth();
+
+    // Local components, in storage order
+    std::vector<float> tx, ty, tz;
+    std::vector<float> qx, qy, qz, qw;
+    std::vector<float> sx, sy, sz;
+    std::vector<uint32_t> parents; // storage index of the parent, or NO_TRANSFORM_PARENT
+    std::vector<uint32_t> depths;
+    std::vector<uint8_t> changed; // local transform edited, or recomposed during this update
+    std::vector<glm::mat4> worlds;
+    std::vector<glm::mat3> normals;
+
+    std::vector<uint32_t> slots;        // handle -> storage index
+    std::vector<uint32_t> handles;      // storage index -> handle
+    std::vector<uint32_t> levelOffsets; // depth d is stored at [levelOffsets[d], levelOffsets[d + 1])
+    uint32_t editedBegin = UINT32_MAX, editedEnd = 0; // storage range edited since the last update
+    bool unsorted = false;
+    bool layoutChanged = false;
+    bool pendingChanges = false;
+};
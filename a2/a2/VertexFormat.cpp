@@ -0,0 +1,98 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <glm/gtc/packing.hpp>
+#include <glm/packing.hpp>
+#include "VertexFormat.h"
+
+static_assert(sizeof(PackedVertex) == 12, "PackedVertex must stay 12 bytes");
+
+static inline glm::vec2 signNotZero(glm::vec2 v) {
+    return glm::vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+}
+
+glm::vec2 encodeOctahedral(glm::vec3 normal) {
+    float l1 = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+    if (l1 == 0.0f) {
+        return glm::vec2(0.0f);
+    }
+
+    // Project onto the octahedron, then fold the lower hemisphere over the diagonals
+    normal /= l1;
+    glm::vec2 encoded(normal.x, normal.y);
+    if (normal.z < 0.0f) {
+        encoded = (1.0f - glm::abs(glm::vec2(encoded.y, encoded.x))) * signNotZero(encoded);
+    }
+    return encoded;
+}
+
+// Same decode as the vertex shader
+glm::vec3 decodeOctahedral(glm::vec2 encoded) {
+    glm::vec3 normal(encoded.x, encoded.y, 1.0f - std::fabs(encoded.x) - std::fabs(encoded.y));
+    float t = std::max(-normal.z, 0.0f);
+    normal.x += normal.x >= 0.0f ? -t : t;
+    normal.y += normal.y >= 0.0f ? -t : t;
+    return glm::normalize(normal);
+}
+
+Vertex unpackVertex(const PackedVertex& packed, const PositionQuantization& quantization) {
+    Vertex vertex;
+    vertex.position = quantization.offset + quantization.scale * glm::unpackUnorm<float>(packed.position);
+    vertex.normal = decodeOctahedral(glm::unpackSnorm<float>(packed.normal));
+    vertex.color = glm::vec3(1.0f);
+    return vertex;
+}
+
+void quantizeVertices(const std::vector<Vertex>& vertices, std::vector<PackedVertex>& packed,
+                      PositionQuantization& quantization, QuantizationError& error) {
+    packed.resize(vertices.size());
+    error = QuantizationError();
+
+    glm::vec3 minimum(0.0f), maximum(0.0f);
+    if (!vertices.empty()) {
+        minimum = maximum = vertices[0].position;
+    }
+    for (const Vertex& vertex : vertices) {
+        minimum = glm::min(minimum, vertex.position);
+        maximum = glm::max(maximum, vertex.position);
+    }
+    quantization.offset = minimum;
+    quantization.scale = maximum - minimum;
+
+    // Flat axes quantize to 0 and decode back to the AABB min exactly
+    glm::vec3 inverseScale;
+    for (int axis = 0; axis < 3; axis++) {
+        inverseScale[axis] = quantization.scale[axis] > 0.0f ? 1.0f / quantization.scale[axis] : 0.0f;
+    }
+
+    for (size_t i = 0; i < vertices.size(); i++) {
+        const Vertex& vertex = vertices[i];
+        PackedVertex& out = packed[i];
+
+        out.position = glm::packUnorm<uint16_t>((vertex.position - quantization.offset) * inverseScale);
+        out.padding = 0;
+        out.normal = glm::packSnorm<int16_t>(encodeOctahedral(vertex.normal));
+
+        // Measure the round trip the way the GPU decodes it
+        glm::vec3 position = quantization.offset + quantization.scale * glm::unpackUnorm<float>(out.position);
+        error.position = std::max(error.position, glm::length(position - vertex.position));
+
+        float normalLength = glm::length(vertex.normal);
+        if (normalLength > 0.0f) {
+            glm::vec3 normal = decodeOctahedral(glm::unpackSnorm<float>(out.normal));
+            float cosine = glm::clamp(glm::dot(normal, vertex.normal / normalLength), -1.0f, 1.0f);
+            error.normalDegrees = std::max(error.normalDegrees, glm::degrees(std::acos(cosine)));
+        }
+    }
+
+    float diagonal = glm::length(quantization.scale);
+    error.positionRatio = diagonal > 0.0f ? error.position / diagonal : 0.0f;
+}
+
+void printQuantizationReport(const std::string& name, size_t vertexCount, const QuantizationError& error) {
+    std::cout << "Vertex quantization report for " << name << std::endl;
+    std::cout << "  " << vertexCount << " vertices, " << sizeof(PackedVertex) << " bytes each (was "
+              << sizeof(Vertex) << "), " << vertexCount * sizeof(PackedVertex) / 1024.0 << " KiB VBO" << std::endl;
+    std::cout << "  max error: position " << error.position << " (" << error.positionRatio * 100.0f
+              << "% of the AABB diagonal), normal " << error.normalDegrees << " deg" << std::endl;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Mesh.h"
+
+// Vertex layouts a mesh can be cooked into. The loader API is the same for both;
+// only the attribute setup and the shader's decode uniforms differ.
+enum class VertexFormat : uint32_t {
+    Float = 0,     // Vertex: 3 x vec3 (36 bytes)
+    Quantized = 1, // PackedVertex (12 bytes)
+};
+
+// Quantized vertex layout (12 bytes). Vertex::color is left out: no shader reads it since
+// materials moved into the Material block.
+struct PackedVertex {
+    glm::u16vec3 position; // unorm16 inside the mesh AABB, see PositionQuantization
+    uint16_t padding;
+    glm::i16vec2 normal;   // octahedral encoding, snorm16
+};
+
+// Decode of quantized positions: position = offset + scale * unorm16
+struct PositionQuantization {
+    glm::vec3 offset; // AABB min
+    glm::vec3 scale;  // AABB extent
+};
+
+// Largest round-trip error measured over every vertex of a mesh
+struct QuantizationError {
+    float position;      // model units
+    float positionRatio; // position error relative to the AABB diagonal
+    float normalDegrees; // angle between the original and decoded normal
+};
+
+inline size_t vertexStride(VertexFormat format) {
+    return format == VertexFormat::Quantized ? sizeof(PackedVertex) : sizeof(Vertex);
+}
+
+// Octahedral normal encoding; zero vectors encode as (0, 0)
+glm::vec2 encodeOctahedral(glm::vec3 normal);
+glm::vec3 decodeOctahedral(glm::vec2 encoded);
+
+// Decode one quantized vertex back to the float layout, as the vertex shader does (color is white)
+Vertex unpackVertex(const PackedVertex& packed, const PositionQuantization& quantization);
+
+// Pack vertices into the quantized layout and measure the error of the round trip
+void quantizeVertices(const std::vector<Vertex>& vertices, std::vector<PackedVertex>& packed,
+                      PositionQuantization& quantization, QuantizationError& error);
+
+void printQuantizationReport(const std::string& name, size_t vertexCount, const QuantizationError& error);
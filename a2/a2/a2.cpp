@@ -1,9 +1,11 @@
-#define TINYOBJLOADER_IMPLEMENTATION
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <vector>
 #include <string>
 #include "a2.h"
-#include "tiny_obj_loader.h"
 
 // Global variables to track control state
 enum RotationAxis { ROT_X, ROT_Y, ROT_Z };
@@ -16,138 +18,80 @@ float lastKeyPressTime = 0.0f;
 bool canRotateClockwise = true, canRotateCounterclockwise = true;
 bool wireframeMode = true; // Wireframe mode by default
 
-std::vector<Vertex> loadModel(const std::string& path) {
-    tinyobj::attrib_t attrib;
-    std::vector<tinyobj::shape_t> shapes;
-    std::vector<tinyobj::material_t> materials;
-    std::string warn, err;
-
-    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str())) {
-        std::cerr << "Failed to load: " << err << std::endl;
-        return std::vector<Vertex>();
-    }
-
-    std::vector<Vertex> vertices;
-
-    // Loop over shapes
-    for (const auto& shape : shapes) {
-        // Loop over faces
-        size_t index_offset = 0;
-        for (size_t f = 0; f < shape.mesh.num_face_vertices.size(); f++) {
-            int fv = shape.mesh.num_face_vertices[f];
-
-            // Loop over vertices in the face
-            for (size_t v = 0; v < fv; v++) {
-                tinyobj::index_t idx = shape.mesh.indices[index_offset + v];
-
-                Vertex vertex;
-
-                // Position
-                vertex.position = {
-                    attrib.vertices[3 * idx.vertex_index + 0],
-                    attrib.vertices[3 * idx.vertex_index + 1],
-                    attrib.vertices[3 * idx.vertex_index + 2]
-                };
-
-                // Normal
-                if (idx.normal_index >= 0) {
-                    vertex.normal = {
-                        attrib.normals[3 * idx.normal_index + 0],
-                        attrib.normals[3 * idx.normal_index + 1],
-                        attrib.normals[3 * idx.normal_index + 2]
-                    };
-                }
-                else {
-                    vertex.normal = { 0.0f, 0.0f, 0.0f };
-                }
-
-                // Color (use a default color if not specified)
-                if (idx.texcoord_index >= 0 && attrib.texcoords.size() > 0) {
-                    // Use texture coordinate to generate color
-                    vertex.color = {
-                        attrib.texcoords[2 * idx.texcoord_index + 0],
-                        attrib.texcoords[2 * idx.texcoord_index + 1],
-                        0.5f  // Default blue component
-                    };
-                }
-                else {
-                    // Default color (white)
-                    vertex.color = { 1.0f, 1.0f, 1.0f };
-                }
+void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
+    glViewport(0, 0, width, height);
+}
 
-                vertices.push_back(vertex);
-            }
-            index_offset += fv;
+// Key state of the keys the viewer reacts to, polled from the window
+uint16_t pollInputKeys(GLFWwindow* window) {
+    static const struct { int key; uint16_t bit; } KEYS[] = {
+        { GLFW_KEY_ESCAPE, INPUT_KEY_ESCAPE }, { GLFW_KEY_TAB, INPUT_KEY_TAB },
+        { GLFW_KEY_W, INPUT_KEY_W }, { GLFW_KEY_S, INPUT_KEY_S }, { GLFW_KEY_A, INPUT_KEY_A }, { GLFW_KEY_D, INPUT_KEY_D },
+        { GLFW_KEY_Q, INPUT_KEY_Q }, { GLFW_KEY_E, INPUT_KEY_E }, { GLFW_KEY_R, INPUT_KEY_R }, { GLFW_KEY_F, INPUT_KEY_F },
+        { GLFW_KEY_O, INPUT_KEY_O }
+    };
+    uint16_t keys = 0;
+    for (const auto& key : KEYS) {
+        if (glfwGetKey(window, key.key) == GLFW_PRESS) {
+            keys |= key.bit;
         }
     }
-
-    std::cout << "Successfully loaded: " << path << std::endl;
-    std::cout << "Loaded " << vertices.size() << " vertices" << std::endl;
-
-    return vertices;
+    return keys;
 }
 
-void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
-    glViewport(0, 0, width, height);
-}
-
-void processInput(GLFWwindow* window, glm::mat4& model, float deltaTime, glm::vec3& rotationAxis, bool& wireframeMode) {
-    float currentTime = glfwGetTime();
+// Apply one frame of input, live or replayed. input.time is the only clock used, so a replay
+// behaves the same at any frame rate. Returns false when Esc asks to exit.
+bool processInput(const InputFrame& input, TransformHierarchy& scene, TransformHandle model, glm::vec3& rotationAxis, bool& wireframeMode) {
+    float currentTime = input.time;
     bool canProcessKey = (currentTime - lastKeyPressTime) > KEY_REPEAT_DELAY;
 
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
-        glfwSetWindowShouldClose(window, true);
+    if (input.keys & INPUT_KEY_ESCAPE) {
+        return false;
     }
 
     // Toggle wireframe mode with Tab
-    if (glfwGetKey(window, GLFW_KEY_TAB) == GLFW_PRESS && canProcessKey) {
+    if ((input.keys & INPUT_KEY_TAB) && canProcessKey) {
         wireframeMode = !wireframeMode;
         lastKeyPressTime = currentTime;
         std::cout << "Switched to " << (wireframeMode ? "wireframe" : "solid") << " mode" << std::endl;
     }
 
     // Translation controls
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
-        model = glm::translate(model, glm::vec3(0.0f, TRANSLATION_DISTANCE, 0.0f));
+    if (input.keys & INPUT_KEY_W) {
+        scene.translateLocal(model, glm::vec3(0.0f, TRANSLATION_DISTANCE, 0.0f));
     }
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
-        model = glm::translate(model, glm::vec3(0.0f, -TRANSLATION_DISTANCE, 0.0f));
+    if (input.keys & INPUT_KEY_S) {
+        scene.translateLocal(model, glm::vec3(0.0f, -TRANSLATION_DISTANCE, 0.0f));
     }
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
-        model = glm::translate(model, glm::vec3(-TRANSLATION_DISTANCE, 0.0f, 0.0f));
+    if (input.keys & INPUT_KEY_A) {
+        scene.translateLocal(model, glm::vec3(-TRANSLATION_DISTANCE, 0.0f, 0.0f));
     }
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
-        model = glm::translate(model, glm::vec3(TRANSLATION_DISTANCE, 0.0f, 0.0f));
+    if (input.keys & INPUT_KEY_D) {
+        scene.translateLocal(model, glm::vec3(TRANSLATION_DISTANCE, 0.0f, 0.0f));
     }
 
     // Rotation controls
-    if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS && canRotateCounterclockwise) {
-        glm::vec3 translation = glm::vec3(model[3]);
-        model[3] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
-        model = glm::rotate(model, glm::radians(ROTATION_ANGLE), rotationAxis);
-        model[3] = glm::vec4(translation, 1.0f);
+    if ((input.keys & INPUT_KEY_Q) && canRotateCounterclockwise) {
+        scene.rotateLocal(model, glm::radians(ROTATION_ANGLE), rotationAxis);
         canRotateCounterclockwise = false;
     }
-    if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS && canRotateClockwise) {
-        glm::vec3 translation = glm::vec3(model[3]);
-        model[3] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
-        model = glm::rotate(model, glm::radians(-ROTATION_ANGLE), rotationAxis);
-        model[3] = glm::vec4(translation, 1.0f);
+    if ((input.keys & INPUT_KEY_E) && canRotateClockwise) {
+        scene.rotateLocal(model, glm::radians(-ROTATION_ANGLE), rotationAxis);
         canRotateClockwise = false;
     }
-    if (glfwGetKey(window, GLFW_KEY_Q) != GLFW_PRESS) {
+    if (!(input.keys & INPUT_KEY_Q)) {
         canRotateCounterclockwise = true;
     }
-    if (glfwGetKey(window, GLFW_KEY_E) != GLFW_PRESS) {
+    if (!(input.keys & INPUT_KEY_E)) {
         canRotateClockwise = true;
     }
 
     // Scaling controls
-    if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS) {
-        model = glm::scale(model, glm::vec3(1.0f, 1.0f, SCALE_FACTOR));
+    if (input.keys & INPUT_KEY_R) {
+        scene.scaleLocal(model, glm::vec3(1.0f, 1.0f, SCALE_FACTOR));
     }
-    if (glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS) {
-        model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f / SCALE_FACTOR));
+    if (input.keys & INPUT_KEY_F) {
+        scene.scaleLocal(model, glm::vec3(1.0f, 1.0f, 1.0f / SCALE_FACTOR));
     }
 
     //// Reset model matrix
@@ -156,182 +100,700 @@ void processInput(GLFWwindow* window, glm::mat4& model, float deltaTime, glm::ve
     //    std::cout << "Reset position, rotation, and scale." << std::endl;
     //    lastKeyPressTime = currentTime;
     //}
+    return true;
 }
 
-int main() {
-    if (!glfwInit()) {
-        std::cerr << "Failed to initialize GLFW" << std::endl;
-        return -1;
+// Attribute pointers for the bound VBO: location 0 = position, 2 = normal. Location 1 (vertex
+// color) is left disabled; the float layout still carries the color, but nothing reads it.
+void setupVertexAttributes(VertexFormat format) {
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(2);
+
+    if (format == VertexFormat::Quantized) {
+        GLsizei stride = sizeof(PackedVertex);
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offsetof(PackedVertex, position));
+        glVertexAttribPointer(2, 2, GL_SHORT, GL_TRUE, stride, (void*)offsetof(PackedVertex, normal));
+        return;
     }
 
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    GLsizei stride = sizeof(Vertex);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, position));
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, normal));
+}
 
-    GLFWwindow* window = glfwCreateWindow(WIDTH, HEIGHT, "Assignment 2 - 3D Model Viewer (Wireframe)", NULL, NULL);
-    if (window == NULL) {
-        std::cerr << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
+int main(int argc, char** argv) {
+    // Benchmarks run headless and exit before any window is created
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        return runBenchmark(argc - 2, argv + 2);
+    }
+    PROFILE_THREAD("main");
+    std::chrono::steady_clock::time_point launchTime = std::chrono::steady_clock::now();
+
+    // a2 [model] [instances] draws a fleet of copies. Options may come anywhere:
+    //   --stress        time frames over growing fleets (STRESS_INSTANCE_COUNTS) and exit
+    //   --headless      render offscreen without a display (see HeadlessContext.h), time
+    //                   --frames N frames of the resident model and exit
+    //   --png <file>    with --headless, write the last frame to <file> for regression checks
+    //   --record <file> save every frame's key state to <file> (see InputLog.h)
+    //   --replay <file> take each frame's keys from <file> instead of the keyboard, and exit
+    //                   when it runs out; headless replays time every frame of it
+    //   --trace <file>  write the profiler's zones as Chrome trace JSON on exit (see Profiler.h)
+    bool stress = false, headless = false;
+    int headlessFrames = 0;
+    std::string pngPath, recordPath, replayPath, tracePath;
+    std::vector<std::string> arguments;
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument == "--stress") {
+            stress = true;
+        }
+        else if (argument == "--headless") {
+            headless = true;
+        }
+        else if (argument == "--frames" && i + 1 < argc) {
+            headlessFrames = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (argument == "--png" && i + 1 < argc) {
+            pngPath = argv[++i];
+        }
+        else if (argument == "--record" && i + 1 < argc) {
+            recordPath = argv[++i];
+        }
+        else if (argument == "--replay" && i + 1 < argc) {
+            replayPath = argv[++i];
+        }
+        else if (argument == "--trace" && i + 1 < argc) {
+            tracePath = argv[++i];
+        }
+        else {
+            arguments.push_back(argument);
+        }
+    }
+    std::string modelPath = arguments.size() > 0 ? arguments[0] : "../cybertruck.obj";
+    uint32_t instanceCount = arguments.size() > 1 ? (uint32_t)std::max(1, std::atoi(arguments[1].c_str())) : 1;
+
+    InputLog replayLog, recordLog;
+    bool replaying = !replayPath.empty();
+    if (replaying && !replayLog.load(replayPath)) {
         return -1;
     }
+    if (headlessFrames == 0) {
+        headlessFrames = replaying ? std::max(1, (int)replayLog.size()) : HEADLESS_FRAMES;
+    }
+    size_t replayFrame = 0;
+
+    // Headless runs have no window: input, swaps and events are skipped wherever window is null
+    GLFWwindow* window = NULL;
+    HeadlessContext headlessContext;
+    if (headless) {
+        if (!headlessContext.create()) {
+            return -1;
+        }
+    }
+    else {
+        if (!glfwInit()) {
+            std::cerr << "Failed to initialize GLFW" << std::endl;
+            return -1;
+        }
+
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
-    glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+        window = glfwCreateWindow(WIDTH, HEIGHT, "Assignment 2 - 3D Model Viewer (Wireframe)", NULL, NULL);
+        if (window == NULL) {
+            std::cerr << "Failed to create GLFW window" << std::endl;
+            glfwTerminate();
+            return -1;
+        }
+
+        glfwMakeContextCurrent(window);
+        if (stress) {
+            glfwSwapInterval(0); // Frame times must not be capped by the display
+        }
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    }
 
     GLenum err = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+    // GLEW built for GLX finds no X display behind an EGL context, but has loaded GL by then
+    if (headless && err == GLEW_ERROR_NO_GLX_DISPLAY) {
+        err = GLEW_OK;
+    }
+#endif
     if (GLEW_OK != err) {
         std::cerr << "Error: " << glewGetErrorString(err) << std::endl;
         return -1;
     }
+    if (headless && !headlessContext.createFramebuffer(WIDTH, HEIGHT)) {
+        return -1;
+    }
 
-    std::cout << "OpenGL Version: " << glGetString(GL_VERSION) << std::endl;
+    std::cout << "OpenGL Version: " << glGetString(GL_VERSION) << " (" << glGetString(GL_RENDERER) << ")" << std::endl;
     std::cout << "Controls:" << std::endl;
     std::cout << "  W/S/A/D - Move up/down/left/right" << std::endl;
     std::cout << "  Q/E - Rotate around Y axis" << std::endl;
     std::cout << "  R/F - Scale in the Z axis" << std::endl;
     std::cout << "  Space - Reset to initial position" << std::endl;
     std::cout << "  Tab - Toggle wireframe mode" << std::endl;
+    std::cout << "  O - Dump the occlusion depth buffer and pyramid" << std::endl;
     std::cout << "  Esc - Exit" << std::endl;
 
-    // Compile shaders
-    unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-
-    int success;
-    char infoLog[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        std::cerr << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+    // Compile shaders; uniforms are reflected once here and set by hashed name from then on
+    ShaderProgram shader;
+    if (USE_PROGRAM_BINARY_CACHE) {
+        shader.enableBinaryCache(PROGRAM_CACHE_DIRECTORY);
     }
-
-    unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
-
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-        std::cerr << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
-
-    unsigned int shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        std::cerr << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+    if (!shader.build(vertexShaderSource, fragmentShaderSource, "model shader")) {
+        glfwTerminate();
+        return -1;
     }
-
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-
-    // Load model
-    std::vector<Vertex> vertices = loadModel("../cybertruck.obj");
-    if (vertices.empty()) {
-        std::cerr << "Failed to load model" << std::endl;
+    shader.printBuildStats();
+    shader.bindUniformBlock("Materials", MATERIAL_BLOCK_BINDING);
+    shader.bindUniformBlock("Frame", FRAME_BLOCK_BINDING);
+
+    // Everything rewritten each frame (the Frame block, visible instance transforms) is
+    // bump-allocated from one ring of frame regions instead of re-specifying buffers
+    StreamBuffer stream;
+    if (!stream.create(STREAM_REGION_BYTES)) {
+        glfwTerminate();
         return -1;
     }
 
-    // Create vertex buffer and array objects
-    unsigned int VAO, VBO;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-    // Position attribute
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-
-    // Color attribute
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, color));
-
-    // Normal attribute
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    // GPU time per pass, read back a few frames late; without timestamps the passes go untimed
+    GpuTimer gpuTimer;
+    gpuTimer.create();
+
+    // The model loads through its memory-mapped cache on a worker thread and uploads a slice per
+    // frame; until it is resident the window keeps presenting empty frames
+    AsyncModelLoader loader;
+    loader.start(modelPath, MODEL_COOK_SETTINGS);
+    CookedMesh& mesh = loader.mesh();
+
+    // Model state, filled in on the frame the model becomes resident
+    unsigned int VAO = 0, VBO = 0, EBO = 0, materialUBO = 0;
+    std::vector<uint32_t> submeshMeshlets;
+
+    // LOD chain straight from the cache, or built on a worker thread from the decoded mesh while
+    // the full-detail model is already on screen
+    std::vector<MeshLod> lodLevels;
+    std::vector<Submesh> lodSubmeshes;
+    glm::vec3 lodCenter(0.0f);
+    float lodRadius = 0.0f;
+    Mesh lodMesh;
+    double lodBuildMs = 0.0;
+    std::future<LodChain> lodBuild;
+
+    // Time to first frame, and the worst frame while the model was loading versus after. The
+    // frame that makes the model resident also draws all of it for the first time, so the worst
+    // frame before it is kept apart: that one is the loader's own cost.
+    double firstFrameMs = 0.0;
+    double worstLoadingFrameMs = 0.0, worstPendingFrameMs = 0.0, worstFrameMs = 0.0;
+    size_t loadingFrames = 0, frameCount = 0;
+
+    // Copies of the model; a single instance is drawn through the meshlet path, a fleet with
+    // one instanced draw per LOD level and submesh
+    InstanceSet fleet;
+    InstanceBounds fleetBounds;
+    VisibleInstances visibleInstances;
+    InstanceBatches batches;
+    OccluderMesh occluder;
+    std::future<OccluderMesh> occluderBuild;
+    OcclusionBuffer occlusion;
+    std::vector<uint32_t> occluders;
+    std::vector<glm::mat4> occluderTransforms;
+    size_t occludedCount = 0;
+    bool dumpKeyHeld = false;
+    size_t stressStage = 0;
+    int stressFrame = 0;
+    double stressTotalMs = 0.0, stressWorstMs = 0.0;
+
+    // Headless timing over the frames after the model became resident: CPU time per frame (all
+    // work up to the end of submission), the render queue's GL submission alone, and throughput
+    // from the first timed frame until the GPU finished the last
+    int headlessFrame = 0;
+    double headlessCpuMs = 0.0, headlessWorstCpuMs = 0.0, headlessSubmitMs = 0.0;
+    std::chrono::steady_clock::time_point headlessStart;
+    bool quit = false;
+
+    // Every draw of a frame goes through the queue: sorted by key, then submitted through a cache
+    // of the GL state so unchanged binds are dropped. List 0 holds the fleet, list 1 the single model.
+    RenderQueue renderQueue;
+    GLStateCache glState;
+    ShaderProgram* programs[] = { &shader };
 
     glEnable(GL_DEPTH_TEST);
+    glLineWidth(1.0f); // Wireframe line width
 
     // Set up camera and projection
-    glm::mat4 model = glm::scale(glm::mat4(1.0f), glm::vec3(1.0f));
     glm::mat4 view = glm::lookAt(
         glm::vec3(0.0f, 0.3f, 4.0f),
         glm::vec3(0.0f, 0.0f, 0.0f),
         glm::vec3(0.0f, 1.0f, 0.0f)
     );
     glm::mat4 projection = glm::perspective(
-        glm::radians(45.0f),
+        glm::radians(FIELD_OF_VIEW),
         (float)WIDTH / (float)HEIGHT,
-        0.1f,
-        100.0f
+        NEAR_PLANE,
+        FAR_PLANE
     );
 
     glm::vec3 rotationAxis = glm::vec3(0.0f, 1.0f, 0.0f);
 
-    float deltaTime = 0.0f;
-    float lastFrame = 0.0f;
+    // The model's placement is kept as translation, rotation and scale and its matrix recomposed
+    // only when input changes it: scaled down to 0.2, moved 12 model units down, turned 45 degrees
+    TransformHierarchy scene;
+    TransformHandle modelNode = scene.add(NO_TRANSFORM_PARENT, glm::vec3(0.0f, -12.0f * 0.2f, 0.0f),
+                                          glm::angleAxis(glm::radians(45.0f), glm::vec3(0.0f, 1.0f, 0.0f)), glm::vec3(0.2f));
+
+    // A model that fails to load ends the loop; the process still cleans up, then reports failure
+    bool loadFailed = false;
+    while (!quit && (window == NULL || !glfwWindowShouldClose(window))) {
+        PROFILE_ZONE("frame");
+        std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+        frameCount++;
+        float currentFrame = std::chrono::duration<float>(frameStart - launchTime).count();
+
+        // Input applies from the first frame the model is on screen, so a recording and its
+        // replay line up however long loading took; a replay then feeds one logged frame per frame
+        InputFrame input = { currentFrame, 0 };
+        if (loader.state() == ModelLoadState::Resident) {
+            PROFILE_ZONE("processInput");
+            if (replaying) {
+                input = replayFrame < replayLog.size() ? replayLog[replayFrame++] : input;
+                quit = replayFrame == replayLog.size();
+            }
+            else if (window) {
+                input.keys = pollInputKeys(window);
+            }
+            if (!recordPath.empty()) {
+                recordLog.record(input.time, input.keys);
+            }
+            if (!processInput(input, scene, modelNode, rotationAxis, wireframeMode)) {
+                quit = true;
+            }
+        }
+        scene.update();
+        const glm::mat4& model = scene.world(modelNode);
+
+        bool becameResident = loader.update();
+        if (becameResident) {
+            // Streams were uploaded straight from the mapped cache, indices already in their 16/32-bit EBO format
+            VBO = loader.vertexBuffer();
+            EBO = loader.indexBuffer();
+            glGenVertexArrays(1, &VAO);
+            glBindVertexArray(VAO);
+            glBindBuffer(GL_ARRAY_BUFFER, VBO);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+
+            // Attribute pointers follow whatever format the mesh was cooked into
+            setupVertexAttributes(mesh.vertexFormat);
+
+            // Instance transforms stream from the frame's region of the stream buffer, advancing
+            // once per instance; the render queue points the attributes at each draw's range
+            for (unsigned int row = 0; row < 3; row++) {
+                glEnableVertexAttribArray(INSTANCE_ATTRIBUTE_LOCATION + row);
+                glVertexAttribDivisor(INSTANCE_ATTRIBUTE_LOCATION + row, 1);
+            }
+
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glBindVertexArray(0);
+
+            // All materials live in one uniform buffer; each submesh draw only selects its slot
+            std::vector<MaterialBlockEntry> materialBlock = packMaterialBlock(mesh.materials, mesh.materialCount);
+            glGenBuffers(1, &materialUBO);
+            glBindBuffer(GL_UNIFORM_BUFFER, materialUBO);
+            glBufferData(GL_UNIFORM_BUFFER, materialBlock.size() * sizeof(MaterialBlockEntry), materialBlock.data(), GL_STATIC_DRAW);
+            glBindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_BLOCK_BINDING, materialUBO);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+            // Decode parameters of the vertex format never change, so they are set once
+            shader.use();
+            shader.set(uniformId("positionOffset"), mesh.positionQuantization.offset);
+            shader.set(uniformId("positionScale"), mesh.positionQuantization.scale);
+            shader.set(uniformId("octahedralNormals"), mesh.vertexFormat == VertexFormat::Quantized ? 1 : 0);
+            glState.invalidate();
+
+            // Meshlets are stored in submesh order: meshlets [submeshMeshlets[i], submeshMeshlets[i + 1]) belong to submesh i
+            submeshMeshlets.assign(mesh.submeshCount + 1, 0);
+            for (uint32_t m = 0; m < mesh.meshletCount; m++) {
+                submeshMeshlets[mesh.meshlets[m].submesh + 1]++;
+            }
+            for (uint32_t i = 0; i < mesh.submeshCount; i++) {
+                submeshMeshlets[i + 1] += submeshMeshlets[i];
+            }
 
-    model = glm::scale(model, glm::vec3(0.2f)); // Scale down first
-    model = glm::translate(model, glm::vec3(0.0f, -12.0f, 0.0f)); // Then move down
-    model = glm::rotate(model, glm::radians(45.0f), glm::vec3(0.0f, 1.0f, 0.0f)); // Initial rotation
+            lodLevels.assign(mesh.lods, mesh.lods + mesh.lodCount);
+            lodSubmeshes.assign(mesh.lodSubmeshes, mesh.lodSubmeshes + (size_t)mesh.lodCount * mesh.submeshCount);
+            lodCenter = mesh.lodCenter;
+            lodRadius = mesh.lodRadius;
 
-    while (!glfwWindowShouldClose(window)) {
-        float currentFrame = glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
+            if (stress) {
+                instanceCount = STRESS_INSTANCE_COUNTS[0];
+            }
+            if (instanceCount == 1) {
+                fleet.add(glm::mat4(1.0f));
+            }
+            else {
+                layoutFleet(fleet, instanceCount, FLEET_SPACING * (lodRadius > 0.0f ? lodRadius : 1.0f));
+            }
+            if (USE_OCCLUSION_CULLING) {
+                occluderBuild = std::async(std::launch::async, [&mesh]() { return buildOccluderMesh(decodeCookedMesh(mesh)); });
+            }
+            if (mesh.lodCount == 0 && BUILD_LODS_AT_LOAD) {
+                lodBuild = std::async(std::launch::async, [&mesh, &lodMesh, &lodBuildMs]() {
+                    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                    lodMesh = decodeCookedMesh(mesh);
+                    LodChain chain = buildLodChain(lodMesh);
+                    lodBuildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                    return chain;
+                });
+            }
+        }
+        else if (loader.state() == ModelLoadState::Failed) {
+            std::cerr << "Failed to load model" << std::endl;
+            loadFailed = true;
+            break;
+        }
+        bool modelResident = loader.state() == ModelLoadState::Resident;
+
+        // Background LODs are done: copy the index buffer into a larger one followed by the new levels
+        if (lodBuild.valid() && lodBuild.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            LodChain chain = lodBuild.get();
+            size_t lodIndexCount = lodMesh.indices.size() - mesh.indexCount;
+            std::vector<unsigned char> lodIndices(lodIndexCount * mesh.indexSize);
+            for (size_t i = 0; i < lodIndexCount; i++) {
+                uint32_t index = lodMesh.indices[mesh.indexCount + i];
+                if (mesh.indexSize == sizeof(uint16_t)) {
+                    ((uint16_t*)lodIndices.data())[i] = (uint16_t)index;
+                }
+                else {
+                    ((uint32_t*)lodIndices.data())[i] = index;
+                }
+            }
 
-        processInput(window, model, deltaTime, rotationAxis, wireframeMode);
+            unsigned int lodEBO;
+            glGenBuffers(1, &lodEBO);
+            glBindBuffer(GL_COPY_READ_BUFFER, EBO);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, lodEBO);
+            glBufferData(GL_COPY_WRITE_BUFFER, mesh.indexBytes() + lodIndices.size(), nullptr, GL_STATIC_DRAW);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, mesh.indexBytes());
+            glBufferSubData(GL_COPY_WRITE_BUFFER, mesh.indexBytes(), lodIndices.size(), lodIndices.data());
+            glBindVertexArray(VAO);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, lodEBO);
+            glBindVertexArray(0);
+            glDeleteBuffers(1, &EBO);
+            EBO = lodEBO;
+            glState.invalidate();
+
+            lodLevels = chain.levels;
+            lodSubmeshes = chain.submeshes;
+            lodCenter = chain.center;
+            lodRadius = chain.radius;
+            lodMesh = Mesh();
+            printLodReport(modelPath, lodLevels.data(), (uint32_t)lodLevels.size(), lodBuildMs);
+        }
 
+        if (occluderBuild.valid() && occluderBuild.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            occluder = occluderBuild.get();
+            std::cout << "Occluder: " << occluder.indices.size() / 3 << " triangles" << std::endl;
+        }
+
+        gpuTimer.beginFrame();
+        gpuTimer.beginPass("clear");
         glClearColor(0.1f, 0.1f, 0.2f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        gpuTimer.endPass();
 
         // Set wireframe or solid mode
-        if (wireframeMode) {
-            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-            glLineWidth(1.0f); // Set line width for wireframe
+        glState.polygonMode(wireframeMode ? GL_LINE : GL_FILL);
+
+        // Back faces stay visible in wireframe mode, so cones may only cull solid geometry
+        bool cullBackfaces = CULL_BACKFACING_MESHLETS && !wireframeMode;
+        glState.cullFace(cullBackfaces);
+
+        glState.useProgram(shader.id());
+
+        // This frame's region holds the Frame block followed by at most every fleet transform.
+        // A regrown buffer is a new object the vertex array does not point at yet; a dropped
+        // frame draws nothing but is still presented, so the window stays responsive.
+        StreamFrame streamFrame = stream.beginFrame(sizeof(FrameBlock) + fleet.size() * sizeof(InstanceTransform));
+        if (streamFrame == StreamFrame::Reallocated) {
+            glState.invalidate();
         }
-        else {
-            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+        // Transform matrices and lighting, written straight into the mapped buffer
+        StreamAllocation frameBlock = stream.allocate(sizeof(FrameBlock), stream.uniformAlignment());
+        if (frameBlock.data) {
+            PROFILE_ZONE("uniform setup");
+            FrameBlock& frame = *(FrameBlock*)frameBlock.data;
+            const glm::mat3& normalMatrix = scene.normalMatrix(modelNode);
+            frame.model = model;
+            frame.view = view;
+            frame.projection = projection;
+            for (int column = 0; column < 3; column++) {
+                frame.normalMatrix[column] = glm::vec4(normalMatrix[column], 0.0f);
+            }
+            frame.lightPos = glm::vec4(1.5f, 1.5f, 1.5f, 1.0f);
+            frame.viewPos = glm::vec4(0.0f, 0.3f, 2.0f, 1.0f);
+            frame.lightColor = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+            glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_BLOCK_BINDING, stream.buffer(), frameBlock.offset, sizeof(FrameBlock));
         }
 
-        glUseProgram(shaderProgram);
+        // A fleet is frustum culled, the survivors regrouped by LOD and streamed into the instance
+        // buffer every frame. Culling needs the model's bounding sphere, which comes with the LODs.
+        bool instanced = modelResident && fleet.size() > 1;
+        StreamAllocation instanceData;
+        if (modelResident) {
+            PROFILE_ZONE("cull and batch instances");
+            const uint32_t* visible = nullptr;
+            size_t visibleCount = fleet.size();
+            if (instanced && lodRadius > 0.0f) {
+                if (!fleetBounds.current(fleet, lodCenter, lodRadius)) {
+                    computeInstanceBounds(fleet, lodCenter, lodRadius, fleetBounds);
+                }
+                visibleCount = cullInstances(fleetBounds, extractFrustum(projection * view * model), visibleInstances);
+                visible = visibleInstances.indices.data();
+
+                // The biggest survivors on screen are drawn into the depth buffer; whatever hides behind them is dropped
+                occludedCount = 0;
+                if (!occluder.indices.empty()) {
+                    glm::mat4 viewFromFleet = view * model;
+                    occlusion.selectOccluders(fleetBounds, visibleInstances, viewFromFleet, MAX_OCCLUDERS, occluders);
+                    occluderTransforms.clear();
+                    for (uint32_t index : occluders) {
+                        occluderTransforms.push_back(viewFromFleet * unpackInstanceTransform(fleet.data()[index]));
+                    }
+                    occlusion.render(occluder, projection, occluderTransforms.data(), occluderTransforms.size());
+                    occlusion.buildPyramid();
+                    size_t inFrustum = visibleCount;
+                    visibleCount = occlusion.cullOccludedInstances(fleet, occluder.boxMin, occluder.boxMax, viewFromFleet,
+                                                                   visibleInstances);
+                    occludedCount = inFrustum - visibleCount;
+                }
+            }
+            if (instanced) {
+                batchInstancesByLod(fleet, visible, visibleCount, view * model, lodLevels.data(), (uint32_t)lodLevels.size(),
+                                    lodCenter, lodRadius, (float)HEIGHT, glm::radians(FIELD_OF_VIEW), batches);
+            }
+            const InstanceTransform* instances = instanced ? batches.transforms.data() : fleet.data();
+            instanceData = stream.allocate(visibleCount * sizeof(InstanceTransform));
+            if (instanceData.data) {
+                memcpy(instanceData.data, instances, visibleCount * sizeof(InstanceTransform));
+            }
+        }
+        renderQueue.reset(2);
+
+        // Queue fleet: one instanced draw per submesh of every level that has instances. Coarser
+        // levels are farther away, which is all the depth order batches need.
+        DrawList& fleetDraws = renderQueue.list(0);
+        for (uint32_t level = 0; instanced && level < LOD_LEVEL_COUNT; level++) {
+            uint32_t first = batches.levelOffsets[level];
+            uint32_t count = batches.levelOffsets[level + 1] - first;
+            if (count == 0) {
+                continue;
+            }
+            const Submesh* submeshes = level == 0 ? mesh.submeshes : &lodSubmeshes[lodLevels[level].submeshOffset];
+            uint32_t depth = level * ((1u << SORT_KEY_DEPTH_BITS) / LOD_LEVEL_COUNT);
+            for (uint32_t i = 0; i < mesh.submeshCount; i++) {
+                const Submesh& submesh = submeshes[i];
+                if (submesh.indexCount == 0) {
+                    continue;
+                }
+                DrawCommand command = { (uint32_t)fleetDraws.ranges.size(), 0, first, count, VAO, 0,
+                                        (uint16_t)materialSlot(submesh.materialId), (uint8_t)mesh.indexSize };
+                fleetDraws.ranges.push_back({ submesh.indexOffset, submesh.indexCount });
+                fleetDraws.push(makeSortKey(RENDER_PASS_OPAQUE, 0, command.material, 0, depth), command);
+            }
+        }
 
-        // Set lighting uniforms
-        glm::vec3 lightPos = glm::vec3(1.5f, 1.5f, 1.5f);
-        glm::vec3 lightColor = glm::vec3(1.0f, 1.0f, 1.0f);
-        glm::vec3 viewPos = glm::vec3(0.0f, 0.3f, 2.0f);
+        // Meshlets are culled in model space: the planes come from the full clip transform and
+        // the camera is brought into the model's frame
+        glm::mat4 modelView = view * model * (fleet.empty() ? glm::mat4(1.0f) : unpackInstanceTransform(fleet.data()[0]));
+        Frustum frustum = extractFrustum(projection * modelView);
+        glm::vec3 cameraPosition = glm::vec3(glm::inverse(modelView)[3]);
+
+        // Coarsest level whose geometric error stays under LOD_PIXEL_ERROR pixels at this distance
+        uint32_t lod = 0;
+        if (!lodLevels.empty()) {
+            float pixelsPerUnit = lodPixelsPerUnit(modelView, lodCenter, lodRadius, (float)HEIGHT, glm::radians(FIELD_OF_VIEW));
+            lod = selectLod(lodLevels.data(), (uint32_t)lodLevels.size(), pixelsPerUnit);
+        }
+        const Submesh* submeshes = lod == 0 ? mesh.submeshes : &lodSubmeshes[lodLevels[lod].submeshOffset];
+
+        // Queue single model: faces are grouped by material, so this is one multi-draw per material
+        // over the index ranges of its visible meshlets (meshlets only cover the full-detail level)
+        DrawList& modelDraws = renderQueue.list(1);
+        uint32_t modelDepth = depthBucket(glm::length(glm::vec3(modelView * glm::vec4(lodCenter, 1.0f))), NEAR_PLANE, FAR_PLANE);
+        uint32_t submeshCount = modelResident && !instanced ? mesh.submeshCount : 0;
+        for (uint32_t i = 0; i < submeshCount; i++) {
+            const Submesh& submesh = submeshes[i];
+            DrawCommand command = { (uint32_t)modelDraws.ranges.size(), 0, 0, 0, VAO, 0,
+                                    (uint16_t)materialSlot(submesh.materialId), (uint8_t)mesh.indexSize };
+            if (lod == 0 && mesh.meshletCount > 0) {
+                cullMeshlets(mesh.meshlets + submeshMeshlets[i], submeshMeshlets[i + 1] - submeshMeshlets[i], frustum,
+                             cameraPosition, cullBackfaces, modelDraws.ranges);
+            }
+            else if (submesh.indexCount > 0) {
+                modelDraws.ranges.push_back({ submesh.indexOffset, submesh.indexCount });
+            }
+            if (modelDraws.ranges.size() > command.firstRange) {
+                modelDraws.push(makeSortKey(RENDER_PASS_OPAQUE, 0, command.material, 0, modelDepth), command);
+            }
+        }
 
-        glUniform3fv(glGetUniformLocation(shaderProgram, "lightPos"), 1, glm::value_ptr(lightPos));
-        glUniform3fv(glGetUniformLocation(shaderProgram, "viewPos"), 1, glm::value_ptr(viewPos));
-        glUniform3fv(glGetUniformLocation(shaderProgram, "lightColor"), 1, glm::value_ptr(lightColor));
+        glState.stats.sortMs += renderQueue.sort();
+        // Without its transforms (the buffer failed to regrow, or the frame was dropped) the model is not drawn
+        stream.flush();
+        double submitStartMs = glState.stats.submitMs;
+        if (streamFrame != StreamFrame::Dropped && (instanceData.data || !modelResident)) {
+            gpuTimer.beginPass(wireframeMode ? "wireframe" : "geometry");
+            glState.submit(renderQueue, programs, stream.buffer(), instanceData.offset);
+            gpuTimer.endPass();
+        }
+        stream.endFrame();
 
-        // Set transform matrices
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
-        glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+        if (headless && !stress && modelResident && !becameResident) {
+            if (headlessFrame == 0) {
+                headlessStart = frameStart;
+            }
+            double cpuMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+            headlessCpuMs += cpuMs;
+            headlessWorstCpuMs = std::max(headlessWorstCpuMs, cpuMs);
+            headlessSubmitMs += glState.stats.submitMs - submitStartMs;
+            if (++headlessFrame == headlessFrames) {
+                quit = true;
+            }
+        }
 
-        // Draw model
-        glBindVertexArray(VAO);
-        glDrawArrays(GL_TRIANGLES, 0, vertices.size());
+        // O writes what the occlusion culler saw this frame
+        bool dumpKey = (input.keys & INPUT_KEY_O) != 0;
+        if (dumpKey && !dumpKeyHeld && occlusion.dumpLevels("occlusion")) {
+            std::cout << "Wrote occlusion0.pgm .. occlusion" << occlusion.levelCount() - 1 << ".pgm (and .pfm), "
+                      << occludedCount << " instances occluded" << std::endl;
+        }
+        dumpKeyHeld = dumpKey;
+
+        if (window) {
+            {
+                PROFILE_ZONE("glfwSwapBuffers");
+                gpuTimer.beginPass("present");
+                glfwSwapBuffers(window);
+                gpuTimer.endPass();
+            }
+            glfwPollEvents();
+        }
+        gpuTimer.endFrame();
+        if (stress) {
+            PROFILE_ZONE("glFinish");
+            glFinish(); // Time the GPU work of the frame, not only its submission
+        }
+
+        // The frame that finishes the upload also sets the model up, so it still counts as loading
+        double frameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+        if (firstFrameMs == 0.0) {
+            firstFrameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - launchTime).count();
+        }
+        if (!modelResident || becameResident) {
+            worstLoadingFrameMs = std::max(worstLoadingFrameMs, frameMs);
+            loadingFrames++;
+            if (!becameResident) {
+                worstPendingFrameMs = std::max(worstPendingFrameMs, frameMs);
+            }
+        }
+        else {
+            worstFrameMs = std::max(worstFrameMs, frameMs);
+        }
+        if (becameResident) {
+            loader.printReport();
+            std::cout << "Time to first frame " << firstFrameMs << " ms, worst frame while loading " << worstLoadingFrameMs
+                      << " ms over " << loadingFrames << " frames (" << worstPendingFrameMs << " ms before the model is drawn)"
+                      << std::endl;
+        }
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        // Stress run: time each fleet size once it is warmed up, then move on to the next
+        if (stress && modelResident && !becameResident && ++stressFrame > STRESS_WARMUP_FRAMES) {
+            stressTotalMs += frameMs;
+            stressWorstMs = std::max(stressWorstMs, frameMs);
+            if (stressFrame == STRESS_WARMUP_FRAMES + STRESS_FRAMES) {
+                std::cout << "Stress " << fleet.size() << " instances: avg " << stressTotalMs / STRESS_FRAMES << " ms, worst "
+                          << stressWorstMs << " ms";
+                if (fleet.size() > 1) {
+                    std::cout << ", " << batches.transforms.size() << " visible (" << occludedCount << " occluded), per LOD";
+                    for (uint32_t level = 0; level < LOD_LEVEL_COUNT; level++) {
+                        std::cout << " " << batches.levelOffsets[level + 1] - batches.levelOffsets[level];
+                    }
+                }
+                std::cout << std::endl;
+                printRenderStats(glState.stats);
+                stream.printStats();
+                gpuTimer.printStats();
+                glState.stats = RenderStats();
+                stream.stats = StreamStats();
+                gpuTimer.stats = GpuTimerStats();
+
+                stressFrame = 0;
+                stressTotalMs = stressWorstMs = 0.0;
+                if (++stressStage == sizeof(STRESS_INSTANCE_COUNTS) / sizeof(STRESS_INSTANCE_COUNTS[0])) {
+                    quit = true;
+                }
+                else {
+                    layoutFleet(fleet, STRESS_INSTANCE_COUNTS[stressStage], FLEET_SPACING * (lodRadius > 0.0f ? lodRadius : 1.0f));
+                }
+            }
+        }
+        PROFILE_FRAME();
+    }
+    if (loader.state() == ModelLoadState::Resident) {
+        std::cout << "Worst frame after load " << worstFrameMs << " ms" << std::endl;
+    }
+    shader.printStats(frameCount);
+    printRenderStats(glState.stats);
+    stream.printStats();
+    gpuTimer.finish();
+    gpuTimer.printStats();
+    if (!recordPath.empty() && recordLog.save(recordPath)) {
+        std::cout << "Recorded " << recordLog.size() << " frames of input to " << recordPath << std::endl;
+    }
+#if A2_PROFILE
+    profilerPrintSummary();
+    if (!tracePath.empty()) {
+        profilerWriteTrace(tracePath);
+    }
+#endif
+
+    if (headlessFrame > 0) {
+        glFinish();
+        double totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - headlessStart).count();
+        std::cout << "Headless " << WIDTH << "x" << HEIGHT << ", " << headlessFrame << " frames of " << fleet.size()
+                  << " instances: CPU avg " << headlessCpuMs / headlessFrame << " ms, worst " << headlessWorstCpuMs
+                  << " ms, GL submission avg " << headlessSubmitMs / headlessFrame << " ms, GPU avg "
+                  << gpuTimer.stats.totalMs / std::max<size_t>(gpuTimer.stats.frames, 1) << " ms; " << totalMs << " ms total, "
+                  << headlessFrame * 1000.0 / totalMs << " frames/s" << std::endl;
+        if (!pngPath.empty()) {
+            std::vector<unsigned char> pixels;
+            headlessContext.readPixels(pixels);
+            if (writePng(pngPath, pixels.data(), headlessContext.width(), headlessContext.height(), true)) {
+                std::cout << "Wrote " << pngPath << std::endl;
+            }
+        }
     }
 
+    // The workers read the mapped cache
+    if (lodBuild.valid()) {
+        lodBuild.wait();
+    }
+    if (occluderBuild.valid()) {
+        occluderBuild.wait();
+    }
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
-    glDeleteProgram(shaderProgram);
+    glDeleteBuffers(1, &EBO);
+    glDeleteBuffers(1, &materialUBO);
+    stream.release();
+    gpuTimer.release();
+    shader.release();
+    headlessContext.release();
     glfwTerminate();
-    return 0;
+    return loadFailed ? -1 : 0;
 }
\ No newline at end of file
@@ -5,7 +5,27 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <future>
 #include <vector>
+#include "AsyncModelLoader.h"
+#include "GLStateCache.h"
+#include "GpuTimer.h"
+#include "HeadlessContext.h"
+#include "InputLog.h"
+#include "InstanceCulling.h"
+#include "Instancing.h"
+#include "Benchmarks.h"
+#include "MeshCache.h"
+#include "ModelLoader.h"
+#include "OcclusionCulling.h"
+#include "PngWriter.h"
+#include "Profiler.h"
+#include "ProgramCache.h"
+#include "RenderQueue.h"
+#include "ShaderProgram.h"
+#include "StreamBuffer.h"
+#include "TransformHierarchy.h"
+#include "VertexFormat.h"
 
 // Window dimensions
 const unsigned int WIDTH = 1280;
@@ -17,61 +37,157 @@ const float ROTATION_ANGLE = 10.0f;
 const float SCALE_FACTOR = 1.003f;
 const float KEY_REPEAT_DELAY = 0.5f;
 
-// Vertex shader with lighting
+// Uniform buffer binding points of the Materials and Frame blocks
+const unsigned int MATERIAL_BLOCK_BINDING = 0;
+const unsigned int FRAME_BLOCK_BINDING = 1;
+
+// Per-frame values of both shader stages, written to the stream buffer once a frame and bound as
+// the Frame uniform block (std140: vec3s and mat3 columns take 16 bytes each)
+struct FrameBlock {
+    glm::mat4 model;
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec4 normalMatrix[3];
+    glm::vec4 lightPos;
+    glm::vec4 viewPos;
+    glm::vec4 lightColor;
+};
+static_assert(sizeof(FrameBlock) == 288, "FrameBlock mirrors the std140 layout of the Frame block");
+
+// Initial size of each frame's region of the stream buffer, which carries the Frame block and
+// the visible instance transforms; it grows when a fleet needs more
+const size_t STREAM_REGION_BYTES = 1 << 20;
+
+// How the model is cooked: quantized 12-byte vertices, cache/overdraw optimized index order,
+// meshlet side table for per-cluster culling, LOD chain
+const CookSettings MODEL_COOK_SETTINGS = { VertexFormat::Quantized, true, true, true };
+
+// When the cache carries no LODs (cooked without buildLods), build them on a worker thread once
+// the model is loaded; the full mesh is drawn until they are ready
+const bool BUILD_LODS_AT_LOAD = true;
+
+// Keep linked shader programs in PROGRAM_CACHE_DIRECTORY and reload them on later launches
+const bool USE_PROGRAM_BINARY_CACHE = true;
+
+// Distance between neighbouring fleet instances, in model bounding radii
+const float FLEET_SPACING = 2.5f;
+
+// Rasterize the largest fleet instances into a CPU depth buffer and skip the ones hidden behind
+// them. The occluder is simplified from the model on a worker thread once it is loaded.
+const bool USE_OCCLUSION_CULLING = true;
+
+// Fleet sizes `a2 --stress` steps through, and the frames it times at each after a warm-up
+const uint32_t STRESS_INSTANCE_COUNTS[] = { 1, 100, 1000, 10000, 50000, 100000 };
+const int STRESS_WARMUP_FRAMES = 10;
+const int STRESS_FRAMES = 100;
+
+// Frames `a2 --headless` times once the model is resident, unless --frames says otherwise
+const int HEADLESS_FRAMES = 200;
+
+// Vertical field of view in degrees, also used to turn LOD errors into pixels
+const float FIELD_OF_VIEW = 45.0f;
+// Clip planes, also the range the render queue's depth buckets cover
+const float NEAR_PLANE = 0.1f;
+const float FAR_PLANE = 100.0f;
+
+// Backface cone culling of meshlets, which also turns on GL_CULL_FACE in solid mode. Off because
+// about 6% of the cybertruck's triangles are wound against their normals and would disappear.
+const bool CULL_BACKFACING_MESHLETS = false;
+
+// Vertex shader with lighting. Quantized meshes are decoded here: positions are unorm16
+// inside the AABB (offset + scale * aPos) and normals arrive as 2 octahedral components.
+// Every vertex is placed by its instance's 3x4 transform (locations 3-5, see Instancing.h)
+// before the shared model matrix. Normals take the model's normal matrix, computed once on the
+// CPU, after the instance's upper 3x3: instances only rotate and scale uniformly, which changes
+// nothing but the length the fragment shader normalizes away. Matrices and light come from the
+// Frame block, one buffer range bound per frame instead of a uniform call per value.
 const char* vertexShaderSource = "#version 330 core\n"
 "layout (location = 0) in vec3 aPos;\n"
-"layout (location = 1) in vec3 aColor;\n"
 "layout (location = 2) in vec3 aNormal;\n"
+"layout (location = 3) in vec4 aInstanceRow0;\n"
+"layout (location = 4) in vec4 aInstanceRow1;\n"
+"layout (location = 5) in vec4 aInstanceRow2;\n"
 "out vec3 FragPos;\n"
 "out vec3 Normal;\n"
-"out vec3 ourColor;\n"
-"uniform mat4 model;\n"
-"uniform mat4 view;\n"
-"uniform mat4 projection;\n"
+"layout (std140) uniform Frame {\n"
+"   mat4 model;\n"
+"   mat4 view;\n"
+"   mat4 projection;\n"
+"   mat3 normalMatrix;\n"
+"   vec3 lightPos;\n"
+"   vec3 viewPos;\n"
+"   vec3 lightColor;\n"
+"};\n"
+"uniform vec3 positionOffset;\n"
+"uniform vec3 positionScale;\n"
+"uniform bool octahedralNormals;\n"
+"vec3 decodeNormal(vec3 n)\n"
+"{\n"
+"   if (!octahedralNormals) return n;\n"
+"   vec3 d = vec3(n.xy, 1.0 - abs(n.x) - abs(n.y));\n"
+"   float t = max(-d.z, 0.0);\n"
+"   d.x += d.x >= 0.0 ? -t : t;\n"
+"   d.y += d.y >= 0.0 ? -t : t;\n"
+"   return d;\n"
+"}\n"
 "void main()\n"
 "{\n"
-"   FragPos = vec3(model * vec4(aPos, 1.0));\n"
-"   Normal = mat3(transpose(inverse(model))) * aNormal;\n"
-"   ourColor = aColor;\n"
-"   gl_Position = projection * view * model * vec4(aPos, 1.0);\n"
+"   mat4 instance = transpose(mat4(aInstanceRow0, aInstanceRow1, aInstanceRow2, vec4(0.0, 0.0, 0.0, 1.0)));\n"
+"   mat4 world = model * instance;\n"
+"   vec3 position = positionOffset + positionScale * aPos;\n"
+"   FragPos = vec3(world * vec4(position, 1.0));\n"
+"   Normal = normalMatrix * (mat3(instance) * decodeNormal(aNormal));\n"
+"   gl_Position = projection * view * vec4(FragPos, 1.0);\n"
 "}\0";
 
-// Fragment shader with lighting
+// Fragment shader with lighting, shaded with the MTL material of the submesh being drawn.
+// The Materials block mirrors MaterialBlockEntry and holds MAX_MATERIALS entries; the Frame
+// block is shared with the vertex shader.
 const char* fragmentShaderSource = "#version 330 core\n"
 "in vec3 FragPos;\n"
 "in vec3 Normal;\n"
-"in vec3 ourColor;\n"
 "out vec4 FragColor;\n"
-"uniform vec3 lightPos;\n"
-"uniform vec3 viewPos;\n"
-"uniform vec3 lightColor;\n"
+"struct MaterialData {\n"
+"   vec4 diffuse;\n"
+"   vec4 specular;\n"
+"   vec4 emission;\n"
+"};\n"
+"layout (std140) uniform Materials {\n"
+"   MaterialData materials[256];\n"
+"};\n"
+"layout (std140) uniform Frame {\n"
+"   mat4 model;\n"
+"   mat4 view;\n"
+"   mat4 projection;\n"
+"   mat3 normalMatrix;\n"
+"   vec3 lightPos;\n"
+"   vec3 viewPos;\n"
+"   vec3 lightColor;\n"
+"};\n"
+"uniform int materialIndex;\n"
 "void main()\n"
 "{\n"
+"   MaterialData material = materials[materialIndex];\n"
+"   \n"
 "   float ambientStrength = 0.3;\n"
-"   vec3 ambient = ambientStrength * lightColor;\n"
+"   vec3 ambient = ambientStrength * lightColor * material.diffuse.rgb;\n"
 "   \n"
 "   vec3 norm = normalize(Normal);\n"
 "   vec3 lightDir = normalize(lightPos - FragPos);\n"
 "   float diff = max(dot(norm, lightDir), 0.0);\n"
-"   vec3 diffuse = diff * lightColor;\n"
+"   vec3 diffuse = diff * lightColor * material.diffuse.rgb;\n"
 "   \n"
-"   float specularStrength = 0.5;\n"
 "   vec3 viewDir = normalize(viewPos - FragPos);\n"
 "   vec3 reflectDir = reflect(-lightDir, norm);\n"
-"   float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);\n"
-"   vec3 specular = specularStrength * spec * lightColor;\n"
+"   float spec = pow(max(dot(viewDir, reflectDir), 0.0), max(material.specular.a, 1.0));\n"
+"   vec3 specular = spec * lightColor * material.specular.rgb;\n"
 "   \n"
-"   vec3 result = (ambient + diffuse + specular) * ourColor;\n"
-"   FragColor = vec4(result, 1.0);\n"
+"   vec3 result = ambient + diffuse + specular + material.emission.rgb;\n"
+"   FragColor = vec4(result, material.diffuse.a);\n"
 "}\n\0";
 
-struct Vertex {
-    glm::vec3 position;
-    glm::vec3 normal;
-    glm::vec3 color;
-};
-
 // Function prototypes
-std::vector<Vertex> loadModel(const std::string& path);
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
-void processInput(GLFWwindow* window, glm::mat4& model, float deltaTime, glm::vec3& rotationAxis, bool& wireframeMode);
\ No newline at end of file
+uint16_t pollInputKeys(GLFWwindow* window);
+bool processInput(const InputFrame& input, TransformHierarchy& scene, TransformHandle model, glm::vec3& rotationAxis, bool& wireframeMode);
+void setupVertexAttributes(VertexFormat format);
\ No newline at end of file
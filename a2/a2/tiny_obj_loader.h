@@ -632,6 +632,21 @@ bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
              MaterialReader *readMatFn = NULL, bool triangulate = true,
              bool default_vcols_fallback = true);
 
+/// Loads .obj from a memory buffer (e.g. a memory-mapped file) on a pool of
+/// `num_threads` worker threads (0 = std::thread::hardware_concurrency()).
+/// The buffer is split into newline-aligned chunks that are parsed in
+/// parallel, then merged with a prefix sum over the per-chunk element counts
+/// so relative (negative) indices resolve exactly as in LoadObj().
+/// `attrib`, `shapes` and `materials` are identical to the LoadObj() result
+/// for the same text; only the order of warning messages may differ.
+/// Files using `l`, `p`, `t` or `vw` fall back to the sequential LoadObj().
+bool LoadObjParallel(attrib_t *attrib, std::vector<shape_t> *shapes,
+                     std::vector<material_t> *materials, std::string *warn,
+                     std::string *err, const char *buf, size_t len,
+                     MaterialReader *readMatFn = NULL, bool triangulate = true,
+                     bool default_vcols_fallback = true,
+                     unsigned int num_threads = 0);
+
 /// Loads materials into std::map
 void LoadMtl(std::map<std::string, int> *material_map,
              std::vector<material_t> *materials, std::istream *inStream,
@@ -666,6 +681,57 @@ bool ParseTextureNameAndOption(std::string *texname, texture_option_t *texopt,
 #include <set>
 #include <sstream>
 #include <utility>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+// Number parsing uses an exact fast path (Clinger) backed by std::from_chars,
+// both correctly rounded, and an SSE2 token scanner when the toolchain supports
+// them. Define TINYOBJLOADER_USE_LEGACY_FLOAT_PARSER to force the original
+// hand-written parser and the strspn/strcspn token scanning.
+#ifndef TINYOBJLOADER_USE_LEGACY_FLOAT_PARSER
+#include <cfloat>
+#if !defined(FLT_EVAL_METHOD) || FLT_EVAL_METHOD == 0
+// The fast path needs plain double arithmetic (no x87 extended precision)
+#define TINYOBJLOADER_FAST_FLOAT_PARSER
+#endif
+// Fractions are read 8 digits at a time only on little-endian targets, where
+// the first digit lands in the lowest byte of the block; elsewhere (or when the
+// byte order is unknown) the digit loop reads them one at a time.
+#if (defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__) && \
+     __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) ||                    \
+    defined(_M_IX86) || defined(_M_X64) || defined(_M_ARM) ||          \
+    defined(_M_ARM64)
+#define TINYOBJLOADER_SWAR_DIGITS
+#endif
+
+#if defined(__has_include)
+#if __has_include(<charconv>) && \
+    (__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+#include <charconv>
+#endif
+#endif
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+#define TINYOBJLOADER_HAS_FROM_CHARS
+#endif
+
+#if defined(__SANITIZE_ADDRESS__)
+#define TINYOBJLOADER_NO_SSE2_SCANNER
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define TINYOBJLOADER_NO_SSE2_SCANNER
+#endif
+#endif
+#if !defined(TINYOBJLOADER_NO_SSE2_SCANNER) && \
+    (defined(__SSE2__) || defined(_M_X64) ||     \
+     (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#define TINYOBJLOADER_SSE2_SCANNER
+#endif
+#endif  // TINYOBJLOADER_USE_LEGACY_FLOAT_PARSER
 
 #ifdef TINYOBJLOADER_USE_MAPBOX_EARCUT
 
@@ -894,7 +960,8 @@ static inline int parseInt(const char **token) {
 //  - s >= s_end.
 //  - parse failure.
 //
-static bool tryParseDouble(const char *s, const char *s_end, double *result) {
+static bool tryParseDoubleLegacy(const char *s, const char *s_end,
+                                 double *result) {
   if (s >= s_end) {
     return false;
   }
@@ -1027,9 +1094,230 @@ fail:
   return false;
 }
 
+#ifdef TINYOBJLOADER_FAST_FLOAT_PARSER
+// Same grammar as tryParseDoubleLegacy, but correctly rounded and faster.
+// Numbers with at most 19 digits, a mantissa below 2^53 and a
+// decimal exponent within +-22 (practically every number in an OBJ file) are
+// exact in double arithmetic: one multiply or divide by an exact power of ten
+// rounds correctly (Clinger's fast path). Longer numbers go through
+// std::from_chars when available. Anything else is handed to the legacy
+// parser, so malformed input, overflow and underflow behave exactly as before.
+#ifdef TINYOBJLOADER_SWAR_DIGITS
+// The last `count` (1-7) characters before `end` as a little-endian 8-byte
+// block, with the bytes in front of them replaced by '0'. The 8 bytes before
+// `end` must be readable.
+static inline unsigned long long loadFractionDigits(const char *end,
+                                                    ptrdiff_t count) {
+  unsigned long long block;
+  memcpy(&block, end - 8, sizeof(block));
+  const unsigned long long keep = ~0ULL << (8 * (8 - count));
+  return (block & keep) | (0x3030303030303030ULL & ~keep);
+}
+
+static inline bool isEightDigits(unsigned long long block) {
+  return ((block & 0xF0F0F0F0F0F0F0F0ULL) |
+          (((block + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) ==
+         0x3333333333333333ULL;
+}
+
+// Value of 8 ASCII digits (first digit in the lowest byte) in three multiplies
+static inline unsigned int parseEightDigits(unsigned long long block) {
+  const unsigned long long mask = 0x000000FF000000FFULL;
+  const unsigned long long mul1 = 0x000F424000000064ULL;  // 100 + (1000000 << 32)
+  const unsigned long long mul2 = 0x0000271000000001ULL;  // 1 + (10000 << 32)
+  block -= 0x3030303030303030ULL;
+  block = (block * 10) + (block >> 8);
+  block = (((block & mask) * mul1) + (((block >> 16) & mask) * mul2)) >> 32;
+  return static_cast<unsigned int>(block);
+}
+#endif
+
+static bool tryParseDoubleFast(const char *s, const char *s_end,
+                               double *result) {
+  static const double exact_pow10[] = {
+      1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+  };
+
+  if (s >= s_end) {
+    return false;
+  }
+
+  const char *curr = s;
+  bool negative = false;
+  if (*curr == '+' || *curr == '-') {
+    negative = (*curr == '-');
+    curr++;
+  }
+  const char *number = curr;
+
+  unsigned long long mantissa = 0;
+  for (; curr != s_end && IS_DIGIT(*curr); curr++) {
+    mantissa = mantissa * 10 + static_cast<unsigned int>(*curr - '0');
+  }
+  int digits = static_cast<int>(curr - number);
+  int exponent = 0;
+  if (curr != s_end && *curr == '.') {
+    curr++;
+    const char *fraction = curr;
+#ifdef TINYOBJLOADER_SWAR_DIGITS
+    // Read the fraction as 8-digit SWAR blocks where possible; this breaks
+    // the digit-by-digit multiply-add dependency chain.
+    unsigned long long block;
+    while (s_end - curr >= 8 &&
+           (memcpy(&block, curr, sizeof(block)), isEightDigits(block))) {
+      mantissa = mantissa * 100000000ULL + parseEightDigits(block);
+      curr += 8;
+    }
+    // A shorter tail that runs to the end of the token is read as the last
+    // 8 bytes of the token.
+    const ptrdiff_t tail = s_end - curr;
+    if (tail >= 1 && tail < 8 && s_end - s >= 8 &&
+        (block = loadFractionDigits(s_end, tail), isEightDigits(block))) {
+      static const unsigned long long scale[] = {
+          1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+          10000000ULL};
+      mantissa = mantissa * scale[tail] + parseEightDigits(block);
+      curr = s_end;
+    }
+#endif
+    for (; curr != s_end && IS_DIGIT(*curr); curr++) {
+      mantissa = mantissa * 10 + static_cast<unsigned int>(*curr - '0');
+    }
+    exponent = -static_cast<int>(curr - fraction);
+    digits -= exponent;
+  }
+  if (digits == 0) {
+    return tryParseDoubleLegacy(s, s_end, result);
+  }
+
+  if (curr != s_end && (*curr == 'e' || *curr == 'E')) {
+    curr++;
+    bool exp_negative = false;
+    if (curr != s_end && (*curr == '+' || *curr == '-')) {
+      exp_negative = (*curr == '-');
+      curr++;
+    }
+    if (curr == s_end || !IS_DIGIT(*curr)) {
+      // Empty exponent: let the legacy parser report the error.
+      return tryParseDoubleLegacy(s, s_end, result);
+    }
+    int exp_value = 0;
+    for (; curr != s_end && IS_DIGIT(*curr); curr++) {
+      if (exp_value >= 100000) {
+        // Far out of range anyway: keep the legacy overflow behaviour.
+        return tryParseDoubleLegacy(s, s_end, result);
+      }
+      exp_value = exp_value * 10 + (*curr - '0');
+    }
+    exponent += exp_negative ? -exp_value : exp_value;
+  }
+
+  // Up to 19 digits cannot overflow the 64-bit mantissa
+  if (digits <= 19 && mantissa <= (1ULL << 53) && exponent >= -22 &&
+      exponent <= 22) {
+    double value = static_cast<double>(mantissa);
+    value = exponent < 0 ? value / exact_pow10[-exponent]
+                         : value * exact_pow10[exponent];
+    *result = negative ? -value : value;
+    return true;
+  }
+
+#ifdef TINYOBJLOADER_HAS_FROM_CHARS
+  // from_chars rejects a leading '+', so the sign is applied here.
+  double value;
+  std::from_chars_result r =
+      std::from_chars(number, curr, value, std::chars_format::general);
+  if (r.ec == std::errc() && r.ptr == curr) {
+    *result = negative ? -value : value;
+    return true;
+  }
+#else
+  (void)number;
+#endif
+
+  return tryParseDoubleLegacy(s, s_end, result);
+}
+#endif
+
+static inline bool tryParseDouble(const char *s, const char *s_end,
+                                  double *result) {
+#ifdef TINYOBJLOADER_FAST_FLOAT_PARSER
+  return tryParseDoubleFast(s, s_end, result);
+#else
+  return tryParseDoubleLegacy(s, s_end, result);
+#endif
+}
+
+#ifdef TINYOBJLOADER_SSE2_SCANNER
+// Bit i is set when byte i of the block is ' ', '\t', '\r' or '\0'.
+static inline unsigned int tokenDelimiterMask(__m128i block) {
+  __m128i hit = _mm_or_si128(
+      _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(' ')),
+                   _mm_cmpeq_epi8(block, _mm_set1_epi8('\t'))),
+      _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('\r')),
+                   _mm_cmpeq_epi8(block, _mm_setzero_si128())));
+  return static_cast<unsigned int>(_mm_movemask_epi8(hit));
+}
+
+static inline unsigned int countTrailingZeros(unsigned int mask) {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return static_cast<unsigned int>(index);
+#else
+  return static_cast<unsigned int>(__builtin_ctz(mask));
+#endif
+}
+#endif
+
+// Skips spaces and tabs (same as s + strspn(s, " \t")).
+static inline const char *skipTokenSpaces(const char *s) {
+#ifdef TINYOBJLOADER_USE_LEGACY_FLOAT_PARSER
+  return s + strspn(s, " \t");
+#else
+  // Numbers are usually separated by a single blank, so a scalar loop wins.
+  while (IS_SPACE(*s)) {
+    s++;
+  }
+  return s;
+#endif
+}
+
+// Finds the end of the token starting at s: the first ' ', '\t', '\r' or the
+// terminating NUL (same as s + strcspn(s, " \t\r")). s must point into a NUL
+// terminated string.
+static inline const char *findTokenEnd(const char *s) {
+#if defined(TINYOBJLOADER_SSE2_SCANNER)
+  // Scan 16 bytes at a time with aligned loads. Memory is protected in whole
+  // pages, whose size is a multiple of 16, so an aligned 16-byte load never
+  // crosses into the next page: the block holding the NUL lies in a page the
+  // string already occupies, and reading its bytes past the end cannot fault.
+  // Those bytes are masked out by the NUL being found first. The overread is
+  // still invisible to the C++ object model, which is why AddressSanitizer
+  // builds use the scalar loop instead (TINYOBJLOADER_NO_SSE2_SCANNER).
+  const size_t misalign = reinterpret_cast<size_t>(s) & 15;
+  const __m128i *block = reinterpret_cast<const __m128i *>(s - misalign);
+  unsigned int mask = tokenDelimiterMask(_mm_load_si128(block)) &
+                      (0xFFFFu << misalign);
+  while (mask == 0) {
+    block++;
+    mask = tokenDelimiterMask(_mm_load_si128(block));
+  }
+  return reinterpret_cast<const char *>(block) + countTrailingZeros(mask);
+#elif defined(TINYOBJLOADER_USE_LEGACY_FLOAT_PARSER)
+  return s + strcspn(s, " \t\r");
+#else
+  while (*s != '\0' && !IS_SPACE(*s) && *s != '\r') {
+    s++;
+  }
+  return s;
+#endif
+}
+
 static inline real_t parseReal(const char **token, double default_value = 0.0) {
-  (*token) += strspn((*token), " \t");
-  const char *end = (*token) + strcspn((*token), " \t\r");
+  (*token) = skipTokenSpaces(*token);
+  const char *end = findTokenEnd(*token);
   double val = default_value;
   tryParseDouble((*token), end, &val);
   real_t f = static_cast<real_t>(val);
@@ -1038,8 +1326,8 @@ static inline real_t parseReal(const char **token, double default_value = 0.0) {
 }
 
 static inline bool parseReal(const char **token, real_t *out) {
-  (*token) += strspn((*token), " \t");
-  const char *end = (*token) + strcspn((*token), " \t\r");
+  (*token) = skipTokenSpaces(*token);
+  const char *end = findTokenEnd(*token);
   double val;
   bool ret = tryParseDouble((*token), end, &val);
   if (ret) {
@@ -3155,6 +3443,836 @@ bool LoadObj(attrib_t *attrib, std::vector<shape_t> *shapes,
   return true;
 }
 
+// Runs fn(0) .. fn(num_items - 1) on up to `num_threads` threads. Items are
+// handed out through an atomic counter so uneven work balances itself.
+template <typename Fn>
+static void ParallelFor(size_t num_items, unsigned int num_threads,
+                        const Fn &fn) {
+  size_t num_workers = std::min(static_cast<size_t>(num_threads), num_items);
+  if (num_workers <= 1) {
+    for (size_t i = 0; i < num_items; i++) {
+      fn(i);
+    }
+    return;
+  }
+
+  std::atomic<size_t> next_item(0);
+  std::vector<std::thread> workers;
+  workers.reserve(num_workers - 1);
+
+  struct Worker {
+    std::atomic<size_t> *next_item;
+    size_t num_items;
+    const Fn *fn;
+    void operator()() const {
+      for (;;) {
+        size_t i = next_item->fetch_add(1);
+        if (i >= num_items) return;
+        (*fn)(i);
+      }
+    }
+  };
+  Worker worker = {&next_item, num_items, &fn};
+
+  for (size_t t = 1; t < num_workers; t++) {
+    workers.push_back(std::thread(worker));
+  }
+  worker();
+  for (size_t t = 0; t < workers.size(); t++) {
+    workers[t].join();
+  }
+}
+
+// Finds the end of the line starting at `p` the way safeGetline() does:
+// a line ends at "\n", "\r\n" or a lone "\r". `*next` receives the start of
+// the following line.
+static inline const char *FindLineEnd(const char *p, const char *end,
+                                      const char **next) {
+  const char *nl = static_cast<const char *>(
+      memchr(p, '\n', static_cast<size_t>(end - p)));
+  const char *line_end = nl ? nl : end;
+  const char *cr = static_cast<const char *>(
+      memchr(p, '\r', static_cast<size_t>(line_end - p)));
+  if (cr) {
+    (*next) = (cr + 1 == nl) ? nl + 1 : cr + 1;
+    return cr;
+  }
+  (*next) = nl ? nl + 1 : end;
+  return line_end;
+}
+
+enum obj_command_type_t {
+  OBJ_COMMAND_FACES,   // run of consecutive `f` lines
+  OBJ_COMMAND_USEMTL,
+  OBJ_COMMAND_MTLLIB,
+  OBJ_COMMAND_GROUP,
+  OBJ_COMMAND_OBJECT,
+  OBJ_COMMAND_SMOOTHING
+};
+
+// Order-dependent line of a chunk, replayed sequentially during the merge
+struct obj_command_t {
+  obj_command_type_t type;
+  size_t line_num;
+  size_t face_begin;  // OBJ_COMMAND_FACES: first face of the run in the chunk
+  size_t face_count;
+  unsigned int smoothing_group_id;  // OBJ_COMMAND_SMOOTHING
+  std::string str;                  // usemtl/mtllib/object name
+  std::vector<std::string> names;   // group names (names[0] is "g")
+};
+
+// Newline-aligned slice of the input and everything parsed from it
+struct obj_chunk_t {
+  const char *begin;
+  const char *end;
+
+  // Counting pass, turned into global bases by a prefix sum
+  size_t num_lines;
+  size_t num_v, num_vn, num_vt;
+  size_t line_base;
+  size_t v_base, vn_base, vt_base;
+
+  // Parsing pass
+  std::vector<real_t> v;
+  std::vector<real_t> vertex_weights;
+  std::vector<real_t> vn;
+  std::vector<real_t> vt;
+  std::vector<real_t> vc;
+  bool found_all_colors;
+  int greatest_v_idx, greatest_vn_idx, greatest_vt_idx;
+
+  std::vector<vertex_index_t> face_indices;
+  std::vector<size_t> face_offsets;  // face_indices range of each face
+  std::vector<obj_command_t> commands;
+
+  std::string warn;
+  std::string err;
+  bool failed;
+  bool unsupported;  // uses a command only the sequential loader handles
+
+  obj_chunk_t()
+      : begin(NULL),
+        end(NULL),
+        num_lines(0),
+        num_v(0),
+        num_vn(0),
+        num_vt(0),
+        line_base(0),
+        v_base(0),
+        vn_base(0),
+        vt_base(0),
+        found_all_colors(true),
+        greatest_v_idx(-1),
+        greatest_vn_idx(-1),
+        greatest_vt_idx(-1),
+        failed(false),
+        unsupported(false) {
+    face_offsets.push_back(0);
+  }
+};
+
+// Counting pass: number of lines and of v/vn/vt elements in a chunk
+static void CountObjChunk(obj_chunk_t *chunk) {
+  const char *p = chunk->begin;
+  while (p < chunk->end) {
+    const char *next;
+    const char *line_end = FindLineEnd(p, chunk->end, &next);
+    chunk->num_lines++;
+
+    const char *token = p;
+    while (token < line_end && IS_SPACE(token[0])) token++;
+    if (line_end - token >= 2 && token[0] == 'v') {
+      if (IS_SPACE(token[1])) {
+        chunk->num_v++;
+      } else if (line_end - token >= 3 && IS_SPACE(token[2])) {
+        if (token[1] == 'n') chunk->num_vn++;
+        if (token[1] == 't') chunk->num_vt++;
+      }
+    }
+    p = next;
+  }
+}
+
+// Parsing pass: mirrors the line handling of LoadObj() for one chunk, with
+// relative indices resolved against the global element counts at each line.
+static void ParseObjChunk(obj_chunk_t *chunk, bool want_warn,
+                          bool default_vcols_fallback) {
+  chunk->v.reserve(chunk->num_v * 3);
+  chunk->vertex_weights.reserve(chunk->num_v);
+  chunk->vn.reserve(chunk->num_vn * 3);
+  chunk->vt.reserve(chunk->num_vt * 2);
+
+  std::string linebuf;
+  size_t line_num = chunk->line_base;
+  const char *p = chunk->begin;
+  while (p < chunk->end) {
+    const char *next;
+    const char *line_end = FindLineEnd(p, chunk->end, &next);
+    linebuf.assign(p, line_end);
+    p = next;
+    line_num++;
+
+    if (linebuf.empty()) {
+      continue;
+    }
+
+    const char *token = linebuf.c_str();
+    token += strspn(token, " \t");
+
+    if (token[0] == '\0') continue;  // empty line
+
+    if (token[0] == '#') continue;  // comment line
+
+    // vertex
+    if (token[0] == 'v' && IS_SPACE((token[1]))) {
+      token += 2;
+      real_t x, y, z;
+      real_t r, g, b;
+
+      int num_components =
+          parseVertexWithColor(&x, &y, &z, &r, &g, &b, &token);
+      chunk->found_all_colors &= (num_components == 6);
+
+      chunk->v.push_back(x);
+      chunk->v.push_back(y);
+      chunk->v.push_back(z);
+
+      chunk->vertex_weights.push_back(r);
+
+      if ((num_components == 6) || default_vcols_fallback) {
+        chunk->vc.push_back(r);
+        chunk->vc.push_back(g);
+        chunk->vc.push_back(b);
+      }
+
+      continue;
+    }
+
+    // normal
+    if (token[0] == 'v' && token[1] == 'n' && IS_SPACE((token[2]))) {
+      token += 3;
+      real_t x, y, z;
+      parseReal3(&x, &y, &z, &token);
+      chunk->vn.push_back(x);
+      chunk->vn.push_back(y);
+      chunk->vn.push_back(z);
+      continue;
+    }
+
+    // texcoord
+    if (token[0] == 'v' && token[1] == 't' && IS_SPACE((token[2]))) {
+      token += 3;
+      real_t x, y;
+      parseReal2(&x, &y, &token);
+      chunk->vt.push_back(x);
+      chunk->vt.push_back(y);
+      continue;
+    }
+
+    // skin weights, lines, points and tags are left to the sequential loader
+    if ((token[0] == 'v' && token[1] == 'w' && IS_SPACE((token[2]))) ||
+        (token[0] == 'l' && IS_SPACE((token[1]))) ||
+        (token[0] == 'p' && IS_SPACE((token[1]))) ||
+        (token[0] == 't' && IS_SPACE((token[1])))) {
+      chunk->unsupported = true;
+      return;
+    }
+
+    // face
+    if (token[0] == 'f' && IS_SPACE((token[1]))) {
+      token += 2;
+      token += strspn(token, " \t");
+
+      warning_context context;
+      context.warn = want_warn ? &chunk->warn : NULL;
+      context.line_number = line_num;
+
+      // Element counts seen so far in the whole file
+      int vsize = static_cast<int>(chunk->v_base + chunk->v.size() / 3);
+      int vnsize = static_cast<int>(chunk->vn_base + chunk->vn.size() / 3);
+      int vtsize = static_cast<int>(chunk->vt_base + chunk->vt.size() / 2);
+
+      while (!IS_NEW_LINE(token[0]) && token[0] != '#') {
+        vertex_index_t vi;
+        if (!parseTriple(&token, vsize, vnsize, vtsize, &vi, context)) {
+          chunk->err =
+              "Failed to parse `f' line (e.g. a zero value for vertex index "
+              "or invalid relative vertex index). Line " +
+              toString(line_num) + ").\n";
+          chunk->failed = true;
+          return;
+        }
+
+        chunk->greatest_v_idx = chunk->greatest_v_idx > vi.v_idx
+                                    ? chunk->greatest_v_idx
+                                    : vi.v_idx;
+        chunk->greatest_vn_idx = chunk->greatest_vn_idx > vi.vn_idx
+                                     ? chunk->greatest_vn_idx
+                                     : vi.vn_idx;
+        chunk->greatest_vt_idx = chunk->greatest_vt_idx > vi.vt_idx
+                                     ? chunk->greatest_vt_idx
+                                     : vi.vt_idx;
+
+        chunk->face_indices.push_back(vi);
+        size_t n = strspn(token, " \t\r");
+        token += n;
+      }
+
+      size_t face_id = chunk->face_offsets.size() - 1;
+      chunk->face_offsets.push_back(chunk->face_indices.size());
+
+      if (!chunk->commands.empty() &&
+          chunk->commands.back().type == OBJ_COMMAND_FACES) {
+        chunk->commands.back().face_count++;
+      } else {
+        obj_command_t command;
+        command.type = OBJ_COMMAND_FACES;
+        command.line_num = line_num;
+        command.face_begin = face_id;
+        command.face_count = 1;
+        chunk->commands.push_back(command);
+      }
+
+      continue;
+    }
+
+    obj_command_t command;
+    command.line_num = line_num;
+    command.face_begin = 0;
+    command.face_count = 0;
+    command.smoothing_group_id = 0;
+
+    // use mtl
+    if ((0 == strncmp(token, "usemtl", 6))) {
+      token += 6;
+      command.type = OBJ_COMMAND_USEMTL;
+      command.str = parseString(&token);
+      chunk->commands.push_back(command);
+      continue;
+    }
+
+    // load mtl
+    if ((0 == strncmp(token, "mtllib", 6)) && IS_SPACE((token[6]))) {
+      token += 7;
+      command.type = OBJ_COMMAND_MTLLIB;
+      command.str = std::string(token);
+      chunk->commands.push_back(command);
+      continue;
+    }
+
+    // group name
+    if (token[0] == 'g' && IS_SPACE((token[1]))) {
+      command.type = OBJ_COMMAND_GROUP;
+      while (!IS_NEW_LINE(token[0]) && token[0] != '#') {
+        std::string str = parseString(&token);
+        command.names.push_back(str);
+        token += strspn(token, " \t\r");  // skip tag
+      }
+      chunk->commands.push_back(command);
+      continue;
+    }
+
+    // object name
+    if (token[0] == 'o' && IS_SPACE((token[1]))) {
+      token += 2;
+      command.type = OBJ_COMMAND_OBJECT;
+      command.str = std::string(token);
+      chunk->commands.push_back(command);
+      continue;
+    }
+
+    if (token[0] == 's' && IS_SPACE(token[1])) {
+      // smoothing group id
+      token += 2;
+
+      // skip space.
+      token += strspn(token, " \t");  // skip space
+
+      if (token[0] == '\0') {
+        continue;
+      }
+
+      if (token[0] == '\r' || token[1] == '\n') {
+        continue;
+      }
+
+      command.type = OBJ_COMMAND_SMOOTHING;
+      if (strlen(token) >= 3 && token[0] == 'o' && token[1] == 'f' &&
+          token[2] == 'f') {
+        command.smoothing_group_id = 0;
+      } else {
+        // assume number
+        int smGroupId = parseInt(&token);
+        command.smoothing_group_id =
+            smGroupId < 0 ? 0 : static_cast<unsigned int>(smGroupId);
+      }
+      chunk->commands.push_back(command);
+      continue;
+    }
+
+    // Ignore unknown command.
+  }
+}
+
+// Slice of a face group handed to exportGroupsToShape() on a worker.
+// Triangulation is per face, so exporting a group in several slices and
+// concatenating the results equals exporting it in one call.
+struct obj_export_batch_t {
+  size_t shape_slot;
+  int material_id;
+  std::string name;
+  size_t chunk;
+  size_t face_begin;
+  size_t face_count;
+  unsigned int smoothing_group_id;
+
+  shape_t result;
+  std::string warn;
+  size_t indices_offset;  // where `result` lands in the merged shape
+  size_t faces_offset;
+};
+
+// Shape under construction between two `g`/`o` lines
+struct obj_shape_slot_t {
+  enum { PUSH_IF_FACES, PUSH_AT_END } push_rule;
+  bool last_group_nonempty;  // PUSH_AT_END: exportGroupsToShape() returned true
+  size_t first_batch;
+  size_t num_batches;
+  int shape_index;  // index in `shapes`, -1 when the shape is dropped
+};
+
+class MemoryStreamBuf : public std::streambuf {
+ public:
+  MemoryStreamBuf(const char *buf, size_t len) {
+    char *p = const_cast<char *>(buf);
+    setg(p, p, p + len);
+  }
+};
+
+bool LoadObjParallel(attrib_t *attrib, std::vector<shape_t> *shapes,
+                     std::vector<material_t> *materials, std::string *warn,
+                     std::string *err, const char *buf, size_t len,
+                     MaterialReader *readMatFn /*= NULL*/,
+                     bool triangulate /*= true*/,
+                     bool default_vcols_fallback /*= true*/,
+                     unsigned int num_threads /*= 0*/) {
+  if (num_threads == 0) {
+    num_threads = std::thread::hardware_concurrency();
+    if (num_threads == 0) num_threads = 1;
+  }
+
+  // Several chunks per thread keep the workers busy when line density varies
+  const size_t min_chunk_size = 256 * 1024;
+  size_t num_chunks = std::min(static_cast<size_t>(num_threads) * 4,
+                               len / min_chunk_size + 1);
+
+  std::vector<obj_chunk_t> chunks(num_chunks);
+  const char *buf_end = buf + len;
+  const char *chunk_begin = buf;
+  for (size_t c = 0; c < num_chunks; c++) {
+    const char *chunk_end = buf_end;
+    if (c + 1 < num_chunks) {
+      chunk_end = buf + (len / num_chunks) * (c + 1);
+      if (chunk_end < chunk_begin) chunk_end = chunk_begin;
+      const char *nl = static_cast<const char *>(
+          memchr(chunk_end, '\n', static_cast<size_t>(buf_end - chunk_end)));
+      chunk_end = nl ? nl + 1 : buf_end;
+    }
+    chunks[c].begin = chunk_begin;
+    chunks[c].end = chunk_end;
+    chunk_begin = chunk_end;
+  }
+
+  // Pass 1: count lines and elements, then prefix-sum them into global bases
+  ParallelFor(num_chunks, num_threads,
+              [&](size_t c) { CountObjChunk(&chunks[c]); });
+
+  size_t total_lines = 0, total_v = 0, total_vn = 0, total_vt = 0;
+  for (size_t c = 0; c < num_chunks; c++) {
+    chunks[c].line_base = total_lines;
+    chunks[c].v_base = total_v;
+    chunks[c].vn_base = total_vn;
+    chunks[c].vt_base = total_vt;
+    total_lines += chunks[c].num_lines;
+    total_v += chunks[c].num_v;
+    total_vn += chunks[c].num_vn;
+    total_vt += chunks[c].num_vt;
+  }
+
+  // Pass 2: parse every chunk independently
+  ParallelFor(num_chunks, num_threads, [&](size_t c) {
+    ParseObjChunk(&chunks[c], warn != NULL, default_vcols_fallback);
+  });
+
+  for (size_t c = 0; c < num_chunks; c++) {
+    if (chunks[c].unsupported) {
+      chunks.clear();
+      MemoryStreamBuf membuf(buf, len);
+      std::istream is(&membuf);
+      return LoadObj(attrib, shapes, materials, warn, err, &is, readMatFn,
+                     triangulate, default_vcols_fallback);
+    }
+  }
+
+  for (size_t c = 0; c < num_chunks; c++) {
+    if (warn) (*warn) += chunks[c].warn;
+    if (chunks[c].failed) {
+      if (err) (*err) += chunks[c].err;
+      return false;
+    }
+  }
+
+  // Concatenate the attribute streams at their prefix-summed offsets
+  std::vector<real_t> v(total_v * 3);
+  std::vector<real_t> vertex_weights(total_v);
+  std::vector<real_t> vn(total_vn * 3);
+  std::vector<real_t> vt(total_vt * 2);
+  std::vector<real_t> vc;
+  std::vector<skin_weight_t> vw;
+
+  bool found_all_colors = true;
+  size_t total_vc = 0;
+  std::vector<size_t> vc_base(num_chunks);
+  for (size_t c = 0; c < num_chunks; c++) {
+    found_all_colors &= chunks[c].found_all_colors;
+    vc_base[c] = total_vc;
+    total_vc += chunks[c].vc.size();
+  }
+  // not all vertices have colors, no default colors desired? -> clear colors
+  bool keep_colors = found_all_colors || default_vcols_fallback;
+  if (keep_colors) vc.resize(total_vc);
+
+  ParallelFor(num_chunks, num_threads, [&](size_t c) {
+    const obj_chunk_t &chunk = chunks[c];
+    std::copy(chunk.v.begin(), chunk.v.end(), v.begin() + chunk.v_base * 3);
+    std::copy(chunk.vertex_weights.begin(), chunk.vertex_weights.end(),
+              vertex_weights.begin() + chunk.v_base);
+    std::copy(chunk.vn.begin(), chunk.vn.end(),
+              vn.begin() + chunk.vn_base * 3);
+    std::copy(chunk.vt.begin(), chunk.vt.end(),
+              vt.begin() + chunk.vt_base * 2);
+    if (keep_colors) {
+      std::copy(chunk.vc.begin(), chunk.vc.end(), vc.begin() + vc_base[c]);
+    }
+  });
+
+  // Replay the order-dependent commands sequentially. Face groups are not
+  // exported here but cut into batches that are triangulated in parallel.
+  std::vector<obj_export_batch_t> batches;
+  std::vector<obj_shape_slot_t> slots;
+  std::vector<obj_export_batch_t> group;  // face runs of the current group
+
+  std::set<std::string> material_filenames;
+  std::map<std::string, int> material_map;
+  int material = -1;
+  unsigned int current_smoothing_id = 0;
+  std::string name;
+
+  const size_t max_batch_faces = 16384;
+
+  obj_shape_slot_t slot;
+  slot.push_rule = obj_shape_slot_t::PUSH_IF_FACES;
+  slot.last_group_nonempty = false;
+  slot.first_batch = 0;
+  slot.num_batches = 0;
+  slot.shape_index = -1;
+
+  // Equivalent of exportGroupsToShape() + prim_group.clear()
+  struct GroupFlusher {
+    std::vector<obj_export_batch_t> *group;
+    std::vector<obj_export_batch_t> *batches;
+    obj_shape_slot_t *slot;
+    bool operator()(int material_id, const std::string &group_name) const {
+      bool nonempty = !group->empty();
+      for (size_t i = 0; i < group->size(); i++) {
+        obj_export_batch_t &run = (*group)[i];
+        for (size_t f = 0; f < run.face_count; f += max_faces) {
+          obj_export_batch_t batch;
+          batch.shape_slot = 0;
+          batch.material_id = material_id;
+          batch.name = group_name;
+          batch.chunk = run.chunk;
+          batch.face_begin = run.face_begin + f;
+          batch.face_count = std::min(max_faces, run.face_count - f);
+          batch.smoothing_group_id = run.smoothing_group_id;
+          batch.indices_offset = 0;
+          batch.faces_offset = 0;
+          batches->push_back(batch);
+          slot->num_batches++;
+        }
+      }
+      group->clear();
+      return nonempty;
+    }
+    size_t max_faces;
+  };
+  GroupFlusher flush_group = {&group, &batches, &slot, max_batch_faces};
+
+  for (size_t c = 0; c < num_chunks; c++) {
+    const std::vector<obj_command_t> &commands = chunks[c].commands;
+    for (size_t i = 0; i < commands.size(); i++) {
+      const obj_command_t &command = commands[i];
+      size_t line_num = command.line_num;
+
+      switch (command.type) {
+        case OBJ_COMMAND_FACES: {
+          obj_export_batch_t run;
+          run.chunk = c;
+          run.face_begin = command.face_begin;
+          run.face_count = command.face_count;
+          run.smoothing_group_id = current_smoothing_id;
+          group.push_back(run);
+          break;
+        }
+
+        case OBJ_COMMAND_USEMTL: {
+          const std::string &namebuf = command.str;
+
+          int newMaterialId = -1;
+          std::map<std::string, int>::const_iterator it =
+              material_map.find(namebuf);
+          if (it != material_map.end()) {
+            newMaterialId = it->second;
+          } else {
+            // { error!! material not found }
+            if (warn) {
+              (*warn) += "material [ '" + namebuf + "' ] not found in .mtl\n";
+            }
+          }
+
+          if (newMaterialId != material) {
+            flush_group(material, name);
+            material = newMaterialId;
+          }
+          break;
+        }
+
+        case OBJ_COMMAND_MTLLIB: {
+          if (!readMatFn) break;
+
+          std::vector<std::string> filenames;
+          SplitString(command.str, ' ', '\\', filenames);
+
+          if (filenames.empty()) {
+            if (warn) {
+              std::stringstream ss;
+              ss << "Looks like empty filename for mtllib. Use default "
+                    "material (line "
+                 << line_num << ".)\n";
+
+              (*warn) += ss.str();
+            }
+          } else {
+            bool found = false;
+            for (size_t s = 0; s < filenames.size(); s++) {
+              if (material_filenames.count(filenames[s]) > 0) {
+                found = true;
+                continue;
+              }
+
+              std::string warn_mtl;
+              std::string err_mtl;
+              bool ok = (*readMatFn)(filenames[s].c_str(), materials,
+                                     &material_map, &warn_mtl, &err_mtl);
+              if (warn && (!warn_mtl.empty())) {
+                (*warn) += warn_mtl;
+              }
+
+              if (err && (!err_mtl.empty())) {
+                (*err) += err_mtl;
+              }
+
+              if (ok) {
+                found = true;
+                material_filenames.insert(filenames[s]);
+                break;
+              }
+            }
+
+            if (!found) {
+              if (warn) {
+                (*warn) +=
+                    "Failed to load material file(s). Use default "
+                    "material.\n";
+              }
+            }
+          }
+          break;
+        }
+
+        case OBJ_COMMAND_GROUP:
+        case OBJ_COMMAND_OBJECT: {
+          // flush previous face group and start a new shape
+          flush_group(material, name);
+          slots.push_back(slot);
+          slot.first_batch = batches.size();
+          slot.num_batches = 0;
+
+          if (command.type == OBJ_COMMAND_OBJECT) {
+            name = command.str;
+            break;
+          }
+
+          const std::vector<std::string> &names = command.names;
+          if (names.size() < 2) {
+            // 'g' with empty names
+            if (warn) {
+              std::stringstream ss;
+              ss << "Empty group name. line: " << line_num << "\n";
+              (*warn) += ss.str();
+              name = "";
+            }
+          } else {
+            std::stringstream ss;
+            ss << names[1];
+            for (size_t n = 2; n < names.size(); n++) {
+              ss << " " << names[n];
+            }
+            name = ss.str();
+          }
+          break;
+        }
+
+        case OBJ_COMMAND_SMOOTHING:
+          current_smoothing_id = command.smoothing_group_id;
+          break;
+      }
+    }
+  }
+
+  slot.push_rule = obj_shape_slot_t::PUSH_AT_END;
+  slot.last_group_nonempty = flush_group(material, name);
+  slots.push_back(slot);
+
+  // Triangulate all batches in parallel
+  std::vector<tag_t> no_tags;
+  ParallelFor(batches.size(), num_threads, [&](size_t b) {
+    obj_export_batch_t &batch = batches[b];
+    const obj_chunk_t &chunk = chunks[batch.chunk];
+
+    PrimGroup prim_group;
+    prim_group.faceGroup.resize(batch.face_count);
+    for (size_t f = 0; f < batch.face_count; f++) {
+      face_t &face = prim_group.faceGroup[f];
+      size_t face_id = batch.face_begin + f;
+      face.smoothing_group_id = batch.smoothing_group_id;
+      face.vertex_indices.assign(
+          chunk.face_indices.begin() +
+              static_cast<std::ptrdiff_t>(chunk.face_offsets[face_id]),
+          chunk.face_indices.begin() +
+              static_cast<std::ptrdiff_t>(chunk.face_offsets[face_id + 1]));
+    }
+
+    exportGroupsToShape(&batch.result, prim_group, no_tags,
+                        batch.material_id, batch.name, triangulate, v,
+                        warn ? &batch.warn : NULL);
+  });
+
+  // Decide which shapes survive (same rules as LoadObj()) and lay out the
+  // merged index streams
+  for (size_t s = 0; s < slots.size(); s++) {
+    obj_shape_slot_t &shape_slot = slots[s];
+    size_t num_indices = 0, num_faces = 0;
+    for (size_t b = shape_slot.first_batch;
+         b < shape_slot.first_batch + shape_slot.num_batches; b++) {
+      batches[b].indices_offset = num_indices;
+      batches[b].faces_offset = num_faces;
+      num_indices += batches[b].result.mesh.indices.size();
+      num_faces += batches[b].result.mesh.num_face_vertices.size();
+      if (warn) (*warn) += batches[b].warn;
+    }
+
+    bool push = num_indices > 0;
+    if (shape_slot.push_rule == obj_shape_slot_t::PUSH_AT_END) {
+      push = push || shape_slot.last_group_nonempty;
+    }
+    if (!push) continue;
+
+    shape_slot.shape_index = static_cast<int>(shapes->size());
+    shapes->push_back(shape_t());
+    shape_t &shape = shapes->back();
+    if (shape_slot.num_batches > 0) {
+      shape.name =
+          batches[shape_slot.first_batch + shape_slot.num_batches - 1].name;
+    }
+    shape.mesh.indices.resize(num_indices);
+    shape.mesh.num_face_vertices.resize(num_faces);
+    shape.mesh.material_ids.resize(num_faces);
+    shape.mesh.smoothing_group_ids.resize(num_faces);
+  }
+
+  for (size_t s = 0; s < slots.size(); s++) {
+    for (size_t b = slots[s].first_batch;
+         b < slots[s].first_batch + slots[s].num_batches; b++) {
+      batches[b].shape_slot = s;
+    }
+  }
+
+  ParallelFor(batches.size(), num_threads, [&](size_t b) {
+    obj_export_batch_t &batch = batches[b];
+    int shape_index = slots[batch.shape_slot].shape_index;
+    if (shape_index < 0) return;
+
+    mesh_t &src = batch.result.mesh;
+    mesh_t &dst = (*shapes)[static_cast<size_t>(shape_index)].mesh;
+    std::copy(src.indices.begin(), src.indices.end(),
+              dst.indices.begin() +
+                  static_cast<std::ptrdiff_t>(batch.indices_offset));
+    std::ptrdiff_t faces_offset =
+        static_cast<std::ptrdiff_t>(batch.faces_offset);
+    std::copy(src.num_face_vertices.begin(), src.num_face_vertices.end(),
+              dst.num_face_vertices.begin() + faces_offset);
+    std::copy(src.material_ids.begin(), src.material_ids.end(),
+              dst.material_ids.begin() + faces_offset);
+    std::copy(src.smoothing_group_ids.begin(), src.smoothing_group_ids.end(),
+              dst.smoothing_group_ids.begin() + faces_offset);
+  });
+
+  int greatest_v_idx = -1;
+  int greatest_vn_idx = -1;
+  int greatest_vt_idx = -1;
+  for (size_t c = 0; c < num_chunks; c++) {
+    greatest_v_idx = std::max(greatest_v_idx, chunks[c].greatest_v_idx);
+    greatest_vn_idx = std::max(greatest_vn_idx, chunks[c].greatest_vn_idx);
+    greatest_vt_idx = std::max(greatest_vt_idx, chunks[c].greatest_vt_idx);
+  }
+
+  size_t line_num = total_lines;
+  if (greatest_v_idx >= static_cast<int>(v.size() / 3)) {
+    if (warn) {
+      std::stringstream ss;
+      ss << "Vertex indices out of bounds (line " << line_num << ".)\n\n";
+      (*warn) += ss.str();
+    }
+  }
+  if (greatest_vn_idx >= static_cast<int>(vn.size() / 3)) {
+    if (warn) {
+      std::stringstream ss;
+      ss << "Vertex normal indices out of bounds (line " << line_num
+         << ".)\n\n";
+      (*warn) += ss.str();
+    }
+  }
+  if (greatest_vt_idx >= static_cast<int>(vt.size() / 2)) {
+    if (warn) {
+      std::stringstream ss;
+      ss << "Vertex texcoord indices out of bounds (line " << line_num
+         << ".)\n\n";
+      (*warn) += ss.str();
+    }
+  }
+
+  attrib->vertices.swap(v);
+  attrib->vertex_weights.swap(vertex_weights);
+  attrib->normals.swap(vn);
+  attrib->texcoords.swap(vt);
+  attrib->texcoord_ws.swap(vt);
+  attrib->colors.swap(vc);
+  attrib->skin_weights.swap(vw);
+
+  return true;
+}
+
 bool LoadObjWithCallback(std::istream &inStream, const callback_t &callback,
                          void *user_data /*= NULL*/,
                          MaterialReader *readMatFn /*= NULL*/,
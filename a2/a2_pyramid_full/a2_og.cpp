@@ -195,54 +195,16 @@ int main() {
 
     // Step 2: Drawing Basic Shapes
     // 
-    // Compile vertex shader
+    // Compile and link the vertex and fragment shaders into one program
 	// Vertex shader processes each vertex of a primitive (point, line, triangle)
-    unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-
-    // Check for vertex shader compile errors
-    int success;
-    char infoLog[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        std::cerr << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
-
-    // Compile fragment shader
-	// fragments are pixel candidates for the final image.
 	// fragment shader runs for each fragment generated by the rasterizer.
-	// GPU Rasterization turns 3D coordinates of a vertex into a 2D image space pixel.
-    unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
-
-    // Check for fragment shader compile errors
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-        std::cerr << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-    }
-
-    // Link shaders
-	// Linking of the compiled shaders into a complete pipeline for a program object.
-    unsigned int shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-
-    // Check for linking errors
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        std::cerr << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+	// Active uniforms are reflected once at link time, so the render loop never looks them up by string
+    ShaderProgram shader;
+    if (!shader.build(vertexShaderSource, fragmentShaderSource, "pyramid shader")) {
+        glfwTerminate();
+        return -1;
     }
 
-    // Delete individual shaders compiled assemblies since they are linked in shader program of context execution
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-
     // Define the vertices of a pyramid with positions, colors, and accurate normals for better lighting
 	// the 4 Base vertices as well as multi-positioned apex vertex for different normals / base sides
     // Position: x, y, z coordinates of vertex
@@ -349,7 +311,9 @@ int main() {
     model = glm::rotate(model, glm::radians(30.0f), glm::vec3(1.0f, 0.0f, 0.0f));
 
     // Main render loop
+    size_t frameCount = 0;
     while (!glfwWindowShouldClose(window)) {
+        frameCount++;
         // Calculate delta time for smooth movement  and
         // delays to allow time to register inputs for proper visualizations of transforms
         float currentFrame = glfwGetTime();
@@ -371,7 +335,7 @@ int main() {
             glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
 		// Use linked shader program (vertex and fragment shaders) as part of current rendering pipeline
-        glUseProgram(shaderProgram);
+        shader.use();
 
 		// Uniforms for lighting effects
 		// Uniforms: Variables from CPU passed to shaders GPU that remain constant for the entire draw call 
@@ -380,26 +344,16 @@ int main() {
 		glm::vec3 lightColor = glm::vec3(1.0f, 1.0f, 1.0f); // White light
         glm::vec3 viewPos = glm::vec3(0.0f, 0.3f, 2.0f);  // Try Same as camera position
 
-        // Get uniform lighting locations
-        unsigned int lightPosLoc = glGetUniformLocation(shaderProgram, "lightPos");
-        unsigned int viewPosLoc = glGetUniformLocation(shaderProgram, "viewPos");
-        unsigned int lightColorLoc = glGetUniformLocation(shaderProgram, "lightColor");
-
-        // Set uniform lighting values
-		// glUniform3fv: set uniform vec3 value ([lightPos, viewPos, lightColor])
-        glUniform3fv(lightPosLoc, 1, glm::value_ptr(lightPos));
-        glUniform3fv(viewPosLoc, 1, glm::value_ptr(viewPos));
-        glUniform3fv(lightColorLoc, 1, glm::value_ptr(lightColor));
-
-		// Get transform matrices unfiform locations
-        unsigned int modelLoc = glGetUniformLocation(shaderProgram, "model");
-        unsigned int viewLoc = glGetUniformLocation(shaderProgram, "view");
-        unsigned int projectionLoc = glGetUniformLocation(shaderProgram, "projection");
+        // Set uniform lighting values; unchanged values are skipped without a GL call
+        shader.set(uniformId("lightPos"), lightPos);
+        shader.set(uniformId("viewPos"), viewPos);
+        shader.set(uniformId("lightColor"), lightColor);
+
 		// Set Uniform transform matrices values
-		// glUniformMatrix4fv: set uniform mat4 value (transform matrices)
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-        glUniformMatrix4fv(projectionLoc, 1, GL_FALSE, glm::value_ptr(projection));
+        shader.set(uniformId("model"), model);
+        shader.set(uniformId("normalMatrix"), glm::inverseTranspose(glm::mat3(model)));
+        shader.set(uniformId("view"), view);
+        shader.set(uniformId("projection"), projection);
 
         // Bind VAO; then finally Draw
         glBindVertexArray(VAO);
@@ -422,7 +376,8 @@ int main() {
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &EBO);
-    glDeleteProgram(shaderProgram);
+    shader.printStats(frameCount);
+    shader.release();
     //Terminate GLFW library processes
     glfwTerminate();
     return 0;
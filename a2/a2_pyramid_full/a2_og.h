@@ -3,8 +3,10 @@
 #include <GLFW/glfw3.h>
 #include <GL/GL.h>
 #include <glm/glm.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include "../a2/ShaderProgram.h"
 
 // Window dimensions
 // Used for framebuffer size callback and aspect ratio calculations
@@ -21,6 +23,7 @@ const float KEY_REPEAT_DELAY = 0.5f;
 
 // Vertex shader with normal-plane based lighting effects
 // Uses MVP for model->world->view->clip space transformations
+// Normals use normalMatrix, the inverse transpose of the model's upper 3x3, computed once per frame on the CPU
 const char* vertexShaderSource = "#version 330 core\n"
 "layout (location = 0) in vec3 aPos;\n"
 "layout (location = 1) in vec3 aColor;\n"
@@ -29,12 +32,13 @@ const char* vertexShaderSource = "#version 330 core\n"
 "out vec3 Normal;\n"
 "out vec3 ourColor;\n"
 "uniform mat4 model;\n"
+"uniform mat3 normalMatrix;\n"
 "uniform mat4 view;\n"
 "uniform mat4 projection;\n"
 "void main()\n"
 "{\n"
 "   FragPos = vec3(model * vec4(aPos, 1.0));\n"
-"   Normal = mat3(transpose(inverse(model))) * aNormal;\n"
+"   Normal = normalMatrix * aNormal;\n"
 "   ourColor = aColor;\n"
 "   gl_Position = projection * view * model * vec4(aPos, 1.0);\n"
 "}\0";
@@ -0,0 +1,112 @@
+#include <glm/ext/matrix_clip_space.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/ext/scalar_constants.hpp>
+#include <glm/geometric.hpp>
+#include "InstanceCulling.h"
+#include <algorithm>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdio>
+
+// Sphere-frustum culling of one million instances: the plain glm loop over vec4 spheres against
+// the SoA kernels of a2/InstanceCulling, which must keep exactly the same instances.
+
+static std::size_t const Samples = 1000000;
+static int const Runs = 20;
+
+static void make_spheres(std::vector<glm::vec4>& Spheres)
+{
+	std::mt19937 Random(1);
+	std::uniform_real_distribution<float> Position(-500.0f, 500.0f);
+	std::uniform_real_distribution<float> Radius(0.5f, 2.0f);
+
+	Spheres.resize(Samples);
+	for(std::size_t i = 0; i < Samples; ++i)
+		Spheres[i] = glm::vec4(Position(Random), Position(Random) * 0.05f, Position(Random), Radius(Random));
+
+	// Neighbouring instances are near each other, as in a laid-out fleet
+	std::sort(Spheres.begin(), Spheres.end(), [](glm::vec4 const& A, glm::vec4 const& B)
+	{
+		int const CellA = static_cast<int>((A.z + 500.0f) / 8.0f) * 1000 + static_cast<int>((A.x + 500.0f) / 8.0f);
+		int const CellB = static_cast<int>((B.z + 500.0f) / 8.0f) * 1000 + static_cast<int>((B.x + 500.0f) / 8.0f);
+		return CellA < CellB;
+	});
+}
+
+static void cull_glm(std::vector<glm::vec4> const& Spheres, Frustum const& F, std::vector<uint32_t>& Visible)
+{
+	Visible.clear();
+	for(std::size_t i = 0, n = Spheres.size(); i < n; ++i)
+	{
+		bool Kept = true;
+		for(int p = 0; p < 6; ++p)
+			Kept = Kept && glm::dot(glm::vec3(F.planes[p]), glm::vec3(Spheres[i])) + F.planes[p].w >= -Spheres[i].w;
+		if(Kept)
+			Visible.push_back(static_cast<uint32_t>(i));
+	}
+}
+
+template <typename Function>
+static double best_of(Function const& Run)
+{
+	double Best = 1e30;
+	for(int Run_ = 0; Run_ < Runs; ++Run_)
+	{
+		std::chrono::high_resolution_clock::time_point t1 = std::chrono::high_resolution_clock::now();
+		Run();
+		std::chrono::high_resolution_clock::time_point t2 = std::chrono::high_resolution_clock::now();
+		Best = glm::min(Best, std::chrono::duration<double, std::micro>(t2 - t1).count());
+	}
+	return Best;
+}
+
+int main()
+{
+	int Error = 0;
+
+	std::vector<glm::vec4> Spheres;
+	make_spheres(Spheres);
+
+	InstanceBounds Bounds;
+	Bounds.count = Samples;
+	Bounds.x.resize(Samples);
+	Bounds.y.resize(Samples);
+	Bounds.z.resize(Samples);
+	Bounds.radius.resize(Samples);
+	for(std::size_t i = 0; i < Samples; ++i)
+	{
+		Bounds.x[i] = Spheres[i].x;
+		Bounds.y[i] = Spheres[i].y;
+		Bounds.z[i] = Spheres[i].z;
+		Bounds.radius[i] = Spheres[i].w;
+	}
+	computeGroupBounds(Bounds);
+
+	glm::mat4 const Projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 200.0f);
+	glm::mat4 const View = glm::lookAt(glm::vec3(0.0f, 10.0f, 0.0f), glm::vec3(40.0f, 0.0f, 30.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	Frustum const F = extractFrustum(Projection * View);
+
+	std::vector<uint32_t> Expected;
+	Expected.reserve(Samples);
+	std::printf("- glm loop: %.1f us\n", best_of([&]() { cull_glm(Spheres, F, Expected); }));
+	std::printf("  %d visible of %d\n", static_cast<int>(Expected.size()), static_cast<int>(Samples));
+
+	CullKernel const Kernels[] = { CullKernel::Scalar, CullKernel::SSE, CullKernel::AVX2 };
+	for(CullKernel const Kernel : Kernels)
+	{
+		if(Kernel > bestCullKernel())
+			continue;
+
+		VisibleInstances Visible;
+		std::printf("- %s: %.1f us\n", cullKernelName(Kernel), best_of([&]() { cullInstances(Bounds, F, Visible, 1, Kernel); }));
+		std::printf("- %s, all threads: %.1f us\n", cullKernelName(Kernel), best_of([&]() { cullInstances(Bounds, F, Visible, 0, Kernel); }));
+
+		bool Same = Visible.count == Expected.size();
+		for(std::size_t i = 0; Same && i < Expected.size(); ++i)
+			Same = Visible.indices[i] == Expected[i];
+		Error += Same ? 0 : 1;
+	}
+
+	return Error;
+}